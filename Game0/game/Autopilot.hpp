@@ -0,0 +1,52 @@
+#pragma once
+
+#include "RaidenGame.hpp"
+
+#include <stdexcept>
+#include <string>
+
+/*
+ * Autopilot is a scripted stand-in for a person at the keyboard, for the command-line
+ * tools (raiden_headless, raiden_batch). Its choices come from its own Rng, so the same
+ * player + seed always presses the same keys.
+ */
+
+enum class Player {
+	Idle, //never presses anything
+	Shoot, //holds fire, never moves
+	Random, //holds fire and picks a new direction every half second
+};
+
+inline Player parse_player(std::string const &name) {
+	if (name == "idle") return Player::Idle;
+	if (name == "shoot") return Player::Shoot;
+	if (name == "random") return Player::Random;
+	throw std::runtime_error("Unknown player '" + name + "' (expecting idle, shoot, or random).");
+}
+
+struct Autopilot {
+	Autopilot(Player player_, uint64_t seed) : player(player_), rng(seed ^ 0x9e3779b97f4a7c15ull) { }
+
+	//input bits (EventStatus) for the next tick:
+	int input(float elapsed) {
+		if (player == Player::Idle) return EventStatus::none;
+		if (player == Player::Shoot) return EventStatus::is_shoot;
+
+		until_change -= elapsed;
+		if (until_change <= 0.0f) {
+			until_change = 0.5f;
+			static const int Directions[] = {
+				0, EventStatus::is_up, EventStatus::is_down, EventStatus::is_left, EventStatus::is_right,
+				EventStatus::is_up | EventStatus::is_left, EventStatus::is_up | EventStatus::is_right,
+				EventStatus::is_down | EventStatus::is_left, EventStatus::is_down | EventStatus::is_right,
+			};
+			direction = Directions[rng.below(sizeof(Directions) / sizeof(Directions[0]))];
+		}
+		return EventStatus::none | EventStatus::is_shoot | direction;
+	}
+
+	Player player;
+	Rng rng;
+	float until_change = 0.0f;
+	int direction = 0;
+};
@@ -0,0 +1,199 @@
+#include "BulletPatterns.hpp"
+
+#include "simd.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+static const float TwoPi = 6.28318530718f;
+static const float DegreesToRadians = TwoPi / 360.0f;
+
+Pattern Pattern::parse(std::string const &text) {
+	Pattern pattern;
+	std::istringstream words(text);
+	if (!(words >> pattern.name)) throw std::runtime_error("Pattern '" + text + "' has no name.");
+
+	std::string word;
+	while (words >> word) {
+		if (word == "aim") {
+			pattern.aimed = true;
+			continue;
+		}
+		size_t equals = word.find('=');
+		if (equals == std::string::npos) throw std::runtime_error("Pattern '" + pattern.name + "' has a setting without a value: '" + word + "'.");
+		std::string key = word.substr(0, equals);
+		std::string value = word.substr(equals + 1);
+		try {
+			size_t used = 0;
+			if (key == "count") pattern.count = uint32_t(std::stoul(value, &used));
+			else if (key == "arc") pattern.arc = std::stof(value, &used) * DegreesToRadians;
+			else if (key == "spin") pattern.spin = std::stof(value, &used) * DegreesToRadians;
+			else if (key == "interval") pattern.interval = std::stof(value, &used);
+			else if (key == "burst") pattern.burst = uint32_t(std::stoul(value, &used));
+			else if (key == "pause") pattern.pause = std::stof(value, &used);
+			else if (key == "delay") pattern.delay = std::stof(value, &used);
+			else throw std::runtime_error("Pattern '" + pattern.name + "' has an unknown setting '" + key + "'.");
+			if (used != value.size()) throw std::invalid_argument(value);
+		} catch (std::logic_error const &) {
+			//(std::stoul and friends throw invalid_argument / out_of_range)
+			throw std::runtime_error("Pattern '" + pattern.name + "' has a bad value for '" + key + "': '" + value + "'.");
+		}
+	}
+	pattern.compute_offsets();
+	return pattern;
+}
+
+std::string Pattern::to_string() const {
+	std::ostringstream out;
+	out << name << " count=" << count;
+	if (arc != 0.0f) out << " arc=" << arc / DegreesToRadians;
+	if (spin != 0.0f) out << " spin=" << spin / DegreesToRadians;
+	if (aimed) out << " aim";
+	out << " interval=" << interval;
+	if (burst != 0) out << " burst=" << burst << " pause=" << pause;
+	if (delay != 0.0f) out << " delay=" << delay;
+	return out.str();
+}
+
+void Pattern::compute_offsets() {
+	if (count == 0 || count > PATTERN_MAX_COUNT) {
+		throw std::runtime_error("Pattern '" + name + "' has " + std::to_string(count) + " bullets per shot; expecting 1 to " + std::to_string(PATTERN_MAX_COUNT) + ".");
+	}
+	for (float value : { arc, spin, interval, pause, delay }) {
+		if (!std::isfinite(value)) throw std::runtime_error("Pattern '" + name + "' has a setting that isn't a number.");
+	}
+	//(every wait must be positive, or an emitter would fire forever in one tick)
+	if (!(interval > 0.0f) || (burst != 0 && !(pause > 0.0f)) || delay < 0.0f) {
+		throw std::runtime_error("Pattern '" + name + "' needs a positive interval (and pause, with bursts), and a delay of at least zero.");
+	}
+
+	offsets.resize(count);
+	bool ring = (arc >= TwoPi - 1e-4f);
+	for (uint32_t i = 0; i < count; ++i) {
+		float angle = 0.0f;
+		if (ring) {
+			angle = i * (TwoPi / count);
+		} else if (count > 1) {
+			angle = -0.5f * arc + arc * i / float(count - 1);
+		}
+		offsets[i] = glm::vec2(std::cos(angle), std::sin(angle));
+	}
+}
+
+uint32_t Pattern::fire_scalar(glm::vec2 const &origin, glm::vec2 const &heading, Bullets &bullets) const {
+	size_t first = bullets.size();
+	uint32_t added = bullets.append(count);
+	float speed = bullets.archetype.speed;
+	for (uint32_t i = 0; i < added; ++i) {
+		//(the same expressions, in the same order, as the SIMD path)
+		glm::vec2 const &offset = offsets[i];
+		glm::vec2 direction(heading.x * offset.x + -heading.y * offset.y, heading.x * offset.y + heading.y * offset.x);
+		bullets.positions[first + i] = origin;
+		bullets.previous_positions[first + i] = origin;
+		bullets.velocities[first + i] = direction * speed;
+		bullets.lifetimes[first + i] = bullets.archetype.lifetime;
+	}
+	return added;
+}
+
+uint32_t Pattern::fire(glm::vec2 const &origin, glm::vec2 const &heading, Bullets &bullets) const {
+#ifdef SIMD_SSE2
+	size_t first = bullets.size();
+	uint32_t added = bullets.append(count);
+	std::fill_n(bullets.positions.begin() + first, added, origin);
+	std::fill_n(bullets.previous_positions.begin() + first, added, origin);
+	std::fill_n(bullets.lifetimes.begin() + first, added, bullets.archetype.lifetime);
+
+	//velocities, two bullets per step: offsets are (cos, sin) pairs, so with the pair swapped to
+	// (sin, cos), heading.x * (c, s) + (-heading.y, heading.y) * (s, c) is the offset turned by the heading
+	float const *offset = &offsets[0].x;
+	float *velocity = &bullets.velocities[first].x;
+	const __m128 hx = _mm_set1_ps(heading.x);
+	const __m128 hy = _mm_setr_ps(-heading.y, heading.y, -heading.y, heading.y);
+	const __m128 speed = _mm_set1_ps(bullets.archetype.speed);
+	uint32_t i = 0;
+	for (; i + 2 <= added; i += 2) {
+		__m128 cs = _mm_loadu_ps(offset + 2 * i);
+		__m128 sc = _mm_shuffle_ps(cs, cs, _MM_SHUFFLE(2, 3, 0, 1));
+		__m128 direction = _mm_add_ps(_mm_mul_ps(hx, cs), _mm_mul_ps(hy, sc));
+		_mm_storeu_ps(velocity + 2 * i, _mm_mul_ps(direction, speed));
+	}
+	for (; i < added; ++i) {
+		glm::vec2 const &o = offsets[i];
+		glm::vec2 direction(heading.x * o.x + -heading.y * o.y, heading.x * o.y + heading.y * o.x);
+		bullets.velocities[first + i] = direction * bullets.archetype.speed;
+	}
+	return added;
+#else
+	return fire_scalar(origin, heading, bullets);
+#endif
+}
+
+void Pattern::save(ByteWriter &out) const {
+	//(same layout as write_vector, straight from the string)
+	out.write(uint64_t(name.size()));
+	out.write_array(name.data(), name.size());
+	out.write(count);
+	out.write(arc);
+	out.write(spin);
+	out.write(uint8_t(aimed ? 1 : 0));
+	out.write(interval);
+	out.write(burst);
+	out.write(pause);
+	out.write(delay);
+}
+
+void Pattern::load(ByteReader &in) {
+	uint64_t length = in.read< uint64_t >();
+	if (length > 256) throw std::runtime_error("Saved pattern name has " + std::to_string(length) + " characters; expecting at most 256.");
+	//(read into the string's own storage, which is usually big enough already)
+	name.resize(size_t(length));
+	in.read_array(&name[0], name.size());
+	in.read(count);
+	in.read(arc);
+	in.read(spin);
+	aimed = (in.read< uint8_t >() != 0);
+	in.read(interval);
+	in.read(burst);
+	in.read(pause);
+	in.read(delay);
+	compute_offsets();
+}
+
+uint64_t hash_patterns(std::vector< Pattern > const &patterns) {
+	//FNV-1a over each pattern's name and settings:
+	uint64_t hash = 14695981039346656037ull;
+	auto add = [&hash](void const *data, size_t size) {
+		unsigned char const *bytes = reinterpret_cast< unsigned char const * >(data);
+		for (size_t i = 0; i < size; ++i) {
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		}
+	};
+	for (Pattern const &pattern : patterns) {
+		uint64_t length = pattern.name.size();
+		add(&length, sizeof(length));
+		add(pattern.name.data(), pattern.name.size());
+		uint8_t aimed = (pattern.aimed ? 1 : 0);
+		add(&pattern.count, sizeof(pattern.count));
+		add(&pattern.arc, sizeof(pattern.arc));
+		add(&pattern.spin, sizeof(pattern.spin));
+		add(&aimed, sizeof(aimed));
+		add(&pattern.interval, sizeof(pattern.interval));
+		add(&pattern.burst, sizeof(pattern.burst));
+		add(&pattern.pause, sizeof(pattern.pause));
+		add(&pattern.delay, sizeof(pattern.delay));
+	}
+	return hash;
+}
+
+std::vector< Pattern > const &builtin_patterns() {
+	static const std::vector< Pattern > patterns = {
+		Pattern::parse("ring count=24 arc=360 interval=1.2"),
+		Pattern::parse("spiral count=3 arc=360 spin=13 interval=0.08"),
+		Pattern::parse("fan count=5 arc=50 aim interval=0.9"),
+		Pattern::parse("burst count=6 arc=30 aim interval=0.06 burst=5 pause=1.5 delay=0.5"),
+	};
+	return patterns;
+}
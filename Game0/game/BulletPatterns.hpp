@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Bullets.hpp"
+#include "ByteStream.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define PATTERN_MAX_COUNT 1024 //most bullets in one shot
+
+/*
+ * Pattern describes how an emitter fires: every shot is 'count' bullets fanned out over 'arc'
+ * around a heading, and shots come on a schedule. The usual bullet-hell shapes are all settings of
+ * the same few numbers:
+ *
+ *   ring     count=24 arc=360 interval=1.2                         (evenly all around)
+ *   spiral   count=3 arc=360 spin=13 interval=0.08                 (the heading turns each shot)
+ *   fan      count=5 arc=50 aim interval=0.9                       (centered on the nearest fighter)
+ *   burst    count=6 arc=30 aim interval=0.06 burst=5 pause=1.5 delay=0.5
+ *
+ * Those lines are also the text form parse() reads: a name, then key=value settings (angles in
+ * degrees, times in seconds) and the 'aim' flag.
+ *
+ * Each pattern keeps its bullets' directions relative to the heading (computed once, in parse),
+ * so firing a shot is one rotation per bullet -- see fire(), which writes a whole shot into a
+ * Bullets store at once.
+ */
+
+struct Pattern {
+	std::string name;
+	uint32_t count = 1; //bullets per shot
+	float arc = 0.0f; //radians the shot spreads over (a full turn spaces the bullets evenly all around)
+	float spin = 0.0f; //radians the heading turns after each shot
+	bool aimed = false; //the heading points at the nearest fighter (otherwise straight down)
+	float interval = 1.0f; //seconds between shots
+	uint32_t burst = 0; //shots before each pause (0: no pauses)
+	float pause = 0.0f; //seconds, after each burst
+	float delay = 0.0f; //seconds before an emitter's first shot
+
+	//each bullet's direction relative to a heading of (1, 0), as (cos, sin) pairs:
+	std::vector< glm::vec2 > offsets;
+
+	//read the text form (see above); throws std::runtime_error on anything it doesn't understand:
+	static Pattern parse(std::string const &text);
+	//the text form:
+	std::string to_string() const;
+
+	//seconds from shot 'shot' (counting from 0) to the next one:
+	float wait_after(uint32_t shot) const {
+		return (burst != 0 && (shot + 1) % burst == 0 ? pause : interval);
+	}
+
+	//spawn one shot from 'origin' centered on 'heading' (unit length) into 'bullets':
+	// returns the bullets spawned (fewer than 'count' if 'bullets' filled up; the rest count as failed spawns).
+	uint32_t fire(glm::vec2 const &origin, glm::vec2 const &heading, Bullets &bullets) const;
+	//same results as fire, one bullet at a time (the fallback path):
+	uint32_t fire_scalar(glm::vec2 const &origin, glm::vec2 const &heading, Bullets &bullets) const;
+
+	//write / read the settings (read recomputes offsets; throws on bad data):
+	// (neither allocates, unless the name or bullet count grows past what this pattern held before)
+	void save(ByteWriter &out) const;
+	void load(ByteReader &in);
+
+private:
+	void compute_offsets(); //(checks the settings, too)
+};
+
+//the patterns every RaidenGame starts with (ring, spiral, fan, burst):
+std::vector< Pattern > const &builtin_patterns();
+
+//hash of every pattern's name and settings (equal hashes: the same patterns, in the same order):
+uint64_t hash_patterns(std::vector< Pattern > const &patterns);
@@ -0,0 +1,89 @@
+#include "Bullets.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+Bullets::Bullets(Archetype const &archetype_, uint32_t capacity) : archetype(archetype_) {
+	positions.reserve(capacity);
+	previous_positions.reserve(capacity);
+	velocities.reserve(capacity);
+	lifetimes.reserve(capacity);
+	stats.capacity = capacity;
+}
+
+bool Bullets::spawn(glm::vec2 const &position, glm::vec2 const &direction) {
+	if (full()) {
+		stats.failed += 1;
+		return false;
+	}
+	positions.emplace_back(position);
+	previous_positions.emplace_back(position);
+	velocities.emplace_back(direction * archetype.speed);
+	lifetimes.emplace_back(archetype.lifetime);
+	stats.on_acquire();
+	return true;
+}
+
+uint32_t Bullets::append(uint32_t count) {
+	uint32_t added = std::min(count, stats.capacity - stats.live);
+	stats.failed += count - added;
+	//(capacity was reserved up front, so these never reallocate)
+	size_t end = size() + added;
+	positions.resize(end);
+	previous_positions.resize(end);
+	velocities.resize(end);
+	lifetimes.resize(end);
+	stats.live += added;
+	stats.acquired += added;
+	stats.high_water = std::max(stats.high_water, stats.live);
+	return added;
+}
+
+void Bullets::store_previous() {
+	std::copy(positions.begin(), positions.end(), previous_positions.begin());
+}
+
+void Bullets::kill(size_t index) {
+	assert(index < size());
+	size_t last = size() - 1;
+	if (index != last) {
+		positions[index] = positions[last];
+		previous_positions[index] = previous_positions[last];
+		velocities[index] = velocities[last];
+		lifetimes[index] = lifetimes[last];
+	}
+	positions.pop_back();
+	previous_positions.pop_back();
+	velocities.pop_back();
+	lifetimes.pop_back();
+	stats.on_release();
+}
+
+void Bullets::clear() {
+	positions.clear();
+	previous_positions.clear();
+	velocities.clear();
+	lifetimes.clear();
+	stats.live = 0;
+}
+
+void Bullets::save(ByteWriter &out) const {
+	out.write_vector(positions);
+	out.write_vector(previous_positions);
+	out.write_vector(velocities);
+	out.write_vector(lifetimes);
+}
+
+void Bullets::load(ByteReader &in) {
+	//(capacity was reserved up front, so these never reallocate)
+	in.read_vector(positions, stats.capacity);
+	in.read_vector(previous_positions, stats.capacity);
+	in.read_vector(velocities, stats.capacity);
+	in.read_vector(lifetimes, stats.capacity);
+	if (previous_positions.size() != size() || velocities.size() != size() || lifetimes.size() != size()) {
+		clear();
+		throw std::runtime_error("Saved bullets have mismatched array lengths.");
+	}
+	stats.live = uint32_t(size());
+	stats.high_water = std::max(stats.high_water, stats.live);
+}
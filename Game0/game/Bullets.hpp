@@ -0,0 +1,69 @@
+#pragma once
+
+#include "ByteStream.hpp"
+#include "PoolStats.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/*
+ * Bullets stores every live bullet of one archetype as a structure of arrays.
+ *
+ * Things that are the same for all bullets of a kind (size, speed, lifetime, bouncing)
+ * live once in the archetype; per-bullet arrays only hold what changes every frame.
+ *
+ * Live bullets are always packed into [0, size()): killing a bullet moves the last
+ * bullet into its slot, so update and draw loops never see dead entries.
+ *
+ * Storage is reserved up front for a fixed capacity and never grows;
+ * spawning into a full store fails (and is counted in stats).
+ */
+
+struct Bullets {
+	struct Archetype {
+		Archetype(glm::vec2 const &radius_, float speed_, float lifetime_, bool bounces_) :
+			radius(radius_), speed(speed_), lifetime(lifetime_), bounces(bounces_) { }
+		glm::vec2 radius;
+		float speed;
+		float lifetime;
+		//bouncing bullets reflect off the court walls:
+		bool bounces;
+	};
+
+	Bullets(Archetype const &archetype, uint32_t capacity);
+
+	Archetype archetype;
+
+	//per-bullet state (all arrays are the same length):
+	std::vector< glm::vec2 > positions;
+	std::vector< glm::vec2 > previous_positions; //positions as of the last tick (for drawing between ticks)
+	std::vector< glm::vec2 > velocities; //NOTE: already scaled by archetype.speed
+	std::vector< float > lifetimes; //seconds left before the bullet expires
+
+	size_t size() const { return positions.size(); }
+	bool empty() const { return positions.empty(); }
+	bool full() const { return stats.live == stats.capacity; }
+
+	//add a bullet travelling along 'direction' (unit length) at archetype.speed:
+	// returns false if the store is full.
+	bool spawn(glm::vec2 const &position, glm::vec2 const &direction);
+	//add up to 'count' bullets at the end, for the caller to fill in (all four arrays, [size() - added, size())):
+	// returns how many were added -- fewer than 'count' if the store fills up (the rest count as failed spawns).
+	uint32_t append(uint32_t count);
+
+	//remember current positions as previous_positions (call at the start of each tick):
+	void store_previous();
+
+	//remove bullet 'index' by moving the last bullet into its place:
+	// (so when killing while iterating, don't advance the index)
+	void kill(size_t index);
+
+	void clear();
+
+	//write / read every live bullet (read replaces the current bullets; throws on bad data):
+	void save(ByteWriter &out) const;
+	void load(ByteReader &in);
+
+	PoolStats stats;
+};
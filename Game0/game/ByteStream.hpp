@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/*
+ * ByteWriter / ByteReader copy plain-old-data values and arrays to and from a byte buffer.
+ * They are used for saving and restoring game state (e.g., replay keyframes).
+ *
+ * Values are copied as-is, in the machine's byte order, so buffers are only meant to be
+ * read back on the same kind of machine (all of our targets are little-endian).
+ * ByteReader throws std::runtime_error if it runs out of data or sees a bad array length.
+ */
+
+struct ByteWriter {
+	explicit ByteWriter(std::vector< uint8_t > &bytes_) : bytes(bytes_) { }
+
+	template< typename T >
+	void write(T const &value) {
+		write_array(&value, 1);
+	}
+
+	template< typename T >
+	void write_array(T const *values, size_t count) {
+		static_assert(std::is_trivially_copyable< T >::value, "only plain data can be written");
+		uint8_t const *begin = reinterpret_cast< uint8_t const * >(values);
+		bytes.insert(bytes.end(), begin, begin + count * sizeof(T));
+	}
+
+	//length (as uint64_t) followed by the elements:
+	template< typename T >
+	void write_vector(std::vector< T > const &values) {
+		write(uint64_t(values.size()));
+		write_array(values.data(), values.size());
+	}
+
+	std::vector< uint8_t > &bytes;
+};
+
+struct ByteReader {
+	ByteReader(uint8_t const *data_, size_t size_) : data(data_), size(size_) { }
+
+	template< typename T >
+	void read(T &value) {
+		read_array(&value, 1);
+	}
+
+	template< typename T >
+	T read() {
+		T value;
+		read(value);
+		return value;
+	}
+
+	template< typename T >
+	void read_array(T *values, size_t count) {
+		static_assert(std::is_trivially_copyable< T >::value, "only plain data can be read");
+		if (count > (size - offset) / sizeof(T)) {
+			throw std::runtime_error("Saved data ends early (at byte " + std::to_string(offset) + " of " + std::to_string(size) + ").");
+		}
+		std::memcpy(values, data + offset, count * sizeof(T));
+		offset += count * sizeof(T);
+	}
+
+	//reads a vector written by write_vector, refusing lengths over 'max_count':
+	template< typename T >
+	void read_vector(std::vector< T > &values, size_t max_count) {
+		uint64_t count = read< uint64_t >();
+		if (count > max_count) {
+			throw std::runtime_error("Saved array has " + std::to_string(count) + " elements; expecting at most " + std::to_string(max_count) + ".");
+		}
+		values.resize(size_t(count));
+		read_array(values.data(), values.size());
+	}
+
+	bool done() const { return offset == size; }
+
+	uint8_t const *data;
+	size_t size;
+	size_t offset = 0;
+};
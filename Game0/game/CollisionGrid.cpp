@@ -0,0 +1,62 @@
+#include "CollisionGrid.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+CollisionGrid::CollisionGrid(glm::vec2 const &min_, glm::vec2 const &max_, float cell_size_, glm::vec2 const &max_radius_, uint32_t capacity) :
+	min(min_), max(max_), cell_size(cell_size_), max_radius(max_radius_) {
+	assert(cell_size > 0.0f);
+	glm::vec2 extent = glm::max(max - min, glm::vec2(cell_size));
+	cells = glm::uvec2(glm::ceil(extent / cell_size));
+
+	heads.assign(cells.x * cells.y, -1U);
+	next.assign(capacity, -1U);
+	prev.assign(capacity, -1U);
+	cell_of.assign(capacity, -1U);
+}
+
+void CollisionGrid::link(uint32_t id, uint32_t cell) {
+	uint32_t head = heads[cell];
+	next[id] = head;
+	prev[id] = -1U;
+	if (head != -1U) prev[head] = id;
+	heads[cell] = id;
+	cell_of[id] = cell;
+}
+
+void CollisionGrid::unlink(uint32_t id) {
+	uint32_t cell = cell_of[id];
+	if (prev[id] != -1U) next[prev[id]] = next[id];
+	else heads[cell] = next[id];
+	if (next[id] != -1U) prev[next[id]] = prev[id];
+	next[id] = prev[id] = -1U;
+	cell_of[id] = -1U;
+}
+
+void CollisionGrid::update(uint32_t id, glm::vec2 const &center) {
+	assert(id < cell_of.size());
+	uint32_t cell = cell_index(center);
+	if (cell_of[id] == cell) return;
+
+	if (cell_of[id] == -1U) {
+		stats.items += 1;
+	} else {
+		unlink(id);
+		stats.moves += 1;
+	}
+	link(id, cell);
+}
+
+void CollisionGrid::remove(uint32_t id) {
+	if (!contains(id)) return;
+	unlink(id);
+	stats.items -= 1;
+}
+
+void CollisionGrid::clear() {
+	std::fill(heads.begin(), heads.end(), -1U);
+	std::fill(next.begin(), next.end(), -1U);
+	std::fill(prev.begin(), prev.end(), -1U);
+	std::fill(cell_of.begin(), cell_of.end(), -1U);
+	stats.items = 0;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/*
+ * CollisionGrid is a uniform-grid broadphase over a fixed rectangle.
+ *
+ * Each item is filed under the one cell that contains its center; queries look at
+ * every cell the query box touches, widened by the largest item radius, so an item
+ * is reported if its box could possibly overlap. (Callers still do the exact test.)
+ *
+ * Items are identified by small integer ids in [0, capacity) -- e.g., World entity ids.
+ * update() is O(1) and only touches the cell lists when an item changes cell, so
+ * the grid can be kept current incrementally every frame. No memory is allocated
+ * after construction.
+ *
+ * Points outside the rectangle are clamped into the border cells.
+ */
+
+struct CollisionGrid {
+	//'max_radius' is the largest half-extent (in each axis) of any item that will be stored:
+	CollisionGrid(glm::vec2 const &min, glm::vec2 const &max, float cell_size, glm::vec2 const &max_radius, uint32_t capacity);
+
+	//insert item 'id' at 'center', or move it there if it is already in the grid:
+	void update(uint32_t id, glm::vec2 const &center);
+	//remove item 'id' (does nothing if it isn't in the grid):
+	void remove(uint32_t id);
+	void clear();
+	bool contains(uint32_t id) const { return id < cell_of.size() && cell_of[id] != -1U; }
+
+	//call 'fn(id)' for every item that might overlap 'box' = (min.x, max.x, min.y, max.y);
+	// 'fn' returns false to stop the query early.
+	// NOTE: don't update() or remove() items from inside 'fn'.
+	template< typename F >
+	void query(glm::vec4 const &box, F const &fn) const;
+
+	glm::vec2 min, max;
+	float cell_size;
+	glm::vec2 max_radius;
+	glm::uvec2 cells; //number of cells along each axis
+
+	struct Stats {
+		uint32_t items = 0; //items currently in the grid
+		uint32_t moves = 0; //times an item changed cell (reset by caller)
+		uint32_t queries = 0; //queries run (reset by caller)
+		uint32_t candidates = 0; //items reported by queries (reset by caller)
+	} mutable stats;
+
+private:
+	uint32_t cell_index(glm::vec2 const &p) const;
+	glm::uvec2 cell_coord(glm::vec2 const &p) const;
+	void link(uint32_t id, uint32_t cell);
+	void unlink(uint32_t id);
+
+	//each cell holds a doubly-linked list of items threaded through per-item arrays:
+	std::vector< uint32_t > heads; //first item in each cell, -1U if empty
+	std::vector< uint32_t > next, prev; //per item
+	std::vector< uint32_t > cell_of; //per item, -1U if not in grid
+};
+
+//---------------------------------------------
+
+inline glm::uvec2 CollisionGrid::cell_coord(glm::vec2 const &p) const {
+	glm::vec2 c = (p - min) / cell_size;
+	c = glm::clamp(c, glm::vec2(0.0f), glm::vec2(cells - glm::uvec2(1)));
+	return glm::uvec2(c);
+}
+
+inline uint32_t CollisionGrid::cell_index(glm::vec2 const &p) const {
+	glm::uvec2 c = cell_coord(p);
+	return c.y * cells.x + c.x;
+}
+
+template< typename F >
+void CollisionGrid::query(glm::vec4 const &box, F const &fn) const {
+	stats.queries += 1;
+	glm::uvec2 lo = cell_coord(glm::vec2(box[0], box[2]) - max_radius);
+	glm::uvec2 hi = cell_coord(glm::vec2(box[1], box[3]) + max_radius);
+	for (uint32_t y = lo.y; y <= hi.y; ++y) {
+		for (uint32_t x = lo.x; x <= hi.x; ++x) {
+			for (uint32_t id = heads[y * cells.x + x]; id != -1U; id = next[id]) {
+				stats.candidates += 1;
+				if (!fn(id)) return;
+			}
+		}
+	}
+}
@@ -0,0 +1,48 @@
+#include "FrameArena.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <new>
+
+FrameArena::FrameArena(size_t capacity_) : capacity(capacity_) {
+	block = static_cast< char * >(::operator new(capacity));
+	stats.capacity = capacity;
+}
+
+FrameArena::~FrameArena() {
+	reset();
+	::operator delete(block);
+}
+
+void *FrameArena::allocate(size_t size, size_t alignment) {
+	assert(alignment != 0 && (alignment & (alignment - 1)) == 0 && alignment <= alignof(std::max_align_t));
+	size_t start = (top + alignment - 1) & ~(alignment - 1);
+	if (start <= capacity && size <= capacity - start) {
+		top = start + size;
+		return block + start;
+	}
+	//out of room this frame; the heap's blocks are aligned well enough for anything:
+	overflow.emplace_back(::operator new(std::max< size_t >(size, 1)));
+	overflow_bytes += size;
+	stats.overflows += 1;
+	return overflow.back();
+}
+
+void FrameArena::reset() {
+	stats.high_water = std::max(stats.high_water, used());
+	if (!overflow.empty()) {
+		for (void *ptr : overflow) {
+			::operator delete(ptr);
+		}
+		overflow.clear();
+		//make room for a frame like this one (and then some), so the heap isn't needed next time:
+		size_t needed = top + overflow_bytes;
+		capacity = std::max(needed + needed / 2, 2 * capacity);
+		::operator delete(block);
+		block = static_cast< char * >(::operator new(capacity));
+		stats.capacity = capacity;
+		stats.grows += 1;
+		overflow_bytes = 0;
+	}
+	top = 0;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * FrameArena is a bump allocator for scratch memory that only lives for one frame
+ * (vertex lists and the like): allocating is a pointer bump, freeing is a no-op,
+ * and reset() -- called by main once the frame is on screen -- drops everything at once.
+ *
+ * It never fails: a frame that runs out of room gets extra blocks from the heap (counted
+ * in stats.overflows), and the next reset() grows the arena to fit that frame, so after
+ * the first few frames of any scene the arena stops touching the heap at all.
+ *
+ * FrameAllocator< T > lets standard containers live in an arena:
+ *
+ *   FrameVector< Vertex > vertices{FrameAllocator< Vertex >(*Mode::frame_arena)};
+ *   vertices.reserve(estimate); //(growing a vector leaves its old storage behind until reset, so reserve when you can)
+ *
+ * Nothing allocated from an arena may be used after its reset().
+ */
+
+struct FrameArena {
+	explicit FrameArena(size_t capacity);
+	~FrameArena();
+	FrameArena(FrameArena const &) = delete;
+	FrameArena &operator=(FrameArena const &) = delete;
+
+	//'size' bytes, aligned to 'alignment' (a power of two, at most alignof(std::max_align_t)):
+	void *allocate(size_t size, size_t alignment);
+
+	//forget every allocation (and grow, if this frame overflowed):
+	void reset();
+
+	//bytes handed out since the last reset (including overflow blocks):
+	size_t used() const { return top + overflow_bytes; }
+
+	struct Stats {
+		size_t capacity = 0;
+		size_t high_water = 0; //most bytes used in one frame
+		uint64_t overflows = 0; //allocations that didn't fit and went to the heap
+		uint64_t grows = 0;
+	} stats;
+
+private:
+	char *block = nullptr;
+	size_t capacity = 0;
+	size_t top = 0; //first free byte of 'block'
+	std::vector< void * > overflow; //heap blocks for allocations that didn't fit this frame
+	size_t overflow_bytes = 0;
+};
+
+template< typename T >
+struct FrameAllocator {
+	typedef T value_type;
+
+	explicit FrameAllocator(FrameArena &arena_) : arena(&arena_) { }
+	template< typename U >
+	FrameAllocator(FrameAllocator< U > const &other) : arena(other.arena) { }
+
+	T *allocate(size_t count) { return static_cast< T * >(arena->allocate(count * sizeof(T), alignof(T))); }
+	void deallocate(T *, size_t) { } //(freed all at once by FrameArena::reset)
+
+	template< typename U >
+	bool operator==(FrameAllocator< U > const &other) const { return arena == other.arena; }
+	template< typename U >
+	bool operator!=(FrameAllocator< U > const &other) const { return arena != other.arena; }
+
+	FrameArena *arena;
+};
+
+template< typename T >
+using FrameVector = std::vector< T, FrameAllocator< T > >;
@@ -0,0 +1,72 @@
+#include "FreeIds.hpp"
+
+#include <cassert>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+//index of the lowest set bit of a non-zero word:
+static inline uint32_t lowest_bit(uint32_t word) {
+	assert(word != 0);
+#if defined(_MSC_VER)
+	unsigned long bit;
+	_BitScanForward(&bit, word);
+	return uint32_t(bit);
+#else
+	return uint32_t(__builtin_ctz(word));
+#endif
+}
+
+FreeIds::FreeIds(uint32_t capacity_) : capacity(capacity_) {
+	uint32_t count = capacity;
+	do {
+		count = (count + 31) / 32;
+		if (count == 0) count = 1; //(a capacity of zero still gets a top word)
+		levels.emplace_back(count, 0);
+	} while (count > 1);
+	reset();
+}
+
+uint32_t FreeIds::acquire() {
+	if (empty()) return -1U;
+	uint32_t id = 0;
+	for (uint32_t l = uint32_t(levels.size()); l > 0; --l) {
+		id = id * 32 + lowest_bit(levels[l - 1][id]);
+	}
+	take(id);
+	return id;
+}
+
+void FreeIds::take(uint32_t id) {
+	assert(id < capacity && free(id));
+	for (std::vector< uint32_t > &level : levels) {
+		uint32_t &word = level[id >> 5];
+		word &= ~(1u << (id & 31));
+		if (word != 0) break; //(the levels above still see a free id in this word)
+		id >>= 5;
+	}
+}
+
+void FreeIds::release(uint32_t id) {
+	assert(id < capacity && !free(id));
+	for (std::vector< uint32_t > &level : levels) {
+		uint32_t &word = level[id >> 5];
+		bool had_free = (word != 0);
+		word |= (1u << (id & 31));
+		if (had_free) break; //(the levels above already knew this word has a free id)
+		id >>= 5;
+	}
+}
+
+void FreeIds::reset() {
+	//every level has a set bit for each entry of the level below:
+	uint32_t count = capacity;
+	for (std::vector< uint32_t > &level : levels) {
+		for (uint32_t w = 0; w < level.size(); ++w) {
+			uint32_t bits = count - w * 32;
+			level[w] = (bits >= 32 ? ~0u : (1u << bits) - 1u);
+		}
+		count = uint32_t(level.size());
+	}
+}
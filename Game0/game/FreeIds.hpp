@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/*
+ * FreeIds tracks which ids in [0, capacity) are free, and hands out the lowest one.
+ *
+ * It is a bitmap (one bit per id, set = free) with a summary bitmap on top of it
+ * (one bit per 32-bit word below, set = that word has a free id), and so on up to a
+ * single word. acquire() follows the lowest set bit down from the top, and acquire()
+ * and release() only touch one word per level -- three levels for 32768 ids, so
+ * both are O(1) for any capacity we use. All storage is allocated in the constructor.
+ *
+ * Handing out the lowest free id means which ids are in use only depends on which
+ * objects are alive, not on the order they came and went, so saved state restores exactly.
+ */
+
+struct FreeIds {
+	explicit FreeIds(uint32_t capacity);
+
+	//lowest free id, now taken; -1U if every id is taken:
+	uint32_t acquire();
+	//give back a taken id:
+	void release(uint32_t id);
+	//take a specific free id (e.g., when loading saved state):
+	void take(uint32_t id);
+	//make every id free:
+	void reset();
+
+	bool empty() const { return levels.back()[0] == 0; } //(no free ids)
+	bool free(uint32_t id) const { return (levels[0][id >> 5] >> (id & 31)) & 1u; }
+
+private:
+	uint32_t capacity;
+	std::vector< std::vector< uint32_t > > levels; //levels[0] is one bit per id; the last level is one word
+};
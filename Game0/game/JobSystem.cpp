@@ -0,0 +1,240 @@
+#include "JobSystem.hpp"
+
+#include <cassert>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+//which JobSystem (if any) the current thread works for, and its index there:
+static thread_local JobSystem const *current_system = nullptr;
+static thread_local uint32_t current_thread = 0;
+
+JobSystem::JobSystem(uint32_t threads, uint32_t capacity_) : thread_count(std::max(1u, threads)), capacity(std::max(1u, capacity_)) {
+	jobs.reset(new Job[capacity]);
+	free_jobs.reserve(capacity);
+	for (uint32_t i = capacity; i > 0; --i) {
+		jobs[i - 1].continuations.reserve(4);
+		free_jobs.emplace_back(i - 1);
+	}
+
+	//queue rings are a power of two long so head/tail can wrap freely:
+	uint32_t ring_size = 1;
+	while (ring_size < capacity) ring_size *= 2;
+	workers.reset(new Worker[thread_count]);
+	for (uint32_t t = 0; t < thread_count; ++t) {
+		workers[t].ring.assign(ring_size, -1U);
+	}
+
+	last_frame.utilization.assign(thread_count, 0.0f);
+	frame_start = Clock::now();
+
+	worker_threads.reserve(thread_count - 1);
+	for (uint32_t t = 1; t < thread_count; ++t) {
+		worker_threads.emplace_back(&JobSystem::worker_main, this, t);
+	}
+}
+
+JobSystem::~JobSystem() {
+	{
+		std::lock_guard< std::mutex > lock(sleep_mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (auto &thread : worker_threads) {
+		thread.join();
+	}
+}
+
+JobSystem::Handle JobSystem::run(std::function< void() > fn, std::initializer_list< Handle > after) {
+	uint32_t index = acquire_job();
+	Job &job = jobs[index];
+	job.fn = std::move(fn);
+	job.chunk_fn = nullptr;
+	job.counter = nullptr;
+	//the extra blocker keeps the job from starting before all its dependencies are registered:
+	job.blockers.store(int32_t(after.size()) + 1, std::memory_order_relaxed);
+
+	Handle handle;
+	handle.index = index;
+	handle.generation = job.generation.load(std::memory_order_relaxed);
+
+	int32_t unblocked = 1;
+	for (Handle const &before : after) {
+		bool waiting = false;
+		if (before.valid()) {
+			Job &dependency = jobs[before.index];
+			std::lock_guard< std::mutex > lock(dependency.mutex);
+			if (dependency.generation.load(std::memory_order_relaxed) == before.generation) {
+				dependency.continuations.emplace_back(index);
+				waiting = true;
+			}
+		}
+		if (!waiting) unblocked += 1;
+	}
+	if (job.blockers.fetch_sub(unblocked, std::memory_order_acq_rel) == unblocked) {
+		enqueue(index);
+	}
+	return handle;
+}
+
+bool JobSystem::done(Handle const &handle) const {
+	if (!handle.valid()) return true;
+	return jobs[handle.index].generation.load(std::memory_order_acquire) != handle.generation;
+}
+
+void JobSystem::wait(Handle const &handle) {
+	uint32_t thread = thread_index();
+	while (!done(handle)) {
+		if (!run_one(thread)) std::this_thread::yield();
+	}
+}
+
+void JobSystem::wait_for(std::atomic< int32_t > const &counter) {
+	uint32_t thread = thread_index();
+	while (counter.load(std::memory_order_acquire) > 0) {
+		if (!run_one(thread)) std::this_thread::yield();
+	}
+}
+
+void JobSystem::queue_chunks(ChunkFn fn, void const *context, uint32_t first, uint32_t last, std::atomic< int32_t > *counter) {
+	//queued in reverse so this thread (which pops from the back) picks them up in order:
+	for (uint32_t c = last; c > first; --c) {
+		uint32_t index = acquire_job();
+		Job &job = jobs[index];
+		job.chunk_fn = fn;
+		job.chunk_context = context;
+		job.chunk = c - 1;
+		job.counter = counter;
+		job.blockers.store(0, std::memory_order_relaxed);
+		enqueue(index);
+	}
+}
+
+void JobSystem::begin_frame() {
+	for (uint32_t t = 0; t < thread_count; ++t) {
+		workers[t].busy_ns.store(0, std::memory_order_relaxed);
+		workers[t].jobs.store(0, std::memory_order_relaxed);
+		workers[t].steals.store(0, std::memory_order_relaxed);
+	}
+	frame_start = Clock::now();
+}
+
+void JobSystem::end_frame() {
+	double frame_ns = std::chrono::duration< double, std::nano >(Clock::now() - frame_start).count();
+	last_frame.seconds = float(frame_ns * 1e-9);
+	last_frame.jobs = 0;
+	last_frame.steals = 0;
+	for (uint32_t t = 0; t < thread_count; ++t) {
+		double busy = double(workers[t].busy_ns.load(std::memory_order_relaxed));
+		last_frame.utilization[t] = (frame_ns > 0.0 ? float(std::min(1.0, busy / frame_ns)) : 0.0f);
+		last_frame.jobs += workers[t].jobs.load(std::memory_order_relaxed);
+		last_frame.steals += workers[t].steals.load(std::memory_order_relaxed);
+	}
+}
+
+uint32_t JobSystem::thread_index() const {
+	return (current_system == this ? current_thread : 0);
+}
+
+uint32_t JobSystem::acquire_job() {
+	while (true) {
+		{
+			std::lock_guard< std::mutex > lock(free_mutex);
+			if (!free_jobs.empty()) {
+				uint32_t index = free_jobs.back();
+				free_jobs.pop_back();
+				return index;
+			}
+		}
+		//every job slot is in use; help finish some:
+		if (!run_one(thread_index())) std::this_thread::yield();
+	}
+}
+
+void JobSystem::enqueue(uint32_t index) {
+	Worker &worker = workers[thread_index()];
+	{
+		std::lock_guard< std::mutex > lock(worker.mutex);
+		assert(worker.tail - worker.head < worker.ring.size());
+		worker.ring[worker.tail & (worker.ring.size() - 1)] = index;
+		worker.tail += 1;
+	}
+	{
+		std::lock_guard< std::mutex > lock(sleep_mutex);
+		queued.fetch_add(1, std::memory_order_relaxed);
+	}
+	wake.notify_one();
+}
+
+bool JobSystem::run_one(uint32_t thread) {
+	uint32_t index = -1U;
+	bool stolen = false;
+
+	{ //newest job from this thread's own queue:
+		Worker &own = workers[thread];
+		std::lock_guard< std::mutex > lock(own.mutex);
+		if (own.head != own.tail) {
+			own.tail -= 1;
+			index = own.ring[own.tail & (own.ring.size() - 1)];
+		}
+	}
+	//...or the oldest job from someone else's:
+	for (uint32_t k = 1; index == -1U && k < thread_count; ++k) {
+		Worker &victim = workers[(thread + k) % thread_count];
+		std::lock_guard< std::mutex > lock(victim.mutex);
+		if (victim.head != victim.tail) {
+			index = victim.ring[victim.head & (victim.ring.size() - 1)];
+			victim.head += 1;
+			stolen = true;
+		}
+	}
+	if (index == -1U) return false;
+
+	queued.fetch_sub(1, std::memory_order_relaxed);
+	if (stolen) workers[thread].steals.fetch_add(1, std::memory_order_relaxed);
+	execute(index, thread);
+	return true;
+}
+
+void JobSystem::execute(uint32_t index, uint32_t thread) {
+	Job &job = jobs[index];
+
+	auto before = Clock::now();
+	if (job.chunk_fn) {
+		job.chunk_fn(job.chunk_context, job.chunk);
+	} else {
+		job.fn();
+	}
+	auto after = Clock::now();
+	workers[thread].busy_ns.fetch_add(uint64_t(std::chrono::duration_cast< std::chrono::nanoseconds >(after - before).count()), std::memory_order_relaxed);
+	workers[thread].jobs.fetch_add(1, std::memory_order_relaxed);
+
+	std::atomic< int32_t > *counter = job.counter;
+	job.fn = nullptr; //drop captures now, before anyone sees the job as finished
+
+	{ //mark finished and release anything that was waiting on it:
+		std::lock_guard< std::mutex > lock(job.mutex);
+		job.generation.fetch_add(1, std::memory_order_release);
+		for (uint32_t next : job.continuations) {
+			if (jobs[next].blockers.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				enqueue(next);
+			}
+		}
+		job.continuations.clear();
+	}
+	{
+		std::lock_guard< std::mutex > lock(free_mutex);
+		free_jobs.emplace_back(index);
+	}
+	if (counter) counter->fetch_sub(1, std::memory_order_release);
+}
+
+void JobSystem::worker_main(uint32_t thread) {
+	current_system = this;
+	current_thread = thread;
+	while (true) {
+		if (run_one(thread)) continue;
+		std::unique_lock< std::mutex > lock(sleep_mutex);
+		wake.wait(lock, [this](){ return stopping || queued.load(std::memory_order_relaxed) > 0; });
+		if (stopping) return;
+	}
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * JobSystem is a small work-stealing scheduler for per-frame (or per-tick) work.
+ *
+ * It owns threads() - 1 worker threads; the thread that created it counts as thread 0
+ * and helps run jobs whenever it waits. Every thread has its own queue: jobs queued
+ * from a thread go on the back of its queue, it takes work from the back, and idle
+ * threads steal from the front of other threads' queues.
+ *
+ * Jobs live in a fixed table allocated up front, so queueing and running jobs does
+ * not allocate (beyond whatever a std::function passed to run() needs).
+ *
+ * Usage:
+ *   JobSystem::Handle a = jobs.run([&](){ ... });
+ *   JobSystem::Handle b = jobs.run([&](){ ... }, {a}); //runs after 'a' finishes
+ *   jobs.wait(b);
+ *   jobs.parallel_for(count, 1024, [&](uint32_t begin, uint32_t end){ ... });
+ */
+
+struct JobSystem {
+	//'threads' includes the calling thread, so JobSystem(1) starts no workers and everything runs inline:
+	explicit JobSystem(uint32_t threads = std::max(1u, std::thread::hardware_concurrency()), uint32_t capacity = 4096);
+	~JobSystem();
+	JobSystem(JobSystem const &) = delete;
+	JobSystem &operator=(JobSystem const &) = delete;
+
+	struct Handle {
+		uint32_t index = -1U;
+		uint32_t generation = 0;
+		bool valid() const { return index != -1U; }
+	};
+
+	//queue 'fn' to run once every job in 'after' has finished (invalid or finished handles are skipped):
+	Handle run(std::function< void() > fn, std::initializer_list< Handle > after = {});
+
+	//has the job finished? (invalid handles count as finished)
+	bool done(Handle const &handle) const;
+
+	//block until the job has finished, running queued jobs in the meantime:
+	void wait(Handle const &handle);
+
+	//call fn(begin, end) on contiguous chunks that together cover [0, count), spread over all threads;
+	// returns once every chunk has run. Chunks are at least 'min_chunk' long, so small ranges run inline.
+	// Each index is in exactly one chunk, so if fn only writes to its own indices, the result doesn't
+	// depend on the thread count.
+	template< typename F >
+	void parallel_for(uint32_t count, uint32_t min_chunk, F const &fn);
+
+	uint32_t threads() const { return thread_count; }
+
+	//------ instrumentation ------
+	//call begin_frame/end_frame around each frame; end_frame fills in last_frame:
+	struct FrameStats {
+		float seconds = 0.0f; //wall time from begin_frame to end_frame
+		std::vector< float > utilization; //per thread, fraction of the frame spent running jobs (thread 0 is the creating thread)
+		uint64_t jobs = 0; //jobs run during the frame
+		uint64_t steals = 0; //...of which were taken from another thread's queue
+	};
+	void begin_frame();
+	void end_frame();
+	FrameStats last_frame;
+
+private:
+	typedef void (*ChunkFn)(void const *context, uint32_t chunk);
+
+	struct Job {
+		std::function< void() > fn;
+		ChunkFn chunk_fn = nullptr; //if set, runs instead of fn (used by parallel_for; never allocates)
+		void const *chunk_context = nullptr;
+		uint32_t chunk = 0;
+		std::atomic< int32_t > *counter = nullptr; //decremented when the job finishes (if set)
+
+		std::atomic< int32_t > blockers{0}; //unfinished dependencies (+1 while the job is being set up)
+		std::atomic< uint32_t > generation{0}; //bumped when the job finishes; handles compare against it
+		std::mutex mutex; //guards 'continuations' against the job finishing
+		std::vector< uint32_t > continuations; //jobs waiting on this one
+	};
+
+	struct Worker {
+		//queue of job indices (ring buffer, one slot per job, so it never overflows):
+		std::mutex mutex;
+		std::vector< uint32_t > ring;
+		uint32_t head = 0, tail = 0; //pop/steal at head, push at tail
+
+		//stats since begin_frame:
+		std::atomic< uint64_t > busy_ns{0};
+		std::atomic< uint64_t > jobs{0};
+		std::atomic< uint64_t > steals{0};
+
+		char padding[64]; //keep workers' hot counters off each other's cache lines
+	};
+
+	uint32_t thread_count;
+	uint32_t capacity;
+	std::unique_ptr< Job[] > jobs;
+	std::unique_ptr< Worker[] > workers;
+	std::vector< std::thread > worker_threads;
+
+	std::mutex free_mutex;
+	std::vector< uint32_t > free_jobs;
+
+	//sleeping workers wait on 'wake' until something is queued:
+	std::mutex sleep_mutex;
+	std::condition_variable wake;
+	std::atomic< int32_t > queued{0};
+	bool stopping = false;
+
+	std::chrono::high_resolution_clock::time_point frame_start;
+
+	uint32_t thread_index() const; //0 for any thread that isn't one of this system's workers
+	uint32_t acquire_job();
+	void enqueue(uint32_t job);
+	bool run_one(uint32_t thread); //run one queued job; false if none were found
+	void execute(uint32_t job, uint32_t thread);
+	void wait_for(std::atomic< int32_t > const &counter);
+	void queue_chunks(ChunkFn fn, void const *context, uint32_t first, uint32_t last, std::atomic< int32_t > *counter);
+	void worker_main(uint32_t thread);
+};
+
+template< typename F >
+void JobSystem::parallel_for(uint32_t count, uint32_t min_chunk, F const &fn) {
+	if (count == 0) return;
+	//a few chunks per thread, so stealing can even out uneven chunks:
+	uint32_t chunks = std::min(thread_count * 4, count / std::max(1u, min_chunk));
+	if (thread_count == 1 || chunks <= 1) {
+		fn(0u, count);
+		return;
+	}
+
+	struct Range {
+		F const *fn;
+		uint32_t count, chunks;
+		uint32_t begin(uint32_t c) const { return uint32_t(uint64_t(count) * c / chunks); }
+	} range{&fn, count, chunks};
+	ChunkFn call = [](void const *context, uint32_t c) {
+		Range const &r = *reinterpret_cast< Range const * >(context);
+		(*r.fn)(r.begin(c), r.begin(c + 1));
+	};
+
+	std::atomic< int32_t > remaining(int32_t(chunks - 1));
+	queue_chunks(call, &range, 1, chunks, &remaining);
+	call(&range, 0);
+	wait_for(remaining);
+}
@@ -1,6 +1,9 @@
 #include "Mode.hpp"
 
 std::shared_ptr< Mode > Mode::current;
+JobSystem *Mode::jobs = nullptr;
+FrameArena *Mode::frame_arena = nullptr;
+StreamBuffer *Mode::vertex_stream = nullptr;
 
 void Mode::set_current(std::shared_ptr< Mode > const &new_current) {
 	current = new_current;
@@ -3,7 +3,14 @@
 #include <SDL.h>
 #include <glm/glm.hpp>
 
+#include <cstdint>
 #include <memory>
+#include <stdexcept>
+#include <vector>
+
+struct FrameArena;
+struct JobSystem;
+struct StreamBuffer;
 
 struct Mode : std::enable_shared_from_this< Mode > {
 	virtual ~Mode() { }
@@ -13,16 +20,39 @@ struct Mode : std::enable_shared_from_this< Mode > {
 	//The function should return 'true' if it handled the event.
 	virtual bool handle_event(SDL_Event const &, glm::uvec2 const &window_size) { return false; }
 
-	//update is called at the start of a new frame, after events are handled:
-	// 'elapsed' is time in seconds since the last call to 'update'
+	//update is called after events are handled, zero or more times per frame:
+	// the main loop runs the simulation at a fixed tick rate, so 'elapsed' is always one tick (in seconds)
 	virtual void update(float elapsed) { }
 
-	//draw is called after update:
+	//draw is called once per frame, after any updates:
 	virtual void draw(glm::uvec2 const &drawable_size) = 0;
 
+	//snapshots are the mode's whole simulation state as a flat, versioned byte buffer (for save states, rollback, test fixtures):
+	// save_snapshot appends to 'out' and returns false if the mode has nothing to save;
+	// load_snapshot restores one made by the same kind of mode (throws std::runtime_error on bad data)
+	virtual bool save_snapshot(std::vector< uint8_t > &out) const { return false; }
+	virtual void load_snapshot(uint8_t const *data, size_t size) { throw std::runtime_error("This mode can't load snapshots."); }
+
+	//render_alpha is set by the main loop before draw:
+	// it is how far (as a fraction of a tick, in [0,1]) real time has run past the most recent update.
+	// modes can draw mix(previous, current, render_alpha) to keep motion smooth at any display rate.
+	float render_alpha = 1.0f;
+
 	//Mode::current is the Mode to which events are dispatched.
 	// use 'set_current' to change the current Mode (e.g., to switch to a menu)
 	static std::shared_ptr< Mode > current;
 	static void set_current(std::shared_ptr< Mode > const &);
+
+	//Mode::jobs runs work on all cores; modes may use it from update() and draw().
+	// (main creates it before the first mode and keeps it until the last mode is gone)
+	static JobSystem *jobs;
+
+	//Mode::frame_arena holds scratch memory for the current frame (see FrameArena.hpp);
+	// main resets it once each frame is drawn, so nothing allocated from it may be kept past draw().
+	static FrameArena *frame_arena;
+
+	//Mode::vertex_stream is where modes upload the vertices they draw each frame (see StreamBuffer.hpp);
+	// main fences it after draw(), and it may move to a new buffer object when a frame outgrows it.
+	static StreamBuffer *vertex_stream;
 };
 
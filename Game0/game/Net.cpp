@@ -0,0 +1,197 @@
+#include "Net.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET NativeSocket;
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int NativeSocket;
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+//winsock needs to be started before use (it counts starts + cleanups):
+namespace {
+	void start_winsock() {
+		WSADATA data;
+		if (WSAStartup(MAKEWORD(2, 2), &data) != 0) throw std::runtime_error("Failed to start winsock.");
+	}
+	void close_socket(intptr_t handle) { closesocket(NativeSocket(handle)); }
+	const intptr_t BadSocket = intptr_t(INVALID_SOCKET);
+}
+#else
+namespace {
+	void start_winsock() { }
+	void close_socket(intptr_t handle) { close(NativeSocket(handle)); }
+	const intptr_t BadSocket = -1;
+}
+#endif
+
+//------ NetAddress ------
+
+NetAddress NetAddress::parse(std::string const &text) {
+	size_t colon = text.rfind(':');
+	if (colon == std::string::npos || colon + 1 == text.size()) {
+		throw std::runtime_error("Expecting an address like 'host:port', got '" + text + "'.");
+	}
+	std::string host = text.substr(0, colon);
+	unsigned long port = std::stoul(text.substr(colon + 1));
+	if (port == 0 || port > 0xffff) throw std::runtime_error("Bad port in '" + text + "'.");
+
+	start_winsock();
+	addrinfo hints;
+	std::memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+	addrinfo *found = nullptr;
+	int err = getaddrinfo(host.c_str(), nullptr, &hints, &found);
+#ifdef _WIN32
+	WSACleanup();
+#endif
+	if (err != 0 || !found) throw std::runtime_error("Couldn't find host '" + host + "'.");
+
+	NetAddress address;
+	address.ip = ntohl(reinterpret_cast< sockaddr_in const * >(found->ai_addr)->sin_addr.s_addr);
+	address.port = uint16_t(port);
+	freeaddrinfo(found);
+	return address;
+}
+
+std::string NetAddress::to_string() const {
+	return std::to_string((ip >> 24) & 0xff) + "." + std::to_string((ip >> 16) & 0xff) + "."
+		+ std::to_string((ip >> 8) & 0xff) + "." + std::to_string(ip & 0xff) + ":" + std::to_string(port);
+}
+
+//------ UdpSocket ------
+
+UdpSocket::UdpSocket(uint16_t port, NetShim const &shim_) : shim(shim_), shim_rng(shim_.seed) {
+	start_winsock();
+	handle = intptr_t(socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP));
+	if (handle == BadSocket) {
+#ifdef _WIN32
+		WSACleanup();
+#endif
+		throw std::runtime_error("Failed to create a UDP socket.");
+	}
+
+	sockaddr_in address;
+	std::memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	address.sin_port = htons(port);
+	bool ok = (bind(NativeSocket(handle), reinterpret_cast< sockaddr const * >(&address), sizeof(address)) == 0);
+
+	//never block:
+#ifdef _WIN32
+	u_long non_blocking = 1;
+	ok = ok && (ioctlsocket(NativeSocket(handle), FIONBIO, &non_blocking) == 0);
+#else
+	ok = ok && (fcntl(NativeSocket(handle), F_SETFL, fcntl(NativeSocket(handle), F_GETFL, 0) | O_NONBLOCK) == 0);
+#endif
+
+	socklen_t length = sizeof(address);
+	ok = ok && (getsockname(NativeSocket(handle), reinterpret_cast< sockaddr * >(&address), &length) == 0);
+	if (!ok) {
+		close_socket(handle);
+#ifdef _WIN32
+		WSACleanup();
+#endif
+		throw std::runtime_error("Failed to bind a UDP socket to port " + std::to_string(port) + ".");
+	}
+	bound_port = ntohs(address.sin_port);
+}
+
+UdpSocket::~UdpSocket() {
+	close_socket(handle);
+#ifdef _WIN32
+	WSACleanup();
+#endif
+}
+
+void UdpSocket::send(NetAddress const &to, uint8_t const *data, size_t size) {
+	stats.sent += 1;
+	stats.sent_bytes += size;
+	if (!shim.active()) {
+		send_now(to, data, size);
+		return;
+	}
+
+	flush_delayed();
+	if (shim.loss > 0.0f && shim_rng.uniform() < shim.loss) {
+		stats.dropped += 1;
+		return;
+	}
+	float delay = shim.latency + shim.jitter * shim_rng.uniform();
+	Delayed packet;
+	packet.due = std::chrono::steady_clock::now()
+		+ std::chrono::duration_cast< std::chrono::steady_clock::duration >(std::chrono::duration< float >(delay));
+	packet.to = to;
+	if (!spare.empty()) {
+		packet.data.swap(spare.back());
+		spare.pop_back();
+	}
+	packet.data.assign(data, data + size);
+	auto at = std::upper_bound(delayed.begin(), delayed.end(), packet.due, [](std::chrono::steady_clock::time_point const &due, Delayed const &d) {
+		return due < d.due;
+	});
+	delayed.insert(at, std::move(packet));
+}
+
+bool UdpSocket::receive(std::vector< uint8_t > *data, NetAddress *from) {
+	flush_delayed();
+
+	uint8_t buffer[65536];
+	sockaddr_in address;
+	socklen_t length = sizeof(address);
+	int got = int(recvfrom(NativeSocket(handle), reinterpret_cast< char * >(buffer), sizeof(buffer), 0, reinterpret_cast< sockaddr * >(&address), &length));
+	if (got < 0) {
+#ifdef _WIN32
+		int err = WSAGetLastError();
+		//(ICMP "port unreachable" shows up as WSAECONNRESET on windows; it just means the peer isn't up yet)
+		if (err != WSAEWOULDBLOCK && err != WSAECONNRESET) stats.errors += 1;
+#else
+		if (errno != EAGAIN && errno != EWOULDBLOCK && errno != ECONNREFUSED) stats.errors += 1;
+#endif
+		return false;
+	}
+	stats.received += 1;
+	stats.received_bytes += uint32_t(got);
+	data->assign(buffer, buffer + got);
+	if (from) {
+		from->ip = ntohl(address.sin_addr.s_addr);
+		from->port = ntohs(address.sin_port);
+	}
+	return true;
+}
+
+void UdpSocket::send_now(NetAddress const &to, uint8_t const *data, size_t size) {
+	sockaddr_in address;
+	std::memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(to.ip);
+	address.sin_port = htons(to.port);
+	int sent = int(sendto(NativeSocket(handle), reinterpret_cast< char const * >(data), int(size), 0, reinterpret_cast< sockaddr const * >(&address), sizeof(address)));
+	if (sent != int(size)) stats.errors += 1;
+}
+
+void UdpSocket::flush_delayed() {
+	auto now = std::chrono::steady_clock::now();
+	while (!delayed.empty() && delayed.front().due <= now) {
+		Delayed &packet = delayed.front();
+		send_now(packet.to, packet.data.data(), packet.data.size());
+		spare.emplace_back(std::move(packet.data));
+		delayed.pop_front();
+	}
+}
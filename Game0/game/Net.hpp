@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Rng.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+/*
+ * UdpSocket is a small, non-blocking IPv4 UDP socket for the networked modes (see Rollback.hpp).
+ *
+ * It has a built-in shim for testing on one machine: outgoing datagrams can be
+ * delayed (latency + random jitter) and dropped (loss), so two processes on localhost
+ * see roughly what they would over a real network. The shim's choices come from its
+ * own Rng, so a given seed drops the same packets.
+ */
+
+//IPv4 address + port, in host byte order:
+struct NetAddress {
+	uint32_t ip = 0;
+	uint16_t port = 0;
+
+	//"host:port", where host is a dotted address or a name; throws std::runtime_error:
+	static NetAddress parse(std::string const &text);
+	std::string to_string() const;
+
+	bool operator==(NetAddress const &other) const { return ip == other.ip && port == other.port; }
+	bool operator!=(NetAddress const &other) const { return !(*this == other); }
+};
+
+//what the shim does to outgoing datagrams:
+struct NetShim {
+	float latency = 0.0f; //seconds added to every send
+	float jitter = 0.0f; //up to this many more seconds, at random (so packets can arrive out of order)
+	float loss = 0.0f; //fraction of sends dropped, in [0,1]
+	uint64_t seed = 0; //for the jitter + loss rolls
+	bool active() const { return latency > 0.0f || jitter > 0.0f || loss > 0.0f; }
+};
+
+struct UdpSocket {
+	//bind to 'port' on all interfaces (0 picks a free port); throws std::runtime_error:
+	explicit UdpSocket(uint16_t port, NetShim const &shim = NetShim());
+	~UdpSocket();
+	UdpSocket(UdpSocket const &) = delete;
+	UdpSocket &operator=(UdpSocket const &) = delete;
+
+	//send a datagram (through the shim, if it is active); errors are counted, not thrown:
+	void send(NetAddress const &to, uint8_t const *data, size_t size);
+	//next waiting datagram, if there is one (never blocks):
+	bool receive(std::vector< uint8_t > *data, NetAddress *from);
+
+	uint16_t port() const { return bound_port; }
+
+	//------ stats ------
+	struct Stats {
+		uint64_t sent = 0, received = 0; //datagrams (sent counts ones the shim dropped)
+		uint64_t sent_bytes = 0, received_bytes = 0;
+		uint64_t dropped = 0; //by the shim
+		uint64_t errors = 0; //failed sends + receives
+	} stats;
+
+private:
+	intptr_t handle = -1; //(a SOCKET on windows, a file descriptor elsewhere)
+	uint16_t bound_port = 0;
+
+	NetShim shim;
+	Rng shim_rng;
+	struct Delayed {
+		std::chrono::steady_clock::time_point due;
+		NetAddress to;
+		std::vector< uint8_t > data;
+	};
+	std::deque< Delayed > delayed; //ordered by 'due'
+	std::vector< std::vector< uint8_t > > spare; //buffers from sent Delayed's, for reuse
+	void send_now(NetAddress const &to, uint8_t const *data, size_t size);
+	void flush_delayed(); //send everything that is due
+};
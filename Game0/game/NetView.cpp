@@ -0,0 +1,233 @@
+#include "NetView.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+int16_t quantize(float value, float scale) {
+	return int16_t(std::max(-32768.0f, std::min(32767.0f, std::round(value * scale))));
+}
+
+//zig-zag + LEB128, so small numbers of either sign take one byte:
+void write_varint(std::vector< uint8_t > &out, int32_t value) {
+	uint32_t bits = (uint32_t(value) << 1) ^ uint32_t(value >> 31);
+	while (bits >= 0x80) {
+		out.emplace_back(uint8_t(bits | 0x80));
+		bits >>= 7;
+	}
+	out.emplace_back(uint8_t(bits));
+}
+
+struct VarintReader {
+	uint8_t const *data;
+	size_t size;
+	size_t offset = 0;
+	uint8_t byte() {
+		if (offset >= size) throw std::runtime_error("View ends early.");
+		return data[offset++];
+	}
+	int32_t varint() {
+		uint32_t bits = 0;
+		for (uint32_t shift = 0; ; shift += 7) {
+			if (shift > 28) throw std::runtime_error("View has a bad number.");
+			uint8_t b = byte();
+			bits |= uint32_t(b & 0x7f) << shift;
+			if (!(b & 0x80)) break;
+		}
+		return int32_t(bits >> 1) ^ -int32_t(bits & 1);
+	}
+	uint32_t count(uint32_t max) {
+		int32_t value = varint();
+		if (value < 0 || uint32_t(value) > max) throw std::runtime_error("View has a bad count.");
+		return uint32_t(value);
+	}
+};
+
+}
+
+void NetView::capture(RaidenGame const &game) {
+	tick = uint32_t(game.tick);
+	scalars[FighterX] = quantize(game.bot_fighter.x, NET_POSITION_SCALE);
+	scalars[FighterY] = quantize(game.bot_fighter.y, NET_POSITION_SCALE);
+	scalars[FighterHealth] = quantize(game.player_health, NET_HEALTH_SCALE);
+	scalars[WingX] = quantize(game.wing.position.x, NET_POSITION_SCALE);
+	scalars[WingY] = quantize(game.wing.position.y, NET_POSITION_SCALE);
+	scalars[WingHealth] = quantize(game.wing.health, NET_HEALTH_SCALE);
+	scalars[WingActive] = (game.wing.active ? 1 : 0);
+	scalars[Kills] = game.killed_enemies_num;
+
+	enemies.clear();
+	game.world.each< RaidenGame::Enemy, RaidenGame::Body >([&](Entity const &e, RaidenGame::Enemy const &, RaidenGame::Body const &body) {
+		Enemy enemy;
+		enemy.index = uint16_t(e.index);
+		enemy.generation = uint8_t(e.generation);
+		enemy.x = quantize(body.position.x, NET_POSITION_SCALE);
+		enemy.y = quantize(body.position.y, NET_POSITION_SCALE);
+		enemies.emplace_back(enemy);
+	});
+	std::sort(enemies.begin(), enemies.end(), [](Enemy const &a, Enemy const &b) { return a.index < b.index; });
+
+	//(while the game is over, bullets aren't drawn, so they aren't sent)
+	auto capture_bullets = [&](Bullets const &bullets, std::vector< int16_t > &into) {
+		into.clear();
+		if (game.game_over()) return;
+		for (glm::vec2 const &p : bullets.positions) {
+			into.emplace_back(quantize(p.x, NET_POSITION_SCALE));
+			into.emplace_back(quantize(p.y, NET_POSITION_SCALE));
+		}
+	};
+	capture_bullets(game.player_bullets, player_bullets);
+	capture_bullets(game.enemy_bullets, enemy_bullets);
+}
+
+uint32_t NetView::encode(NetView const *baseline, std::vector< uint8_t > &out) const {
+	static const NetView Empty;
+	if (!baseline) baseline = &Empty;
+	size_t start = out.size();
+
+	write_varint(out, int32_t(sequence));
+	write_varint(out, int32_t(tick - baseline->tick));
+
+	//scalars: a mask of the ones that changed, then how much they changed by:
+	uint32_t changed = 0;
+	for (uint32_t s = 0; s < ScalarCount; ++s) {
+		if (scalars[s] != baseline->scalars[s]) changed |= (1u << s);
+	}
+	write_varint(out, int32_t(changed));
+	for (uint32_t s = 0; s < ScalarCount; ++s) {
+		if (changed & (1u << s)) write_varint(out, scalars[s] - baseline->scalars[s]);
+	}
+
+	//enemies: (index step << 1 | new), then [generation], then the move (from zero, if new):
+	write_varint(out, int32_t(enemies.size()));
+	auto base = baseline->enemies.begin();
+	uint32_t previous_index = 0;
+	for (Enemy const &enemy : enemies) {
+		while (base != baseline->enemies.end() && base->index < enemy.index) ++base;
+		bool known = (base != baseline->enemies.end() && base->index == enemy.index && base->generation == enemy.generation);
+		write_varint(out, int32_t(((enemy.index - previous_index) << 1) | (known ? 0 : 1)));
+		previous_index = enemy.index;
+		if (known) {
+			write_varint(out, enemy.x - base->x);
+			write_varint(out, enemy.y - base->y);
+		} else {
+			out.emplace_back(enemy.generation);
+			write_varint(out, enemy.x);
+			write_varint(out, enemy.y);
+		}
+	}
+
+	//bullets: the move from the same slot in the baseline (or from zero), as many as surely fit:
+	// (a coordinate takes at most 3 bytes)
+	size_t used = out.size() - start;
+	uint32_t room = uint32_t(used + 32 < NET_MAX_PACKET ? (NET_MAX_PACKET - used - 32) / 6 : 0);
+	uint32_t left_out = 0;
+	for (auto lists : { std::make_pair(&player_bullets, &baseline->player_bullets), std::make_pair(&enemy_bullets, &baseline->enemy_bullets) }) {
+		std::vector< int16_t > const &bullets = *lists.first;
+		std::vector< int16_t > const &base_bullets = *lists.second;
+		uint32_t count = std::min(uint32_t(bullets.size() / 2), room);
+		left_out += uint32_t(bullets.size() / 2) - count;
+		room -= count;
+		write_varint(out, int32_t(count));
+		for (uint32_t i = 0; i < 2 * count; ++i) {
+			write_varint(out, bullets[i] - (i < base_bullets.size() ? base_bullets[i] : 0));
+		}
+	}
+	return left_out;
+}
+
+void NetView::decode(NetView const *baseline, uint8_t const *data, size_t size) {
+	static const NetView Empty;
+	if (!baseline) baseline = &Empty;
+	VarintReader in{data, size};
+
+	sequence = uint32_t(in.varint());
+	tick = baseline->tick + uint32_t(in.varint());
+
+	uint32_t changed = uint32_t(in.varint());
+	for (uint32_t s = 0; s < ScalarCount; ++s) {
+		scalars[s] = baseline->scalars[s] + ((changed & (1u << s)) ? in.varint() : 0);
+	}
+
+	uint32_t enemy_count = in.count(ENTITY_CAPACITY);
+	enemies.resize(enemy_count);
+	auto base = baseline->enemies.begin();
+	uint32_t index = 0;
+	for (Enemy &enemy : enemies) {
+		int32_t step = in.varint();
+		if (step < 0) throw std::runtime_error("View has a bad enemy.");
+		index += uint32_t(step) >> 1;
+		if (index >= ENTITY_CAPACITY) throw std::runtime_error("View has a bad enemy.");
+		enemy.index = uint16_t(index);
+		if (step & 1) {
+			enemy.generation = in.byte();
+			enemy.x = int16_t(in.varint());
+			enemy.y = int16_t(in.varint());
+		} else {
+			while (base != baseline->enemies.end() && base->index < enemy.index) ++base;
+			if (base == baseline->enemies.end() || base->index != enemy.index) throw std::runtime_error("View moves an enemy its baseline doesn't have.");
+			enemy.generation = base->generation;
+			enemy.x = int16_t(base->x + in.varint());
+			enemy.y = int16_t(base->y + in.varint());
+		}
+	}
+
+	for (auto lists : { std::make_pair(&player_bullets, &baseline->player_bullets), std::make_pair(&enemy_bullets, &baseline->enemy_bullets) }) {
+		std::vector< int16_t > &bullets = *lists.first;
+		std::vector< int16_t > const &base_bullets = *lists.second;
+		uint32_t count = in.count(BULLET_CAPACITY);
+		bullets.resize(2 * count);
+		for (uint32_t i = 0; i < 2 * count; ++i) {
+			bullets[i] = int16_t((i < base_bullets.size() ? base_bullets[i] : 0) + in.varint());
+		}
+	}
+
+	if (in.offset != size) throw std::runtime_error("View has extra data at the end.");
+}
+
+void NetView::apply(NetView const *previous, RaidenGame &game) const {
+	if (!previous) previous = this;
+	auto position = [](int32_t x, int32_t y) {
+		return glm::vec2(x / NET_POSITION_SCALE, y / NET_POSITION_SCALE);
+	};
+
+	game.tick = tick;
+	game.bot_fighter = position(scalars[FighterX], scalars[FighterY]);
+	game.previous_bot_fighter = position(previous->scalars[FighterX], previous->scalars[FighterY]);
+	game.player_health = scalars[FighterHealth] / NET_HEALTH_SCALE;
+	game.wing.active = (scalars[WingActive] != 0);
+	game.wing.position = position(scalars[WingX], scalars[WingY]);
+	game.wing.previous_position = position(previous->scalars[WingX], previous->scalars[WingY]);
+	game.wing.health = scalars[WingHealth] / NET_HEALTH_SCALE;
+	game.killed_enemies_num = scalars[Kills];
+
+	game.world.clear();
+	auto before = previous->enemies.begin();
+	for (Enemy const &enemy : enemies) {
+		RaidenGame::Body body(position(enemy.x, enemy.y));
+		while (before != previous->enemies.end() && before->index < enemy.index) ++before;
+		if (before != previous->enemies.end() && before->index == enemy.index && before->generation == enemy.generation) {
+			body.previous_position = position(before->x, before->y);
+		}
+		game.world.create(body, RaidenGame::Enemy());
+	}
+
+	//bullets are matched up by slot, which is wrong for the ones moved into a dead bullet's slot
+	// -- so don't draw a bullet sliding further than it could have flown:
+	const float max_step = 0.5f;
+	auto apply_bullets = [&](std::vector< int16_t > const &now, std::vector< int16_t > const &then, Bullets &bullets) {
+		bullets.clear();
+		for (size_t i = 0; i + 1 < now.size(); i += 2) {
+			glm::vec2 at = position(now[i], now[i + 1]);
+			if (!bullets.spawn(at, glm::vec2(0.0f, 1.0f))) break;
+			if (i + 1 < then.size()) {
+				glm::vec2 was = position(then[i], then[i + 1]);
+				if (glm::length(at - was) < max_step) bullets.previous_positions.back() = was;
+			}
+		}
+	};
+	apply_bullets(player_bullets, previous->player_bullets, game.player_bullets);
+	apply_bullets(enemy_bullets, previous->enemy_bullets, game.enemy_bullets);
+}
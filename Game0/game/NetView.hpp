@@ -0,0 +1,57 @@
+#pragma once
+
+#include "RaidenGame.hpp"
+
+#include <cstdint>
+#include <vector>
+
+#define NET_POSITION_SCALE 256.0f //positions are sent as integer multiples of 1/NET_POSITION_SCALE court units
+#define NET_HEALTH_SCALE 16.0f //...and health as multiples of 1/NET_HEALTH_SCALE
+#define NET_MAX_PACKET 60000 //bytes; bullets that don't fit are left out of a view
+
+/*
+ * NetView is what a thin client needs to draw a RaidenGame (see StateServer.hpp):
+ * fighter positions and health, enemies, and bullets, with positions quantized to 16-bit
+ * integers.
+ *
+ * Views are sent as deltas against a 'baseline' view the client has acknowledged:
+ *  - scalars (fighters, health) are only sent if they changed;
+ *  - enemies are matched by entity index (+ a generation byte, so a respawn counts as new),
+ *    and send how far they moved; enemies missing from the new view are gone;
+ *  - bullets are matched by slot, and send how far they moved.
+ * Every number is a zig-zag varint, so small moves cost a byte per axis. With no baseline,
+ * everything is sent relative to zero.
+ */
+
+struct NetView {
+	uint32_t sequence = 0; //views the server had sent before this one, plus one (0 means "no view"; set by StateServer::broadcast)
+	uint32_t tick = 0; //server tick the view was taken on (goes back to 0 when the server starts a new game)
+
+	//scalars, indexed by the constants below:
+	enum : uint32_t {
+		FighterX, FighterY, FighterHealth,
+		WingX, WingY, WingHealth, WingActive,
+		Kills,
+		ScalarCount
+	};
+	int32_t scalars[ScalarCount] = {};
+
+	struct Enemy {
+		uint16_t index; //entity index
+		uint8_t generation; //(low bits of the entity's generation)
+		int16_t x, y;
+	};
+	std::vector< Enemy > enemies; //sorted by index
+	std::vector< int16_t > player_bullets, enemy_bullets; //x, y pairs, in slot order
+
+	//quantize 'game' (on the server):
+	void capture(RaidenGame const &game);
+
+	//append this view as a delta against 'baseline' (which may be null) to 'out'; returns bullets left out to fit NET_MAX_PACKET:
+	uint32_t encode(NetView const *baseline, std::vector< uint8_t > &out) const;
+	//read a view written by encode against the same 'baseline'; throws std::runtime_error on bad data:
+	void decode(NetView const *baseline, uint8_t const *data, size_t size);
+
+	//make 'game' look like this view, for drawing (on the client); previous positions come from 'previous', if given:
+	void apply(NetView const *previous, RaidenGame &game) const;
+};
@@ -0,0 +1,109 @@
+#include "Particles.hpp"
+
+#include "simd.hpp"
+
+#include <cmath>
+
+//unit vectors all around, so emitting doesn't need a sin and cos per particle:
+static const uint32_t Directions = 1024;
+static glm::vec2 const *directions() {
+	static std::vector< glm::vec2 > table = [](){
+		std::vector< glm::vec2 > ret(Directions);
+		for (uint32_t i = 0; i < Directions; ++i) {
+			float angle = i * (6.28318530718f / Directions);
+			ret[i] = glm::vec2(std::cos(angle), std::sin(angle));
+		}
+		return ret;
+	}();
+	return table.data();
+}
+
+Particles::Particles(uint32_t capacity_) : capacity(capacity_) {
+	directions(); //(build the table now, rather than in the first emit)
+	positions.resize(capacity);
+	previous_positions.resize(capacity);
+	velocities.resize(capacity);
+	ages.resize(capacity);
+	lifetimes.resize(capacity, 1.0f);
+	sizes.resize(capacity);
+	colors.resize(capacity);
+}
+
+void Particles::emit(glm::vec2 const &position, glm::vec2 const &drift, Burst const &burst) {
+	glm::vec2 const *direction = directions();
+	const float Unit = 1.0f / 16777216.0f; //(24 random bits to [0, 1))
+	for (uint32_t n = 0; n < burst.count; ++n) {
+		uint32_t i;
+		if (count == capacity) {
+			//full: the newest particle takes the oldest one's slot
+			i = first;
+			first = (first + 1 < capacity ? first + 1 : 0);
+			stats.overwritten += 1;
+		} else {
+			i = first + count;
+			if (i >= capacity) i -= capacity;
+			count += 1;
+		}
+		//one draw is plenty of bits for a direction, a speed, and a lifetime:
+		uint64_t bits = rng.next();
+		float speed = burst.speed_min + (burst.speed_max - burst.speed_min) * (float((bits >> 10) & 0xffffff) * Unit);
+		positions[i] = position;
+		previous_positions[i] = position;
+		velocities[i] = drift + speed * direction[bits % Directions];
+		ages[i] = 0.0f;
+		lifetimes[i] = burst.lifetime_min + (burst.lifetime_max - burst.lifetime_min) * (float((bits >> 34) & 0xffffff) * Unit);
+		sizes[i] = burst.size;
+		colors[i] = burst.color;
+	}
+	stats.emitted += burst.count;
+	stats.high_water = std::max(stats.high_water, count);
+}
+
+void Particles::update_span(uint32_t begin, uint32_t end, float elapsed, float drag) {
+	//positions, velocities, and ages as flat float arrays (positions and velocities are x, y pairs):
+	float *position = &positions[0].x;
+	float *previous = &previous_positions[0].x;
+	float *velocity = &velocities[0].x;
+	float *age = ages.data();
+	uint32_t i = 2 * begin;
+#ifdef SIMD_SSE2
+	//two particles per step:
+	const __m128 step = _mm_set1_ps(elapsed), slow = _mm_set1_ps(drag);
+	for (; i + 4 <= 2 * end; i += 4) {
+		__m128 p = _mm_loadu_ps(position + i), v = _mm_loadu_ps(velocity + i);
+		_mm_storeu_ps(previous + i, p);
+		_mm_storeu_ps(position + i, _mm_add_ps(p, _mm_mul_ps(v, step)));
+		_mm_storeu_ps(velocity + i, _mm_mul_ps(v, slow));
+	}
+	for (uint32_t a = begin; a + 4 <= end; a += 4) {
+		_mm_storeu_ps(age + a, _mm_add_ps(_mm_loadu_ps(age + a), step));
+	}
+	for (uint32_t a = end - (end - begin) % 4; a < end; ++a) {
+		age[a] += elapsed;
+	}
+#else
+	for (uint32_t a = begin; a < end; ++a) {
+		age[a] += elapsed;
+	}
+#endif
+	for (; i < 2 * end; ++i) {
+		previous[i] = position[i];
+		position[i] += velocity[i] * elapsed;
+		velocity[i] *= drag;
+	}
+}
+
+void Particles::update(float elapsed) {
+	if (count == 0) return;
+	float drag = std::exp(-PARTICLE_DRAG * elapsed);
+	uint32_t end = first + count;
+	update_span(first, std::min(end, capacity), elapsed, drag);
+	if (end > capacity) update_span(0, end - capacity, elapsed, drag);
+
+	//retire burnt-out particles from the tail:
+	while (count != 0 && ages[first] >= lifetimes[first]) {
+		first = (first + 1 < capacity ? first + 1 : 0);
+		count -= 1;
+	}
+	if (count == 0) first = 0;
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "Rng.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#define PARTICLE_CAPACITY 32768
+#define PARTICLE_DRAG 3.0f //fraction of a particle's speed lost per second, roughly (exponential)
+
+/*
+ * Particles is a fixed-size ring of short-lived, purely visual particles (sparks and debris),
+ * stored as a structure of arrays.
+ *
+ * Particles are written at the head of the ring in the order they are emitted, and retired from
+ * the tail once the oldest has burned out; a particle that dies before the ones ahead of it just
+ * stays put (skipped when drawing) until it reaches the tail. When the ring is full, new particles
+ * overwrite the oldest ones -- so a big burst never fails or allocates; it just cuts old effects short.
+ *
+ * All storage is allocated by the constructor. update() is one pass over the live span of each array,
+ * and write_quads() expands every visible particle into a vertex array in one go.
+ *
+ * Particles aren't part of the game state (they don't affect play, and aren't saved), so they can
+ * use their own random numbers freely.
+ */
+
+struct Particles {
+	explicit Particles(uint32_t capacity = PARTICLE_CAPACITY);
+
+	//what emit() sprays out:
+	struct Burst {
+		uint32_t count = 16;
+		float speed_min = 0.5f, speed_max = 3.0f; //units per second, in a random direction
+		float lifetime_min = 0.2f, lifetime_max = 0.6f; //seconds
+		float size = 0.03f; //half-width, shrinking to nothing over the particle's life
+		glm::u8vec4 color = glm::u8vec4(0xff); //fading to transparent over the particle's life
+	};
+
+	//add 'burst.count' particles at 'position', all also moving with 'drift':
+	void emit(glm::vec2 const &position, glm::vec2 const &drift, Burst const &burst);
+
+	//advance every particle by 'elapsed' seconds, and retire the burnt-out ones at the tail:
+	void update(float elapsed);
+
+	//live span of the ring (some may have burned out; see above):
+	uint32_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	void clear() { first = count = 0; }
+
+	//write two triangles (six vertices) for each visible particle into 'out', drawn 'alpha' of the way from
+	// its last position to its current one; 'out' needs room for 6 * size() vertices. Returns the vertices written.
+	template< typename Vertex >
+	uint32_t write_quads(Vertex *out, float alpha) const;
+
+	//per-particle state (all arrays are 'capacity' long; the live span is [first, first + count), wrapping around):
+	std::vector< glm::vec2 > positions;
+	std::vector< glm::vec2 > previous_positions; //positions as of the last update (for drawing between updates)
+	std::vector< glm::vec2 > velocities;
+	std::vector< float > ages; //seconds since emitted
+	std::vector< float > lifetimes; //seconds (burnt out when age reaches this)
+	std::vector< float > sizes;
+	std::vector< glm::u8vec4 > colors;
+
+	uint32_t capacity;
+	uint32_t first = 0; //oldest particle
+	uint32_t count = 0;
+
+	struct Stats {
+		uint64_t emitted = 0;
+		uint64_t overwritten = 0; //cut short because the ring was full
+		uint32_t high_water = 0; //largest size()
+	} stats;
+
+	Rng rng = Rng(0x5a7c1e5);
+
+private:
+	void update_span(uint32_t begin, uint32_t end, float elapsed, float drag);
+	template< typename Vertex >
+	uint32_t write_span(uint32_t begin, uint32_t end, float alpha, Vertex *out) const;
+};
+
+template< typename Vertex >
+uint32_t Particles::write_quads(Vertex *out, float alpha) const {
+	uint32_t end = first + count;
+	uint32_t written = write_span(first, std::min(end, capacity), alpha, out);
+	if (end > capacity) written += write_span(0, end - capacity, alpha, out + written);
+	return written;
+}
+
+template< typename Vertex >
+uint32_t Particles::write_span(uint32_t begin, uint32_t end, float alpha, Vertex *out) const {
+	//(fields are written one at a time: building whole Vertex temporaries made the compiler assemble
+	// each one on the stack and copy it out, which cost several times more than the math)
+	Vertex *at = out;
+	for (uint32_t i = begin; i < end; ++i) {
+		float left = 1.0f - ages[i] / lifetimes[i];
+		if (left <= 0.0f) continue;
+		glm::vec2 center = glm::mix(previous_positions[i], positions[i], alpha);
+		float r = sizes[i] * left;
+		glm::u8vec4 color = colors[i];
+		color.a = uint8_t(color.a * left);
+		glm::vec3 const lo(center.x - r, center.y - r, 0.0f), hi(center.x + r, center.y + r, 0.0f);
+		//two CCW-oriented triangles, like RaidenMode's rectangles:
+		at[0].Position = lo;
+		at[1].Position = glm::vec3(hi.x, lo.y, 0.0f);
+		at[2].Position = hi;
+		at[3].Position = lo;
+		at[4].Position = hi;
+		at[5].Position = glm::vec3(lo.x, hi.y, 0.0f);
+		for (uint32_t k = 0; k < 6; ++k) {
+			at[k].Color = color;
+			at[k].TexCoord = glm::vec2(0.5f, 0.5f);
+		}
+		at += 6;
+	}
+	return uint32_t(at - out);
+}
@@ -3,10 +3,19 @@
 //for the GL_ERRORS() macro:
 #include "gl_errors.hpp"
 
+//for per-frame scratch memory:
+#include "FrameArena.hpp"
+//for streaming vertices:
+#include "StreamBuffer.hpp"
+
 //for glm::value_ptr() :
 #include <glm/gtc/type_ptr.hpp>
 
-#include <random>
+#include "ByteStream.hpp"
+
+#include <array>
+#include <cassert>
+#include <cstring>
 
 PongMode::PongMode() {
 
@@ -18,59 +27,16 @@ PongMode::PongMode() {
 	
 	//----- allocate OpenGL resources -----
 	{ //vertex buffer:
-		glGenBuffers(1, &vertex_buffer);
-		//for now, buffer will be un-filled.
-
-		GL_ERRORS(); //PARANOIA: print out any OpenGL errors that may have happened
+		//(vertices are streamed through Mode::vertex_stream, which every mode shares; see StreamBuffer.hpp)
+		vertex_buffer = Mode::vertex_stream->buffer;
+		vertex_generation = Mode::vertex_stream->generation;
 	}
 
 	{ //vertex array mapping buffer for color_texture_program:
 		//ask OpenGL to fill vertex_buffer_for_color_texture_program with the name of an unused vertex array object:
 		glGenVertexArrays(1, &vertex_buffer_for_color_texture_program);
 
-		//set vertex_buffer_for_color_texture_program as the current vertex array object:
-		glBindVertexArray(vertex_buffer_for_color_texture_program);
-
-		//set vertex_buffer as the source of glVertexAttribPointer() commands:
-		glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
-
-		//set up the vertex array object to describe arrays of PongMode::Vertex:
-		glVertexAttribPointer(
-			color_texture_program.Position_vec4, //attribute
-			3, //size
-			GL_FLOAT, //type
-			GL_FALSE, //normalized
-			sizeof(Vertex), //stride
-			(GLbyte *)0 + 0 //offset
-		);
-		glEnableVertexAttribArray(color_texture_program.Position_vec4);
-		//[Note that it is okay to bind a vec3 input to a vec4 attribute -- the w component will be filled with 1.0 automatically]
-
-		glVertexAttribPointer(
-			color_texture_program.Color_vec4, //attribute
-			4, //size
-			GL_UNSIGNED_BYTE, //type
-			GL_TRUE, //normalized
-			sizeof(Vertex), //stride
-			(GLbyte *)0 + 4*3 //offset
-		);
-		glEnableVertexAttribArray(color_texture_program.Color_vec4);
-
-		glVertexAttribPointer(
-			color_texture_program.TexCoord_vec2, //attribute
-			2, //size
-			GL_FLOAT, //type
-			GL_FALSE, //normalized
-			sizeof(Vertex), //stride
-			(GLbyte *)0 + 4*3 + 4*1 //offset
-		);
-		glEnableVertexAttribArray(color_texture_program.TexCoord_vec2);
-
-		//done referring to vertex_buffer, so unbind it:
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-		//done setting up vertex array object, so unbind it:
-		glBindVertexArray(0);
+		point_vertex_array();
 
 		GL_ERRORS(); //PARANOIA: print out any OpenGL errors that may have happened
 	}
@@ -104,11 +70,56 @@ PongMode::PongMode() {
 	}
 }
 
+void PongMode::point_vertex_array() {
+	//set vertex_buffer_for_color_texture_program as the current vertex array object:
+	glBindVertexArray(vertex_buffer_for_color_texture_program);
+
+	//set vertex_buffer as the source of glVertexAttribPointer() commands:
+	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+
+	//set up the vertex array object to describe arrays of PongMode::Vertex:
+	glVertexAttribPointer(
+		color_texture_program.Position_vec4, //attribute
+		3, //size
+		GL_FLOAT, //type
+		GL_FALSE, //normalized
+		sizeof(Vertex), //stride
+		(GLbyte *)0 + 0 //offset
+	);
+	glEnableVertexAttribArray(color_texture_program.Position_vec4);
+	//[Note that it is okay to bind a vec3 input to a vec4 attribute -- the w component will be filled with 1.0 automatically]
+
+	glVertexAttribPointer(
+		color_texture_program.Color_vec4, //attribute
+		4, //size
+		GL_UNSIGNED_BYTE, //type
+		GL_TRUE, //normalized
+		sizeof(Vertex), //stride
+		(GLbyte *)0 + 4*3 //offset
+	);
+	glEnableVertexAttribArray(color_texture_program.Color_vec4);
+
+	glVertexAttribPointer(
+		color_texture_program.TexCoord_vec2, //attribute
+		2, //size
+		GL_FLOAT, //type
+		GL_FALSE, //normalized
+		sizeof(Vertex), //stride
+		(GLbyte *)0 + 4*3 + 4*1 //offset
+	);
+	glEnableVertexAttribArray(color_texture_program.TexCoord_vec2);
+
+	//done referring to vertex_buffer, so unbind it:
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	//done setting up vertex array object, so unbind it:
+	glBindVertexArray(0);
+}
+
 PongMode::~PongMode() {
 
 	//----- free OpenGL resources -----
-	glDeleteBuffers(1, &vertex_buffer);
-	vertex_buffer = 0;
+	vertex_buffer = 0; //(belongs to Mode::vertex_stream)
 
 	glDeleteVertexArrays(1, &vertex_buffer_for_color_texture_program);
 	vertex_buffer_for_color_texture_program = 0;
@@ -133,7 +144,8 @@ bool PongMode::handle_event(SDL_Event const &evt, glm::uvec2 const &window_size)
 
 void PongMode::update(float elapsed) {
 
-	static std::mt19937 mt; //mersenne twister pseudo-random number generator
+	previous_right_paddle = right_paddle;
+	previous_ball = ball;
 
 	//----- paddle update -----
 
@@ -141,8 +153,8 @@ void PongMode::update(float elapsed) {
 		ai_offset_update -= elapsed;
 		if (ai_offset_update < elapsed) {
 			//update again in [0.5,1.0) seconds:
-			ai_offset_update = (mt() / float(mt.max())) * 0.5f + 0.5f;
-			ai_offset = (mt() / float(mt.max())) * 2.5f - 1.25f;
+			ai_offset_update = ai_rng.uniform(0.5f, 1.0f);
+			ai_offset = ai_rng.uniform(-1.25f, 1.25f);
 		}
 		if (right_paddle.y < ball.y + ai_offset) {
 			right_paddle.y = std::min(ball.y + ai_offset, right_paddle.y + 2.0f * elapsed);
@@ -250,17 +262,99 @@ void PongMode::update(float elapsed) {
 	}
 }
 
+//------ snapshots ------
+
+static const uint32_t SnapshotMagic = 0x54534750; //"PGST"
+static const uint32_t SnapshotVersion = 1;
+
+bool PongMode::save_snapshot(std::vector< uint8_t > &bytes) const {
+	ByteWriter out(bytes);
+	out.write(SnapshotMagic);
+	out.write(SnapshotVersion);
+
+	out.write(court_radius);
+	out.write(paddle_radius);
+	out.write(ball_radius);
+	out.write(left_paddle);
+	out.write(right_paddle);
+	out.write(ball);
+	out.write(ball_velocity);
+	out.write(previous_right_paddle);
+	out.write(previous_ball);
+	out.write(left_score);
+	out.write(right_score);
+	out.write(ai_offset);
+	out.write(ai_offset_update);
+	out.write(ai_rng.key);
+	out.write(ai_rng.counter);
+
+	out.write(trail_length);
+	out.write(uint32_t(ball_trail.size()));
+	for (glm::vec3 const &t : ball_trail) {
+		out.write(t);
+	}
+	return true;
+}
+
+void PongMode::load_snapshot(uint8_t const *data, size_t size) {
+	ByteReader in(data, size);
+	if (in.read< uint32_t >() != SnapshotMagic) throw std::runtime_error("Not a PongMode snapshot.");
+	uint32_t version = in.read< uint32_t >();
+	if (version != SnapshotVersion) {
+		throw std::runtime_error("PongMode snapshot has version " + std::to_string(version) + "; expecting " + std::to_string(SnapshotVersion) + ".");
+	}
+
+	//everything before the trail has a fixed size, so the whole snapshot's size can be checked
+	// before anything changes (a bad snapshot then leaves the game as it was):
+	size_t const fields = sizeof(court_radius) + sizeof(paddle_radius) + sizeof(ball_radius)
+		+ sizeof(left_paddle) + sizeof(right_paddle) + sizeof(ball) + sizeof(ball_velocity)
+		+ sizeof(previous_right_paddle) + sizeof(previous_ball) + sizeof(left_score) + sizeof(right_score)
+		+ sizeof(ai_offset) + sizeof(ai_offset_update) + sizeof(ai_rng.key) + sizeof(ai_rng.counter)
+		+ sizeof(trail_length);
+	if (size - in.offset < fields + sizeof(uint32_t)) throw std::runtime_error("PongMode snapshot ends early.");
+	uint32_t trail_size;
+	std::memcpy(&trail_size, data + in.offset + fields, sizeof(trail_size));
+	if (size - in.offset - fields - sizeof(uint32_t) != trail_size * sizeof(glm::vec3)) {
+		throw std::runtime_error("PongMode snapshot's trail doesn't match its size.");
+	}
+
+	in.read(court_radius);
+	in.read(paddle_radius);
+	in.read(ball_radius);
+	in.read(left_paddle);
+	in.read(right_paddle);
+	in.read(ball);
+	in.read(ball_velocity);
+	in.read(previous_right_paddle);
+	in.read(previous_ball);
+	in.read(left_score);
+	in.read(right_score);
+	in.read(ai_offset);
+	in.read(ai_offset_update);
+	in.read(ai_rng.key);
+	in.read(ai_rng.counter);
+
+	in.read(trail_length);
+	in.read< uint32_t >(); //(trail_size, checked above)
+	//overwrite the trail in place (it is about the same length from one snapshot to the next, so this doesn't allocate):
+	ball_trail.resize(trail_size);
+	for (glm::vec3 &t : ball_trail) {
+		in.read(t);
+	}
+	assert(in.done());
+}
+
 void PongMode::draw(glm::uvec2 const &drawable_size) {
 	//some nice colors from the course web page:
 	#define HEX_TO_U8VEC4( HX ) (glm::u8vec4( (HX >> 24) & 0xff, (HX >> 16) & 0xff, (HX >> 8) & 0xff, (HX) & 0xff ))
 	const glm::u8vec4 bg_color = HEX_TO_U8VEC4(0x193b59ff);
 	const glm::u8vec4 fg_color = HEX_TO_U8VEC4(0xf2d2b6ff);
 	const glm::u8vec4 shadow_color = HEX_TO_U8VEC4(0xf2ad94ff);
-	const std::vector< glm::u8vec4 > trail_colors = {
+	static const std::array< glm::u8vec4, 3 > trail_colors = {{
 		HEX_TO_U8VEC4(0xf2ad9488),
 		HEX_TO_U8VEC4(0xf2897288),
 		HEX_TO_U8VEC4(0xbacac088),
-	};
+	}};
 	#undef HEX_TO_U8VEC4
 
 	//other useful drawing constants:
@@ -271,7 +365,10 @@ void PongMode::draw(glm::uvec2 const &drawable_size) {
 	//---- compute vertices to draw ----
 
 	//vertices will be accumulated into this list and then uploaded+drawn at the end of this function:
-	std::vector< Vertex > vertices;
+	// (it lives in the frame arena, with room for every rectangle up front: 4 walls, 2 paddles, and
+	//  a ball, each with a shadow, plus the trail and the scores)
+	FrameVector< Vertex > vertices{FrameAllocator< Vertex >(*Mode::frame_arena)};
+	vertices.reserve(6 * (14 + 20 + left_score + right_score));
 
 	//inline helper function for rectangle drawing:
 	auto draw_rectangle = [&vertices](glm::vec2 const &center, glm::vec2 const &radius, glm::u8vec4 const &color) {
@@ -285,6 +382,10 @@ void PongMode::draw(glm::uvec2 const &drawable_size) {
 		vertices.emplace_back(glm::vec3(center.x-radius.x, center.y+radius.y, 0.0f), color, glm::vec2(0.5f, 0.5f));
 	};
 
+	//interpolate moving objects between the last two ticks:
+	glm::vec2 right_paddle_at = glm::mix(previous_right_paddle, right_paddle, render_alpha);
+	glm::vec2 ball_at = glm::mix(previous_ball, ball, render_alpha);
+
 	//shadows for everything (except the trail):
 
 	glm::vec2 s = glm::vec2(0.0f,-shadow_offset);
@@ -294,8 +395,8 @@ void PongMode::draw(glm::uvec2 const &drawable_size) {
 	draw_rectangle(glm::vec2( 0.0f,-court_radius.y-wall_radius)+s, glm::vec2(court_radius.x, wall_radius), shadow_color);
 	draw_rectangle(glm::vec2( 0.0f, court_radius.y+wall_radius)+s, glm::vec2(court_radius.x, wall_radius), shadow_color);
 	draw_rectangle(left_paddle+s, paddle_radius, shadow_color);
-	draw_rectangle(right_paddle+s, paddle_radius, shadow_color);
-	draw_rectangle(ball+s, ball_radius, shadow_color);
+	draw_rectangle(right_paddle_at+s, paddle_radius, shadow_color);
+	draw_rectangle(ball_at+s, ball_radius, shadow_color);
 
 	//ball's trail:
 	if (ball_trail.size() >= 2) {
@@ -351,11 +452,11 @@ void PongMode::draw(glm::uvec2 const &drawable_size) {
 
 	//paddles:
 	draw_rectangle(left_paddle, paddle_radius, fg_color);
-	draw_rectangle(right_paddle, paddle_radius, fg_color);
+	draw_rectangle(right_paddle_at, paddle_radius, fg_color);
 	
 
 	//ball:
-	draw_rectangle(ball, ball_radius, fg_color);
+	draw_rectangle(ball_at, ball_radius, fg_color);
 
 	//scores:
 	glm::vec2 score_radius = glm::vec2(0.1f, 0.1f);
@@ -421,10 +522,14 @@ void PongMode::draw(glm::uvec2 const &drawable_size) {
 	//don't use the depth test:
 	glDisable(GL_DEPTH_TEST);
 
-	//upload vertices to vertex_buffer:
-	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer); //set vertex_buffer as current
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(vertices[0]), vertices.data(), GL_STREAM_DRAW); //upload vertices array
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	//upload vertices into this frame's part of the vertex stream:
+	size_t first = Mode::vertex_stream->upload(vertices.data(), vertices.size() * sizeof(vertices[0]), sizeof(vertices[0])) / sizeof(vertices[0]);
+	if (vertex_generation != Mode::vertex_stream->generation) {
+		//the stream moved to a bigger buffer, so the vertex array needs to read from that one:
+		vertex_buffer = Mode::vertex_stream->buffer;
+		vertex_generation = Mode::vertex_stream->generation;
+		point_vertex_array();
+	}
 
 	//set color_texture_program as current program:
 	glUseProgram(color_texture_program.program);
@@ -440,7 +545,7 @@ void PongMode::draw(glm::uvec2 const &drawable_size) {
 	glBindTexture(GL_TEXTURE_2D, white_tex);
 
 	//run the OpenGL pipeline:
-	glDrawArrays(GL_TRIANGLES, 0, GLsizei(vertices.size()));
+	glDrawArrays(GL_TRIANGLES, GLint(first), GLsizei(vertices.size()));
 
 	//unbind the solid white texture:
 	glBindTexture(GL_TEXTURE_2D, 0);
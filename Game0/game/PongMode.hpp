@@ -2,6 +2,7 @@
 
 #include "Mode.hpp"
 #include "GL.hpp"
+#include "Rng.hpp"
 
 #include <glm/glm.hpp>
 
@@ -21,6 +22,9 @@ struct PongMode : Mode {
 	virtual void update(float elapsed) override;
 	virtual void draw(glm::uvec2 const &drawable_size) override;
 
+	virtual bool save_snapshot(std::vector< uint8_t > &out) const override;
+	virtual void load_snapshot(uint8_t const *data, size_t size) override;
+
 	//----- game state -----
 
 	glm::vec2 court_radius = glm::vec2(7.0f, 5.0f);
@@ -33,11 +37,17 @@ struct PongMode : Mode {
 	glm::vec2 ball = glm::vec2(0.0f, 0.0f);
 	glm::vec2 ball_velocity = glm::vec2(-1.0f, 0.0f);
 
+	//state as of the previous tick, so draw() can interpolate using render_alpha:
+	// (the left paddle follows the mouse directly, so it isn't interpolated)
+	glm::vec2 previous_right_paddle = right_paddle;
+	glm::vec2 previous_ball = ball;
+
 	uint32_t left_score = 0;
 	uint32_t right_score = 0;
 
 	float ai_offset = 0.0f;
 	float ai_offset_update = 0.0f;
+	Rng ai_rng; //(part of the state, so snapshots replay the same AI)
 
 	//----- pretty gradient trails -----
 
@@ -59,11 +69,13 @@ struct PongMode : Mode {
 	//Shader program that draws transformed, vertices tinted with vertex colors:
 	ColorTextureProgram color_texture_program;
 
-	//Buffer used to hold vertex data during drawing:
+	//Buffer used to hold vertex data during drawing (Mode::vertex_stream's, as of the last draw):
 	GLuint vertex_buffer = 0;
+	uint32_t vertex_generation = 0; //Mode::vertex_stream->generation when vertex_buffer was taken
 
 	//Vertex Array Object that maps buffer locations to color_texture_program attribute locations:
 	GLuint vertex_buffer_for_color_texture_program = 0;
+	void point_vertex_array(); //(re)point it at vertex_buffer
 
 	//Solid white texture:
 	GLuint white_tex = 0;
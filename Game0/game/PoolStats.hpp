@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+
+/*
+ * PoolStats counts usage of a fixed-capacity container (Bullets, RouteTable, World):
+ * how full it is, how full it has ever been, and how often it had to refuse.
+ */
+
+struct PoolStats {
+	uint32_t capacity = 0;
+	uint32_t live = 0; //objects currently acquired
+	uint32_t high_water = 0; //most objects ever live at once
+	uint32_t acquired = 0; //total successful acquires
+	uint32_t failed = 0; //acquires refused because the container was full
+
+	void on_acquire() {
+		live += 1;
+		acquired += 1;
+		if (live > high_water) high_water = live;
+	}
+	void on_release() {
+		assert(live > 0);
+		live -= 1;
+	}
+};
@@ -0,0 +1,758 @@
+#include "RaidenGame.hpp"
+
+#include "aabb_overlap.hpp"
+#include "enemy_steering.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+RaidenGame::RaidenGame(uint64_t seed_) {
+	//(registration order fixes the component ids, which saved state depends on)
+	world.component< Body >();
+	world.component< RouteFollower >();
+	world.component< Gun >();
+	world.component< Enemy >();
+	world.component< Emitter >();
+
+	patterns = builtin_patterns();
+	patterns_hash = hash_patterns(patterns);
+	shots.reserve(ENTITY_CAPACITY);
+	impacts.reserve(IMPACT_CAPACITY);
+
+	reset(seed_);
+}
+
+void RaidenGame::reset(uint64_t seed_) {
+	seed = seed_;
+	rng = Rng(seed_);
+	tick = 0;
+	routes_made = 0;
+	fighter_radius = glm::vec2(0.2f, 0.4f);
+	bot_fighter = glm::vec2(0.0f, -COURT_RADIUS.y + 0.5f);
+	previous_bot_fighter = bot_fighter;
+	player_collision_box = glm::vec4(0);
+	curr_status = EventStatus::none;
+	route_change_counter = 0;
+	killed_enemies_num = 0;
+	game_difficulty_mode = 1.0f;
+	curr_player_shoot_cool_down = PLAYER_SHOOT_COOLDOWN;
+	curr_enemy_spawn_cool_down = ENEMY_SPAWN_COOL_DOWN;
+	player_health = PLAYER_HEALTH;
+	wing = Wing();
+	waves_spawned = 0;
+	impacts.clear();
+
+	player_bullets.clear();
+	enemy_bullets.clear();
+	world.reset();
+	enemy_grid.clear();
+	routes.clear();
+	curr_route = random_route();
+}
+
+void RaidenGame::add_wing() {
+	//the two fighters start side by side:
+	bot_fighter.x = -1.0f;
+	previous_bot_fighter = bot_fighter;
+	wing = Wing();
+	wing.active = true;
+	wing.position = glm::vec2(1.0f, bot_fighter.y);
+	wing.previous_position = wing.position;
+}
+
+uint32_t RaidenGame::random_route() {
+	Rng route_rng = rng.stream(uint64_t(RngStream::Routes)).stream(routes_made++);
+	glm::vec2 points[ROUTE_MAX_POINTS];
+	uint32_t length = route_rng.below(5) + 10;
+	static_assert(4 + 10 <= ROUTE_MAX_POINTS, "random routes must fit in the route table");
+	for (uint32_t i = 0; i < length; i++)
+	{
+		float x = route_rng.below(100) * 0.01f * COURT_RADIUS.x * 2 - COURT_RADIUS.x;
+		float y = route_rng.below(100) * 0.01f * COURT_RADIUS.y;
+		points[i] = glm::vec2(x, y);
+	}
+	return routes.add(points, length);
+}
+
+Entity RaidenGame::spawn_enemy(glm::vec2 const &position, uint32_t route, float health) {
+	if (!wave_patterns.empty()) {
+		Entity e = spawn_emitter(position, route, health, wave_patterns[waves_spawned % wave_patterns.size()]);
+		if (e.valid()) waves_spawned += 1;
+		return e;
+	}
+	if (route == -1U) return Entity();
+	Enemy enemy;
+	enemy.health = health;
+	Entity e = world.create(Body(position), RouteFollower(position, route), Gun(), enemy);
+	if (e.valid()) routes.retain(route);
+	return e;
+}
+
+Entity RaidenGame::spawn_emitter(glm::vec2 const &position, uint32_t route, float health, uint32_t pattern) {
+	if (route == -1U || pattern >= patterns.size()) return Entity();
+	Enemy enemy;
+	enemy.health = health;
+	Emitter emitter;
+	emitter.pattern = pattern;
+	emitter.wait = patterns[pattern].delay;
+	Entity e = world.create(Body(position), RouteFollower(position, route), emitter, enemy);
+	if (e.valid()) routes.retain(route);
+	return e;
+}
+
+uint32_t RaidenGame::add_pattern(Pattern const &pattern) {
+	patterns.emplace_back(pattern);
+	patterns_hash = hash_patterns(patterns);
+	return uint32_t(patterns.size() - 1);
+}
+
+void RaidenGame::start_waves(std::vector< Pattern > const &custom) {
+	wave_patterns.clear();
+	for (Pattern const &pattern : custom) {
+		wave_patterns.emplace_back(add_pattern(pattern));
+	}
+	if (wave_patterns.empty()) {
+		for (uint32_t p = 0; p < patterns.size(); ++p) {
+			wave_patterns.emplace_back(p);
+		}
+	}
+}
+
+void RaidenGame::kill_enemy(Entity const &enemy) {
+	enemy_grid.remove(enemy.index);
+	routes.release(world.get< RouteFollower >(enemy)->route);
+	world.destroy(enemy);
+}
+
+//------ saved state ------
+
+static const uint32_t StateMagic = 0x54534752; //"RGST"
+static const uint32_t StateVersion = 6; //2: enemies are entities in 'world'; 3: wing; 4: bullet patterns; 5: entity generations; 6: pattern table hash
+
+void RaidenGame::save_state(std::vector< uint8_t > &bytes) const {
+	ByteWriter out(bytes);
+	out.write(StateMagic);
+	out.write(StateVersion);
+
+	out.write(seed);
+	out.write(rng.key);
+	out.write(rng.counter);
+	out.write(tick);
+	out.write(routes_made);
+
+	out.write(fighter_radius);
+	out.write(bot_fighter);
+	out.write(previous_bot_fighter);
+	out.write(player_collision_box);
+	out.write(curr_status);
+	out.write(route_change_counter);
+	out.write(killed_enemies_num);
+	out.write(game_difficulty_mode);
+	out.write(curr_player_shoot_cool_down);
+	out.write(curr_enemy_spawn_cool_down);
+	out.write(player_health);
+	out.write(uint8_t(wing.active));
+	out.write(wing.status);
+	out.write(wing.position);
+	out.write(wing.previous_position);
+	out.write(wing.collision_box);
+	out.write(wing.shoot_cool_down);
+	out.write(wing.health);
+
+	//the pattern table hardly ever changes, so it goes with its hash and size, and loads skip it when they already have it:
+	out.write(patterns_hash);
+	size_t table_at = bytes.size();
+	out.write(uint32_t(0)); //(table size, filled in below)
+	out.write(uint32_t(patterns.size()));
+	for (Pattern const &pattern : patterns) {
+		pattern.save(out);
+	}
+	uint32_t table_size = uint32_t(bytes.size() - table_at - sizeof(uint32_t));
+	std::memcpy(&bytes[table_at], &table_size, sizeof(table_size));
+	out.write_vector(wave_patterns);
+	out.write(waves_spawned);
+
+	routes.save(out);
+	out.write(curr_route);
+
+	player_bullets.save(out);
+	enemy_bullets.save(out);
+
+	//(the grid is rebuilt from the entities on load)
+	world.save(out);
+}
+
+void RaidenGame::load_state(uint8_t const *data, size_t size) {
+	if (!loading) loading.reset(new RaidenGame(seed));
+	loading->read_state(data, size);
+	swap_state(*loading);
+}
+
+void RaidenGame::swap_state(RaidenGame &other) {
+	std::swap(seed, other.seed);
+	std::swap(rng, other.rng);
+	std::swap(tick, other.tick);
+	std::swap(routes_made, other.routes_made);
+
+	std::swap(fighter_radius, other.fighter_radius);
+	std::swap(bot_fighter, other.bot_fighter);
+	std::swap(previous_bot_fighter, other.previous_bot_fighter);
+	std::swap(player_collision_box, other.player_collision_box);
+	std::swap(curr_status, other.curr_status);
+	std::swap(route_change_counter, other.route_change_counter);
+	std::swap(killed_enemies_num, other.killed_enemies_num);
+	std::swap(game_difficulty_mode, other.game_difficulty_mode);
+	std::swap(curr_player_shoot_cool_down, other.curr_player_shoot_cool_down);
+	std::swap(curr_enemy_spawn_cool_down, other.curr_enemy_spawn_cool_down);
+	std::swap(player_health, other.player_health);
+	std::swap(wing, other.wing);
+
+	std::swap(patterns, other.patterns);
+	std::swap(patterns_hash, other.patterns_hash);
+	std::swap(wave_patterns, other.wave_patterns);
+	std::swap(waves_spawned, other.waves_spawned);
+
+	std::swap(routes, other.routes);
+	std::swap(curr_route, other.curr_route);
+
+	std::swap(player_bullets, other.player_bullets);
+	std::swap(enemy_bullets, other.enemy_bullets);
+
+	std::swap(world, other.world);
+	std::swap(enemy_grid, other.enemy_grid);
+}
+
+void RaidenGame::read_state(uint8_t const *data, size_t size) {
+	ByteReader in(data, size);
+	if (in.read< uint32_t >() != StateMagic) throw std::runtime_error("Not saved RaidenGame state.");
+	uint32_t version = in.read< uint32_t >();
+	if (version < 2 || version > StateVersion) {
+		throw std::runtime_error("Saved RaidenGame state has version " + std::to_string(version) + "; expecting " + std::to_string(StateVersion) + ".");
+	}
+
+	in.read(seed);
+	in.read(rng.key);
+	in.read(rng.counter);
+	in.read(tick);
+	in.read(routes_made);
+
+	in.read(fighter_radius);
+	in.read(bot_fighter);
+	in.read(previous_bot_fighter);
+	in.read(player_collision_box);
+	in.read(curr_status);
+	in.read(route_change_counter);
+	in.read(killed_enemies_num);
+	in.read(game_difficulty_mode);
+	in.read(curr_player_shoot_cool_down);
+	in.read(curr_enemy_spawn_cool_down);
+	in.read(player_health);
+	if (version >= 3) {
+		wing.active = (in.read< uint8_t >() != 0);
+		in.read(wing.status);
+		in.read(wing.position);
+		in.read(wing.previous_position);
+		in.read(wing.collision_box);
+		in.read(wing.shoot_cool_down);
+		in.read(wing.health);
+	} else {
+		wing = Wing();
+	}
+	auto read_patterns = [this](ByteReader &from) {
+		uint32_t count = from.read< uint32_t >();
+		if (count > ENTITY_CAPACITY) throw std::runtime_error("Saved state has too many bullet patterns.");
+		patterns.resize(count);
+		for (Pattern &pattern : patterns) {
+			pattern.load(from);
+		}
+		patterns_hash = hash_patterns(patterns);
+	};
+	if (version >= 6) {
+		uint64_t hash = in.read< uint64_t >();
+		uint32_t table_size = in.read< uint32_t >();
+		if (table_size > size - in.offset) throw std::runtime_error("Saved state ends in its bullet patterns.");
+		if (hash != patterns_hash) {
+			ByteReader table(data + in.offset, table_size);
+			read_patterns(table);
+			if (!table.done() || patterns_hash != hash) throw std::runtime_error("Saved bullet patterns don't match their hash.");
+		}
+		in.offset += table_size;
+	} else if (version >= 4) {
+		read_patterns(in);
+	} else {
+		patterns = builtin_patterns();
+		patterns_hash = hash_patterns(patterns);
+	}
+	if (version >= 4) {
+		in.read_vector(wave_patterns, patterns.size());
+		in.read(waves_spawned);
+		for (uint32_t index : wave_patterns) {
+			if (index >= patterns.size()) throw std::runtime_error("Saved state has waves of a missing pattern.");
+		}
+	} else {
+		wave_patterns.clear();
+		waves_spawned = 0;
+	}
+
+	routes.load(in);
+	in.read(curr_route);
+
+	player_bullets.load(in);
+	enemy_bullets.load(in);
+
+	world.load(in, version >= 5);
+
+	//routes are looked up by id without checks, so every reference has to be to a live route -- and counted,
+	// or releasing them later would free a route still in use (or one already free):
+	bool bad_route = false;
+	std::fill(route_references.begin(), route_references.end(), 0);
+	auto refer = [&](uint32_t route) {
+		if (route < routes.capacity()) route_references[route] += 1;
+		else bad_route = true;
+	};
+	if (curr_route != -1U) refer(curr_route);
+	world.each< RouteFollower >([&](Entity const &, RouteFollower const &follower) {
+		refer(follower.route);
+	});
+	for (uint32_t id = 0; id < routes.capacity(); ++id) {
+		if (route_references[id] != routes.references(id)) bad_route = true;
+	}
+	if (bad_route) throw std::runtime_error("Saved state has routes that don't match their users.");
+
+	enemy_grid.clear();
+	world.each< Enemy, Body >([this](Entity const &e, Enemy const &, Body const &body) {
+		enemy_grid.update(e.index, body.position);
+	});
+	bool bad_emitter = false;
+	world.each< Emitter >([&](Entity const &, Emitter const &emitter) {
+		if (emitter.pattern >= patterns.size()) bad_emitter = true;
+	});
+	if (bad_emitter) throw std::runtime_error("Saved state has an emitter with a missing pattern.");
+
+	if (!in.done()) throw std::runtime_error("Saved state has extra data at the end.");
+}
+
+void RaidenGame::debug_log() {
+	auto log_stats = [](char const *name, PoolStats const &stats) {
+		std::cout << name << ": " << stats.live << " live, " << stats.high_water << " peak of " << stats.capacity
+			<< " (" << stats.acquired << " acquired, " << stats.failed << " refused)" << std::endl;
+	};
+	log_stats("entities", world.stats);
+	log_stats("player bullets", player_bullets.stats);
+	log_stats("enemy bullets", enemy_bullets.stats);
+	log_stats("routes", routes.stats);
+}
+
+void RaidenGame::generate_enemies(float elapsed) {
+
+	uint32_t enemies = enemy_count();
+	if (enemies >= ENEMY_MAX_NUM + game_difficulty_mode)
+		return;
+	else if (curr_enemy_spawn_cool_down > 0)
+	{
+		curr_enemy_spawn_cool_down -= elapsed;
+		return;
+	}
+	else if (enemies <= ENEMY_NEED_SPAWN_NUM + game_difficulty_mode
+		|| rng.stream(uint64_t(RngStream::Spawn)).stream(tick).below(100) < ENEMY_SPAWN_POSSIBILITY + game_difficulty_mode)
+	{
+		if (route_change_counter == ROUTE_CHANGE_RATE - 1)
+		{
+			routes.release(curr_route);
+			curr_route = random_route();
+		}
+		spawn_enemy(glm::vec2(0.0f, COURT_RADIUS.y - 0.5f), curr_route, ENEMY_HEALTH + game_difficulty_mode * 0.1f);
+		route_change_counter = (route_change_counter + 1) % ROUTE_CHANGE_RATE;
+		curr_enemy_spawn_cool_down = ENEMY_SPAWN_COOL_DOWN;
+	}
+}
+
+void RaidenGame::update_game_data() {
+	game_difficulty_mode += (killed_enemies_num / 30) * 0.5f;
+}
+
+void RaidenGame::update_enemies(float elapsed) {
+	//route following: each entity only touches its own components (and reads the route table),
+	// so chunks can run on any number of threads, and each chunk is steered as a batch (see enemy_steering.hpp)
+	world.parallel_each_chunk< Body, RouteFollower >(jobs, [&](Entity const *, uint32_t rows, Body *bodies, RouteFollower *followers) {
+		steer_enemies(bodies, followers, rows, routes, elapsed * ENEMY_SPEED);
+	});
+
+	//the grid isn't thread-safe, so it is kept current in a serial pass:
+	world.each< Enemy, Body >([this](Entity const &e, Enemy &, Body &body) {
+		enemy_grid.update(e.index, body.position);
+	});
+}
+
+void RaidenGame::execute_event(float elapsed) {
+	if (player_health > 0)
+		fly_fighter(curr_status, bot_fighter, player_collision_box, curr_player_shoot_cool_down, elapsed);
+	if (wing.active && wing.health > 0)
+		fly_fighter(wing.status, wing.position, wing.collision_box, wing.shoot_cool_down, elapsed);
+}
+
+void RaidenGame::fly_fighter(int status, glm::vec2 &position, glm::vec4 &collision_box, float &shoot_cool_down, float elapsed) {
+
+	glm::vec2 movement(0);
+	if (status & EventStatus::is_down)
+		movement.y -= 1.0f;
+	if (status & EventStatus::is_up)
+		movement.y += 1.0f;
+	if (status & EventStatus::is_left)
+		movement.x -= 1.0f;
+	if (status & EventStatus::is_right)
+		movement.x += 1.0f;
+	if (status & EventStatus::is_shoot) {
+		if (shoot_cool_down > 0)
+		{
+			shoot_cool_down -= elapsed;
+		}
+		else
+		{
+			player_shoot(position);
+			shoot_cool_down = PLAYER_SHOOT_COOLDOWN;
+		}
+	}
+
+	if (movement != glm::vec2(0)) {
+		position += glm::normalize(movement) * elapsed * PLAYER_SPEED;
+	}
+
+	collision_box = glm::vec4(position.x - fighter_radius.x,
+		position.x + fighter_radius.x,
+		position.y - fighter_radius.y - 0.05f,
+		position.y + fighter_radius.y);
+}
+
+void RaidenGame::enemy_shoot(float elapsed) {
+	world.each< Gun, Body >([&](Entity const &, Gun &gun, Body &body) {
+		if (gun.cool_down > 0)
+		{
+			gun.cool_down -= elapsed;
+		}
+		else
+		{
+			enemy_bullets.spawn(glm::vec2(body.position.x, body.position.y - ENEMY_RADIUS.y - 0.05f), glm::vec2(0.0f, -1.0f));
+			gun.cool_down = ENEMY_SHOOT_COOLDOWN;
+		}
+	});
+}
+
+void RaidenGame::emit_patterns(float elapsed) {
+	//aimed patterns aim at the nearest fighter still flying:
+	glm::vec2 const *targets[2];
+	uint32_t target_count = 0;
+	if (player_health > 0) targets[target_count++] = &bot_fighter;
+	if (wing.active && wing.health > 0) targets[target_count++] = &wing.position;
+
+	//collect the shots due (in entity order)...
+	shots.clear();
+	world.each< Emitter, Body >([&](Entity const &entity, Emitter &emitter, Body &body) {
+		emitter.wait -= elapsed;
+		if (emitter.wait > 0.0f) return;
+		Pattern const &pattern = patterns[emitter.pattern];
+		glm::vec2 origin(body.position.x, body.position.y - ENEMY_RADIUS.y - 0.05f);
+		glm::vec2 base(0.0f, -1.0f);
+		if (pattern.aimed) {
+			float nearest = -1.0f;
+			for (uint32_t t = 0; t < target_count; ++t) {
+				glm::vec2 to = *targets[t] - origin;
+				float length = glm::length(to);
+				if (length > 0.0f && (nearest < 0.0f || length < nearest)) {
+					nearest = length;
+					base = to / length;
+				}
+			}
+		}
+		while (emitter.wait <= 0.0f) {
+			glm::vec2 heading = base;
+			if (emitter.turn != 0.0f) {
+				float c = std::cos(emitter.turn), s = std::sin(emitter.turn);
+				heading = glm::vec2(base.x * c - base.y * s, base.x * s + base.y * c);
+			}
+			shots.emplace_back(Shot{ entity, emitter.pattern, origin, heading });
+			emitter.wait += pattern.wait_after(emitter.shot);
+			emitter.shot = (pattern.burst != 0 ? (emitter.shot + 1) % pattern.burst : 0);
+			emitter.turn = std::fmod(emitter.turn + pattern.spin, 6.28318530718f);
+			if (emitter.turn < 0.0f) emitter.turn += 6.28318530718f;
+		}
+	});
+	if (shots.empty()) return;
+
+	//...then fire them:
+	for (Shot const &shot : shots) {
+		Pattern const &pattern = patterns[shot.pattern];
+		if (!profile) {
+			pattern.fire(shot.origin, shot.heading, enemy_bullets);
+			continue;
+		}
+		auto before = std::chrono::high_resolution_clock::now();
+		uint32_t spawned = pattern.fire(shot.origin, shot.heading, enemy_bullets);
+		FiringCost cost;
+		cost.shots = 1;
+		cost.bullets = spawned;
+		cost.refused = pattern.count - spawned;
+		cost.ms = std::chrono::duration< double, std::milli >(std::chrono::high_resolution_clock::now() - before).count();
+		profile->record(shot.emitter, shot.pattern, cost);
+	}
+}
+
+void RaidenGame::FiringCost::add(FiringCost const &other) {
+	emitters += other.emitters;
+	shots += other.shots;
+	bullets += other.bullets;
+	refused += other.refused;
+	ms += other.ms;
+}
+
+void RaidenGame::EmitterProfile::record(Entity const &emitter, uint32_t pattern, FiringCost const &cost) {
+	if (patterns.size() <= pattern) patterns.resize(pattern + 1); //(only when a pattern fires for the first time)
+	Record &at = live[emitter.index];
+	if (at.emitter != emitter) {
+		//a new emitter: keep the old one if it's among the costliest retired so far
+		if (at.emitter.valid()) {
+			uint32_t i = EMITTER_PROFILE_TOP;
+			while (i > 0 && !(retired[i - 1].emitter.valid() && retired[i - 1].cost.ms >= at.cost.ms)) --i;
+			if (i < EMITTER_PROFILE_TOP) {
+				std::copy_backward(retired + i, retired + EMITTER_PROFILE_TOP - 1, retired + EMITTER_PROFILE_TOP);
+				retired[i] = at;
+			}
+		}
+		at = Record();
+		at.emitter = emitter;
+		at.pattern = pattern;
+		at.cost.emitters = 1;
+		patterns[pattern].emitters += 1;
+	}
+	at.cost.add(cost);
+	patterns[pattern].add(cost);
+}
+
+std::vector< RaidenGame::EmitterProfile::Record > RaidenGame::EmitterProfile::costliest(uint32_t count) const {
+	std::vector< Record > records;
+	for (Record const &record : live) {
+		if (record.emitter.valid()) records.emplace_back(record);
+	}
+	for (Record const &record : retired) {
+		if (record.emitter.valid()) records.emplace_back(record);
+	}
+	std::sort(records.begin(), records.end(), [](Record const &a, Record const &b) {
+		return a.cost.ms > b.cost.ms;
+	});
+	if (records.size() > count) records.resize(count);
+	return records;
+}
+
+void RaidenGame::EmitterProfile::clear() {
+	std::fill(live.begin(), live.end(), Record());
+	std::fill(retired, retired + EMITTER_PROFILE_TOP, Record());
+	patterns.clear();
+}
+
+void RaidenGame::player_shoot(glm::vec2 const &fighter) {
+	player_bullets.spawn(glm::vec2(fighter.x, fighter.y + fighter_radius.y + 0.05f), glm::vec2(0.0f, 1.0f));
+}
+
+void RaidenGame::update_bullet(float elapsed, int random) {
+	update_bullets(player_bullets, elapsed, random, true);
+	update_bullets(enemy_bullets, elapsed, random, false);
+}
+
+void RaidenGame::update_bullets(Bullets &bullets, float elapsed, int random, bool hits_enemies) {
+	glm::vec2 const &radius = bullets.archetype.radius;
+	//velocities are stored pre-scaled by speed, so scale the bounce deviation to match:
+	float deviation = BULLET_DEVIATION_VALUE * random * bullets.archetype.speed;
+
+	bullets.store_previous();
+
+	//expire old bullets first, so the integration pass below never changes the bullet count:
+	//NOTE: no '++i' in the loop header -- killing a bullet moves another one into slot i
+	for (size_t i = 0; i < bullets.size(); )
+	{
+		if (bullets.lifetimes[i] <= 0)
+		{
+			bullets.kill(i);
+			continue;
+		}
+		++i;
+	}
+
+	//move + bounce:
+	// each bullet only touches its own entries (and 'deviation' is fixed for the whole tick),
+	// so chunks can run on any number of threads and still give the same result
+	auto integrate = [&](uint32_t begin, uint32_t end) {
+		glm::vec2 *positions = bullets.positions.data();
+		glm::vec2 *velocities = bullets.velocities.data();
+		float *lifetimes = bullets.lifetimes.data();
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			glm::vec2 &position = positions[i];
+			glm::vec2 &velocity = velocities[i];
+			position += velocity * elapsed;
+
+			if (bullets.archetype.bounces)
+			{
+				if (position.y > COURT_RADIUS.y - radius.y)
+				{
+					position.y = COURT_RADIUS.y - radius.y;
+					if (velocity.y > 0.0f)
+					{
+						velocity.y = -velocity.y;
+						velocity.x -= deviation;
+					}
+				}
+				if (position.y < -COURT_RADIUS.y + radius.y)
+				{
+					position.y = -COURT_RADIUS.y + radius.y;
+					if (velocity.y < 0.0f)
+					{
+						velocity.y = -velocity.y;
+						velocity.x += -deviation;
+					}
+				}
+
+				if (position.x > COURT_RADIUS.x - radius.x)
+				{
+					position.x = COURT_RADIUS.x - radius.x;
+					if (velocity.x > 0.0f)
+					{
+						velocity.x = -velocity.x;
+						velocity.y -= deviation;
+					}
+				}
+				if (position.x < -COURT_RADIUS.x + radius.x)
+				{
+					position.x = -COURT_RADIUS.x + radius.x;
+					if (velocity.x < 0.0f)
+					{
+						velocity.x = -velocity.x;
+						velocity.y += -deviation;
+					}
+				}
+			}
+
+			lifetimes[i] -= elapsed;
+		}
+	};
+	if (jobs)
+	{
+		jobs->parallel_for(uint32_t(bullets.size()), BULLET_PARALLEL_MIN_CHUNK, integrate);
+	}
+	else
+	{
+		integrate(0, uint32_t(bullets.size()));
+	}
+
+	// ------ Check Collision ------ //
+
+	//hits are tested along each bullet's whole move this tick (not just where it ended up),
+	// so fast bullets and long ticks can't skip through a target:
+	// (a bullet that bounced is swept along the straight line from where it started; close enough)
+
+	//bullets that hit a fighter, tested in one batch per fighter; the fighter moved this tick too, so the
+	// bullets are swept relative to it:
+	auto hit_fighter = [&](glm::vec2 const &motion, glm::vec4 const &collision_box, float &health) {
+		uint32_t hits = aabb_sweep_batch(bullets.previous_positions.data(), bullets.positions.data(), uint32_t(bullets.size()),
+			motion, radius, collision_box, bullet_hits.data());
+		health -= BULLET_DAMAGE * hits;
+		//hits are in increasing order, so kill from the back to keep the remaining indices valid:
+		for (uint32_t h = hits; h > 0; --h)
+		{
+			bullets.kill(bullet_hits[h - 1]);
+		}
+	};
+	if (player_health > 0)
+		hit_fighter(bot_fighter - previous_bot_fighter, player_collision_box, player_health);
+	if (wing.active && wing.health > 0)
+		hit_fighter(wing.position - wing.previous_position, wing.collision_box, wing.health);
+
+	if (!hits_enemies)
+		return;
+
+	//bullets that hit enemies, using the grid to find enemies near each bullet's path:
+	// (enemies haven't moved yet this tick, so they hold still while the bullets sweep)
+	for (size_t i = 0; i < bullets.size(); )
+	{
+		glm::vec2 const &start = bullets.previous_positions[i];
+		glm::vec2 const &end = bullets.positions[i];
+		glm::vec2 path_min = glm::min(start, end) - radius;
+		glm::vec2 path_max = glm::max(start, end) + radius;
+		//the enemy the bullet reaches first is hit; ties go to the lowest entity index -- the grid's
+		// list order depends on history, so taking the first one found wouldn't survive a save + restore:
+		uint32_t hit_index = -1U;
+		float hit_time = 2.0f;
+		enemy_grid.query(glm::vec4(path_min.x, path_max.x, path_min.y, path_max.y), [&](uint32_t index) {
+			float time;
+			if (aabb_sweep(start, end, radius, world.get< Body >(world.entity_at(index))->collision_box, &time)
+				&& (time < hit_time || (time == hit_time && index < hit_index)))
+			{
+				hit_index = index;
+				hit_time = time;
+			}
+			return true;
+		});
+		if (hit_index != -1U)
+		{
+			Entity hit = world.entity_at(hit_index);
+			Enemy *e = world.get< Enemy >(hit);
+			e->health -= BULLET_DAMAGE;
+			if (impacts.size() < IMPACT_CAPACITY)
+			{
+				glm::vec2 at = glm::mix(start, end, hit_time);
+				impacts.emplace_back(Impact{ tick, at, bullets.velocities[i], e->health <= 0 });
+			}
+			if (e->health <= 0)
+			{
+				kill_enemy(hit);
+				killed_enemies_num++;
+			}
+			bullets.kill(i);
+			continue;
+		}
+		++i;
+	}
+}
+
+void RaidenGame::update(float elapsed) {
+
+	//debug_log();
+
+	tick += 1;
+	previous_bot_fighter = bot_fighter;
+	wing.previous_position = wing.position;
+
+	if (game_over()){
+		generate_enemies(elapsed);
+		update_enemies(elapsed);
+		return;
+	}
+
+	// Execute Keyboard event
+	execute_event(elapsed);
+	
+	// Update bullet
+	int r = rng.stream(uint64_t(RngStream::Bounce)).stream(tick).below(2) == 0 ? 1 : -1;
+	update_bullet(elapsed, r);
+
+	//clamp fighters to court:
+	for (glm::vec2 *fighter : { &bot_fighter, &wing.position }) {
+		fighter->x = std::max(fighter->x, -COURT_RADIUS.x + fighter_radius.x);
+		fighter->x = std::min(fighter->x, COURT_RADIUS.x - fighter_radius.x);
+		fighter->y = std::max(fighter->y, -COURT_RADIUS.y + fighter_radius.y);
+		fighter->y = std::min(fighter->y, COURT_RADIUS.y - fighter_radius.y);
+	}
+	
+	// Enemy
+	generate_enemies(elapsed);
+	update_enemies(elapsed);
+	enemy_shoot(elapsed);
+	emit_patterns(elapsed);
+
+	update_game_data();
+}
+
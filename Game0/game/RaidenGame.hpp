@@ -0,0 +1,281 @@
+#pragma once
+
+#include "BulletPatterns.hpp"
+#include "Bullets.hpp"
+#include "CollisionGrid.hpp"
+#include "JobSystem.hpp"
+#include "RouteTable.hpp"
+#include "Rng.hpp"
+#include "World.hpp"
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <vector>
+
+/*
+ * RaidenGame is the simulation half of 9S's Raiden Adventure:
+ * all of the game state plus the per-tick update, with no SDL or OpenGL.
+ *
+ * RaidenMode wraps it with input handling and drawing; command-line tools
+ * (e.g., raiden_headless) can create and tick it without a window or GL context.
+ *
+ * Enemies are entities in 'world' (see World.hpp), built from the components below;
+ * each update step is a system that runs over the entities with the components it needs.
+ * Bullets stay in their own SoA stores (Bullets.hpp), which are specialized for them.
+ */
+
+#define BULLET_LIFETIME 5.0f
+#define PLAYER_HEALTH 50.0f
+#define ENEMY_HEALTH 1.0f
+#define BULLET_DAMAGE 5.0f
+#define BULLET_SPEED 7.0f
+#define BULLET_RADIUS glm::vec2(0.05f, 0.1f)
+#define PLAYER_SPEED 5.0f
+#define ENEMY_SPEED 5.0f
+#define ENEMY_RADIUS glm::vec2(0.15f, 0.3f)
+#define PLAYER_SHOOT_COOLDOWN 0.1f
+#define ENEMY_SHOOT_COOLDOWN 1.0f
+#define COURT_RADIUS glm::vec2(7.0f, 5.0f)
+#define BULLET_DEVIATION_VALUE 0.5f
+#define ENEMY_MAX_NUM 15
+#define ENEMY_NEED_SPAWN_NUM 5
+#define ENEMY_SPAWN_POSSIBILITY 30
+#define ROUTE_CHANGE_RATE 4
+#define ROUTE_MAX_POINTS 14
+#define ENEMY_SPAWN_COOL_DOWN 0.4f
+#define ENTITY_CAPACITY 4096
+#define BULLET_CAPACITY 131072
+#define ROUTE_CAPACITY (ENTITY_CAPACITY + 2) //every entity on its own route, plus curr_route and one being made
+#define BULLET_PARALLEL_MIN_CHUNK 4096
+#define COLLISION_GRID_CELL_SIZE 1.0f
+#define IMPACT_CAPACITY 1024 //most impacts kept between calls to clear 'impacts'
+#define EMITTER_PROFILE_TOP 8 //retired emitters an EmitterProfile keeps (the costliest)
+
+enum EventStatus
+{
+	none = 1 << 0,
+	is_up = 1 << 1,
+	is_down = 1 << 2,
+	is_left = 1 << 3,
+	is_right = 1 << 4,
+	is_shoot = 1 << 5
+};
+
+//each system draws from its own stream of RaidenGame::rng, so adding or removing draws
+// in one system never changes what another one sees:
+enum class RngStream : uint64_t
+{
+	Spawn = 1, //spawn rolls, one stream per tick
+	Routes = 2, //route shapes, one stream per route
+	Bounce = 3, //bounce deviation sign, one stream per tick
+};
+
+struct RaidenGame {
+	//'seed' determines every random choice the game makes:
+	explicit RaidenGame(uint64_t seed);
+
+	//start a new game, exactly as if freshly constructed with 'seed', but reusing this one's storage
+	// (construction allocates tens of megabytes, so tools that play many games reuse one per thread):
+	void reset(uint64_t seed);
+
+	//advance the simulation by 'elapsed' seconds (one tick):
+	void update(float elapsed);
+
+	//add a pattern to 'patterns', returning its index:
+	uint32_t add_pattern(Pattern const &pattern);
+	//from now on, new enemies fire bullet patterns: the 'custom' ones (added to 'patterns') if any, or else every pattern in turn:
+	void start_waves(std::vector< Pattern > const &custom = std::vector< Pattern >());
+
+	//write everything update() depends on (so a loaded copy continues exactly like this one):
+	void save_state(std::vector< uint8_t > &out) const;
+	//replace the current state with saved state; throws std::runtime_error on bad data
+	// (in which case the game is left as it was):
+	void load_state(uint8_t const *data, size_t size);
+
+	//add the second (co-op) fighter; call right after construction or reset:
+	void add_wing();
+	//once every fighter is down, only the enemies keep moving:
+	bool game_over() const { return player_health <= 0 && !(wing.active && wing.health > 0); }
+
+	//------ Components ------
+	//where an entity is and the box it can be hit in:
+	struct Body
+	{
+		glm::vec2 position = glm::vec2(0.0f);
+		glm::vec2 previous_position = position; //as of the last tick, for drawing between ticks
+		glm::vec4 collision_box = glm::vec4(0);
+		Body() {}
+		explicit Body(glm::vec2 pos) : position(pos), previous_position(pos) {}
+	};
+	//moves the entity's Body along a route from 'routes':
+	struct RouteFollower
+	{
+		glm::vec2 spawn_position = glm::vec2(0.0f); //flies straight from here to the start of the route
+		uint32_t route = -1U; //id in 'routes' (the follower holds a reference)
+		//distance flown since spawning (ENEMY_SPEED * time alive, less any whole loops of the route):
+		float distance = 0.0f;
+		uint32_t segment = 0; //cursor for RouteTable::at
+		RouteFollower() {}
+		RouteFollower(glm::vec2 pos, uint32_t route_) : spawn_position(pos), route(route_) {}
+	};
+	//fires enemy bullets straight down from the entity's Body:
+	struct Gun
+	{
+		float cool_down = ENEMY_SHOOT_COOLDOWN;
+	};
+	//can be hit by player bullets (and is filed in 'enemy_grid' by entity index):
+	struct Enemy
+	{
+		float health = ENEMY_HEALTH;
+	};
+	//fires enemy bullets from the entity's Body in one of 'patterns' (instead of a Gun):
+	struct Emitter
+	{
+		uint32_t pattern = 0; //index in 'patterns'
+		uint32_t shot = 0; //shots fired in the current burst
+		float wait = 0.0f; //seconds until the next shot
+		float turn = 0.0f; //radians the heading has turned (by Pattern::spin), in [0, 2pi)
+	};
+
+	//------ Raiden Game State -----
+	//(starting values are set in reset())
+	uint64_t seed;
+	Rng rng; //root of all randomness in the game (see RngStream)
+	uint64_t tick; //updates run so far (counting the one in progress)
+	uint64_t routes_made;
+	glm::vec2 fighter_radius;
+	glm::vec2 bot_fighter;
+	glm::vec2 previous_bot_fighter;
+	glm::vec4 player_collision_box;
+	int curr_status;
+	int route_change_counter;
+	int killed_enemies_num;
+	float game_difficulty_mode;
+	float curr_player_shoot_cool_down;
+	float curr_enemy_spawn_cool_down;
+	float player_health;
+
+	//the second fighter in a co-op game (see Rollback.hpp); it plays by the same rules as bot_fighter
+	// but has its own input bits, and doesn't exist unless 'active':
+	struct Wing
+	{
+		bool active = false;
+		int status = EventStatus::none;
+		glm::vec2 position = glm::vec2(0.0f);
+		glm::vec2 previous_position = glm::vec2(0.0f);
+		glm::vec4 collision_box = glm::vec4(0);
+		float shoot_cool_down = PLAYER_SHOOT_COOLDOWN;
+		float health = PLAYER_HEALTH;
+	} wing;
+
+	//every route in use, shared by the enemies that follow it:
+	RouteTable routes{ROUTE_CAPACITY, ROUTE_MAX_POINTS};
+	uint32_t curr_route; //route for the next enemies to spawn (holds a reference)
+
+	//player bullets bounce around the court (and will hit the player); enemy bullets fly straight down:
+	Bullets player_bullets = Bullets(Bullets::Archetype(BULLET_RADIUS, BULLET_SPEED, BULLET_LIFETIME, true), BULLET_CAPACITY);
+	Bullets enemy_bullets = Bullets(Bullets::Archetype(BULLET_RADIUS, BULLET_SPEED, BULLET_LIFETIME, false), BULLET_CAPACITY);
+
+	//every entity (fixed capacity); the constructor registers the components above:
+	World world{ENTITY_CAPACITY};
+
+	//bullet patterns Emitters can fire (starts as builtin_patterns(); kept by reset()):
+	std::vector< Pattern > patterns;
+	uint64_t patterns_hash; //hash_patterns(patterns), kept current so loads can skip a table they already have
+	//if not empty, new enemies get an Emitter -- taking these pattern indices in turn -- instead of a Gun
+	// (kept by reset(), like 'patterns'):
+	std::vector< uint32_t > wave_patterns;
+	uint32_t waves_spawned; //enemies given an Emitter so far
+
+	//where player bullets hit enemies since someone last cleared this, for effects (see RaidenMode):
+	// not part of the game state -- update() appends, whoever shows them clears, and past IMPACT_CAPACITY they're dropped.
+	struct Impact {
+		uint64_t tick; //(a rollback re-runs ticks, so the same impact can turn up twice)
+		glm::vec2 position;
+		glm::vec2 velocity; //of the bullet
+		bool destroyed; //the hit killed the enemy
+	};
+	std::vector< Impact > impacts;
+
+	//what firing cost, for profiling:
+	struct FiringCost {
+		uint64_t emitters = 0; //that fired (1 for a single emitter's cost)
+		uint64_t shots = 0;
+		uint64_t bullets = 0;
+		uint64_t refused = 0; //bullets that didn't fit in enemy_bullets
+		double ms = 0.0;
+		void add(FiringCost const &other);
+	};
+	//firing cost by emitter (not part of the game state; see 'profile'):
+	struct EmitterProfile {
+		struct Record {
+			Entity emitter; //(ids aren't reused within a game, but reset() starts them over -- clear() along with it)
+			uint32_t pattern = 0;
+			FiringCost cost;
+		};
+		std::vector< Record > live = std::vector< Record >(ENTITY_CAPACITY); //by entity index: the latest emitter there
+		Record retired[EMITTER_PROFILE_TOP]; //costliest emitters whose index has since been reused, most expensive first
+		std::vector< FiringCost > patterns; //totals by pattern index (every emitter, live or retired)
+
+		void record(Entity const &emitter, uint32_t pattern, FiringCost const &cost);
+		//the 'count' costliest emitters (of the live ones and 'retired'), most expensive first:
+		std::vector< Record > costliest(uint32_t count) const;
+		void clear();
+	};
+	//if set, emit_patterns times each shot and records it here; Rollback unsets it while re-simulating,
+	// so every tick is counted once (left unset, the sim reads no clocks):
+	EmitterProfile *profile = nullptr;
+
+	//broadphase for bullet-vs-enemy tests; enemies are filed by entity index:
+	// (max radius covers ENEMY_RADIUS plus the wing overhang on Body::collision_box)
+	CollisionGrid enemy_grid{-COURT_RADIUS, COURT_RADIUS, COLLISION_GRID_CELL_SIZE, glm::vec2(0.15f, 0.35f), ENTITY_CAPACITY};
+
+	//if set, bullet integration and the parallel systems are split across these threads:
+	// (any thread count gives the same simulation; this only changes how fast it runs)
+	JobSystem *jobs = nullptr;
+
+	//scratch space for batched bullet hit tests (one entry per possible bullet):
+	std::vector< uint32_t > bullet_hits = std::vector< uint32_t >(BULLET_CAPACITY);
+
+	//scratch for read_state: references to each route found in the loaded state
+	std::vector< uint32_t > route_references = std::vector< uint32_t >(ROUTE_CAPACITY);
+
+	//scratch for emit_patterns: shots due this tick
+	struct Shot {
+		Entity emitter;
+		uint32_t pattern;
+		glm::vec2 origin, heading;
+	};
+	std::vector< Shot > shots;
+
+	//load_state reads into this game (made on the first load) and only swaps it in once all of the data
+	// checks out; what was here is kept for the next load, so loads don't allocate once warmed up:
+	std::unique_ptr< RaidenGame > loading;
+	//replace this game's state with saved state, throwing partway on bad data:
+	void read_state(uint8_t const *data, size_t size);
+	//exchange everything save_state writes (and enemy_grid, which goes with the entities):
+	void swap_state(RaidenGame &other);
+
+	//make a new random route; the caller gets one reference to it:
+	uint32_t random_route();
+	//spawn an enemy following 'route' (it takes its own reference); invalid if the world is full:
+	Entity spawn_enemy(glm::vec2 const &position, uint32_t route, float health);
+	//same, but the enemy fires 'pattern' (an index in 'patterns'):
+	Entity spawn_emitter(glm::vec2 const &position, uint32_t route, float health, uint32_t pattern);
+	//remove an enemy (and its grid entry and route reference):
+	void kill_enemy(Entity const &enemy);
+	uint32_t enemy_count() const { return world.count< Enemy >(); }
+
+	void execute_event(float elapsed);
+	void fly_fighter(int status, glm::vec2 &position, glm::vec4 &collision_box, float &shoot_cool_down, float elapsed);
+	void player_shoot(glm::vec2 const &fighter);
+	void enemy_shoot(float elapsed);
+	void emit_patterns(float elapsed);
+	void update_bullet(float elapsed, int r);
+	void update_bullets(Bullets &bullets, float elapsed, int random, bool hits_enemies);
+	void generate_enemies(float elapsed);
+	void update_enemies(float elapsed);
+	void update_game_data();
+	void debug_log();
+};
@@ -3,67 +3,42 @@
 //for the GL_ERRORS() macro:
 #include "gl_errors.hpp"
 
+//for per-frame scratch memory:
+#include "FrameArena.hpp"
+//for streaming vertices:
+#include "StreamBuffer.hpp"
+
 //for glm::value_ptr() :
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+RaidenMode::RaidenMode(Replay const &playback) : RaidenMode(playback.seed) {
+	replay = playback;
+	playing_back = true;
+	//a keyframe at tick 0 has setup the seed doesn't (like bullet pattern waves):
+	if (Replay::Keyframe const *keyframe = replay.keyframe_before(0)) {
+		game.load_state(keyframe->state.data(), keyframe->state.size());
+	}
+}
+
+RaidenMode::RaidenMode(uint64_t seed) : game(seed) {
+	game.jobs = Mode::jobs;
 
-RaidenMode::RaidenMode() {
-	
 	//----- allocate OpenGL resources -----
 	{ //vertex buffer:
-		glGenBuffers(1, &vertex_buffer);
-		//for now, buffer will be un-filled.
-
-		GL_ERRORS(); //PARANOIA: print out any OpenGL errors that may have happened
+		//(vertices are streamed through Mode::vertex_stream, which every mode shares; see StreamBuffer.hpp)
+		vertex_buffer = Mode::vertex_stream->buffer;
+		vertex_generation = Mode::vertex_stream->generation;
 	}
 
 	{ //vertex array mapping buffer for color_texture_program:
 		//ask OpenGL to fill vertex_buffer_for_color_texture_program with the name of an unused vertex array object:
 		glGenVertexArrays(1, &vertex_buffer_for_color_texture_program);
 
-		//set vertex_buffer_for_color_texture_program as the current vertex array object:
-		glBindVertexArray(vertex_buffer_for_color_texture_program);
-
-		//set vertex_buffer as the source of glVertexAttribPointer() commands:
-		glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
-
-		//set up the vertex array object to describe arrays of PongMode::Vertex:
-		glVertexAttribPointer(
-			color_texture_program.Position_vec4, //attribute
-			3, //size
-			GL_FLOAT, //type
-			GL_FALSE, //normalized
-			sizeof(Vertex), //stride
-			(GLbyte *)0 + 0 //offset
-		);
-		glEnableVertexAttribArray(color_texture_program.Position_vec4);
-		//[Note that it is okay to bind a vec3 input to a vec4 attribute -- the w component will be filled with 1.0 automatically]
-
-		glVertexAttribPointer(
-			color_texture_program.Color_vec4, //attribute
-			4, //size
-			GL_UNSIGNED_BYTE, //type
-			GL_TRUE, //normalized
-			sizeof(Vertex), //stride
-			(GLbyte *)0 + 4*3 //offset
-		);
-		glEnableVertexAttribArray(color_texture_program.Color_vec4);
-
-		glVertexAttribPointer(
-			color_texture_program.TexCoord_vec2, //attribute
-			2, //size
-			GL_FLOAT, //type
-			GL_FALSE, //normalized
-			sizeof(Vertex), //stride
-			(GLbyte *)0 + 4*3 + 4*1 //offset
-		);
-		glEnableVertexAttribArray(color_texture_program.TexCoord_vec2);
-
-		//done referring to vertex_buffer, so unbind it:
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-		//done setting up vertex array object, so unbind it:
-		glBindVertexArray(0);
+		point_vertex_array();
 
 		GL_ERRORS(); //PARANOIA: print out any OpenGL errors that may have happened
 	}
@@ -97,356 +72,318 @@ RaidenMode::RaidenMode() {
 	}
 }
 
-RaidenMode::~RaidenMode() {
+void RaidenMode::point_vertex_array() {
+	//set vertex_buffer_for_color_texture_program as the current vertex array object:
+	glBindVertexArray(vertex_buffer_for_color_texture_program);
 
-	//----- free OpenGL resources -----
-	glDeleteBuffers(1, &vertex_buffer);
-	vertex_buffer = 0;
+	//set vertex_buffer as the source of glVertexAttribPointer() commands:
+	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+
+	//set up the vertex array object to describe arrays of PongMode::Vertex:
+	glVertexAttribPointer(
+		color_texture_program.Position_vec4, //attribute
+		3, //size
+		GL_FLOAT, //type
+		GL_FALSE, //normalized
+		sizeof(Vertex), //stride
+		(GLbyte *)0 + 0 //offset
+	);
+	glEnableVertexAttribArray(color_texture_program.Position_vec4);
+	//[Note that it is okay to bind a vec3 input to a vec4 attribute -- the w component will be filled with 1.0 automatically]
+
+	glVertexAttribPointer(
+		color_texture_program.Color_vec4, //attribute
+		4, //size
+		GL_UNSIGNED_BYTE, //type
+		GL_TRUE, //normalized
+		sizeof(Vertex), //stride
+		(GLbyte *)0 + 4*3 //offset
+	);
+	glEnableVertexAttribArray(color_texture_program.Color_vec4);
+
+	glVertexAttribPointer(
+		color_texture_program.TexCoord_vec2, //attribute
+		2, //size
+		GL_FLOAT, //type
+		GL_FALSE, //normalized
+		sizeof(Vertex), //stride
+		(GLbyte *)0 + 4*3 + 4*1 //offset
+	);
+	glEnableVertexAttribArray(color_texture_program.TexCoord_vec2);
 
-	glDeleteVertexArrays(1, &vertex_buffer_for_color_texture_program);
-	vertex_buffer_for_color_texture_program = 0;
+	//done referring to vertex_buffer, so unbind it:
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-	glDeleteTextures(1, &white_tex);
-	white_tex = 0;
+	//done setting up vertex array object, so unbind it:
+	glBindVertexArray(0);
 }
 
-void RaidenMode::debug_log() {
-	std::cout << all_enemies.size() << std::endl;
-	std::cout << enemy_pool.size() << std::endl;
-}
+RaidenMode::~RaidenMode() {
 
-void RaidenMode::generate_enemies(float elapsed) {
+	finish_recording();
 
-	if ((all_enemies.size() - enemy_pool.size()) >= ENEMY_MAX_NUM + game_difficulty_mode)
-		return;
-	else if (curr_enemy_spawn_cool_down > 0)
-	{
-		curr_enemy_spawn_cool_down -= elapsed;
-		return;
+	if (rollback) {
+		Rollback::Stats const &stats = rollback->stats;
+		std::cout << "Co-op: " << stats.ticks << " ticks, " << stats.waits << " waits, " << stats.rollbacks << " rollbacks ("
+			<< stats.resimulated << " ticks re-run, deepest " << stats.max_depth << ", slowest " << stats.max_rollback_ms << " ms)." << std::endl;
 	}
-	else if ((all_enemies.size() - enemy_pool.size()) <= ENEMY_NEED_SPAWN_NUM + game_difficulty_mode
-		|| (mt() % 100) < ENEMY_SPAWN_POSSIBILITY + game_difficulty_mode)
-	{
-		if (route_change_counter == ROUTE_CHANGE_RATE - 1)
-		{
-			curr_route = EnemyRoute();
-		}
-		if (!enemy_pool.empty())
-		{
-			int index = enemy_pool.front();
-			enemy_pool.pop_front();
-			all_enemies[index].enemy_position = glm::vec2(0.0f, COURT_RADIUS.y - 0.5f);
-			all_enemies[index].enemy_velocity = glm::vec2(0);
-			all_enemies[index].enemy_collision_box = glm::vec4(0);
-			all_enemies[index].curr_enemy_shoot_cool_down = ENEMY_SHOOT_COOLDOWN;
-			all_enemies[index].enemy_health = ENEMY_HEALTH + game_difficulty_mode * 0.1f;
-			all_enemies[index].enemy_route = curr_route;
-			all_enemies[index].route_index = 0;
-			all_enemies[index].is_in_pool = false;
-		}
-		else
-		{
-			Enemy e(glm::vec2(0.0f, COURT_RADIUS.y - 0.5f), curr_route);
-			e.enemy_health = ENEMY_HEALTH + game_difficulty_mode * 0.1f;
-			all_enemies.push_back(e);
-		}
-		route_change_counter = (route_change_counter + 1) % ROUTE_CHANGE_RATE;
-		curr_enemy_spawn_cool_down = ENEMY_SPAWN_COOL_DOWN;
+	if (client) {
+		StateClient::Stats const &stats = client->stats;
+		std::cout << "Client: " << stats.views << " views, " << stats.bytes << " bytes (" << stats.stale << " stale, "
+			<< stats.missing_baseline << " missing a baseline)." << std::endl;
 	}
-}
 
-void RaidenMode::update_game_data() {
-	game_difficulty_mode += (killed_enemies_num / 30) * 0.5f;
-}
+	//----- free OpenGL resources -----
+	vertex_buffer = 0; //(belongs to Mode::vertex_stream)
 
-void RaidenMode::update_enemies(float elapsed) {
-	for (auto& e : all_enemies) {
-		if (e.is_in_pool)
-			continue;
-		if (e.enemy_position.x >= e.enemy_route.route_points[e.route_index].x - 0.1f
-			&& e.enemy_position.x <= e.enemy_route.route_points[e.route_index].x + 0.1f
-			&& e.enemy_position.y >= e.enemy_route.route_points[e.route_index].y - 0.1f
-			&& e.enemy_position.y <= e.enemy_route.route_points[e.route_index].y + 0.1f)
-		{
-			e.route_index = (e.route_index + 1) % e.enemy_route.route_length;
-		}
-		e.enemy_velocity = e.enemy_route.route_points[e.route_index] - e.enemy_position;
-		if (e.enemy_velocity != glm::vec2(0))
-		{
-			e.enemy_position += glm::normalize(e.enemy_velocity) * elapsed * ENEMY_SPEED;
+	glDeleteVertexArrays(1, &vertex_buffer_for_color_texture_program);
+	vertex_buffer_for_color_texture_program = 0;
 
-		}
-		e.enemy_collision_box = glm::vec4(e.enemy_position.x - e.enemy_radius.x,
-			e.enemy_position.x + e.enemy_radius.x,
-			e.enemy_position.y - e.enemy_radius.y,
-			e.enemy_position.y + e.enemy_radius.y + 0.05f * 0.75f);
-	}
+	glDeleteTextures(1, &white_tex);
+	white_tex = 0;
 }
 
 bool RaidenMode::handle_event(SDL_Event const& evt, glm::uvec2 const& window_size) {
 
+	//while playing back, page up / page down jump a minute back / ahead:
+	if (playing_back && evt.type == SDL_KEYDOWN
+		&& (evt.key.keysym.sym == SDLK_PAGEUP || evt.key.keysym.sym == SDLK_PAGEDOWN))
+	{
+		uint64_t minute = uint64_t(60.0f * replay.tick_rate);
+		uint64_t target = (evt.key.keysym.sym == SDLK_PAGEUP ? (playback_tick > minute ? playback_tick - minute : 0) : playback_tick + minute);
+		auto before = std::chrono::high_resolution_clock::now();
+		seek(target);
+		double ms = std::chrono::duration< double, std::milli >(std::chrono::high_resolution_clock::now() - before).count();
+		std::cout << "Seeked to tick " << playback_tick << " in " << ms << " ms." << std::endl;
+		return true;
+	}
+
 	switch (evt.key.keysym.sym) {
 	case SDLK_UP:
-		curr_status = evt.type == SDL_KEYDOWN ? curr_status|EventStatus::is_up : curr_status & ~EventStatus::is_up;
+		keys = evt.type == SDL_KEYDOWN ? keys|EventStatus::is_up : keys & ~EventStatus::is_up;
 		break;
 	case SDLK_w:
-		curr_status = evt.type == SDL_KEYDOWN ? curr_status | EventStatus::is_up : curr_status & ~EventStatus::is_up;
+		keys = evt.type == SDL_KEYDOWN ? keys | EventStatus::is_up : keys & ~EventStatus::is_up;
 		break;
 	case SDLK_DOWN:
-		curr_status = evt.type == SDL_KEYDOWN ? curr_status|EventStatus::is_down : curr_status & ~EventStatus::is_down;
+		keys = evt.type == SDL_KEYDOWN ? keys|EventStatus::is_down : keys & ~EventStatus::is_down;
 		break;
 	case SDLK_s:
-		curr_status = evt.type == SDL_KEYDOWN ? curr_status | EventStatus::is_down : curr_status & ~EventStatus::is_down;
+		keys = evt.type == SDL_KEYDOWN ? keys | EventStatus::is_down : keys & ~EventStatus::is_down;
 		break;
 	case SDLK_LEFT:
-		curr_status = evt.type == SDL_KEYDOWN ? curr_status|EventStatus::is_left : curr_status & ~EventStatus::is_left;
+		keys = evt.type == SDL_KEYDOWN ? keys|EventStatus::is_left : keys & ~EventStatus::is_left;
 		break;
 	case SDLK_a:
-		curr_status = evt.type == SDL_KEYDOWN ? curr_status | EventStatus::is_left : curr_status & ~EventStatus::is_left;
+		keys = evt.type == SDL_KEYDOWN ? keys | EventStatus::is_left : keys & ~EventStatus::is_left;
 		break;
 	case SDLK_RIGHT:
-		curr_status = evt.type == SDL_KEYDOWN ? curr_status|EventStatus::is_right : curr_status & ~EventStatus::is_right;
+		keys = evt.type == SDL_KEYDOWN ? keys|EventStatus::is_right : keys & ~EventStatus::is_right;
 		break;
 	case SDLK_d:
-		curr_status = evt.type == SDL_KEYDOWN ? curr_status | EventStatus::is_right : curr_status & ~EventStatus::is_right;
+		keys = evt.type == SDL_KEYDOWN ? keys | EventStatus::is_right : keys & ~EventStatus::is_right;
 		break;
 	case SDLK_SPACE:
-		curr_status = evt.type == SDL_KEYDOWN ? curr_status | EventStatus::is_shoot : curr_status & ~EventStatus::is_shoot;
+		keys = evt.type == SDL_KEYDOWN ? keys | EventStatus::is_shoot : keys & ~EventStatus::is_shoot;
 		break;
 	}
 
 	return false;
 }
 
-void RaidenMode::execute_event(float elapsed) {
-
-	glm::vec2 movement(0);
-	if (curr_status & EventStatus::is_down)
-		movement.y -= 1.0f;
-	if (curr_status & EventStatus::is_up)
-		movement.y += 1.0f;
-	if (curr_status & EventStatus::is_left)
-		movement.x -= 1.0f;
-	if (curr_status & EventStatus::is_right)
-		movement.x += 1.0f;
-	if (curr_status & EventStatus::is_shoot) {
-		if (curr_player_shoot_cool_down > 0)
-		{
-			curr_player_shoot_cool_down -= elapsed;
-		}
-		else
-		{
-			player_shoot();
-			curr_player_shoot_cool_down = PLAYER_SHOOT_COOLDOWN;
-		}
-	}
+void RaidenMode::start_recording(std::string const &filename, float tick_rate) {
+	record_filename = filename;
+	replay.seed = game.seed;
+	replay.tick_rate = tick_rate;
+	replay.inputs.clear();
+	replay.keyframes.clear();
+	record_keyframe();
+}
 
-	if (movement != glm::vec2(0)) {
-		bot_fighter += glm::normalize(movement) * elapsed * PLAYER_SPEED;
+void RaidenMode::finish_recording() {
+	if (record_filename.empty()) return;
+	try {
+		replay.save(record_filename);
+		std::cout << "Saved " << replay.inputs.size() << " ticks of input (seed " << replay.seed << ") to '" << record_filename << "'." << std::endl;
+	} catch (std::exception const &e) {
+		std::cerr << "Failed to save recording: " << e.what() << std::endl;
 	}
-
-	player_collision_box = glm::vec4(bot_fighter.x - fighter_radius.x,
-		bot_fighter.x + fighter_radius.x,
-		bot_fighter.y - fighter_radius.y - 0.05f,
-		bot_fighter.y + fighter_radius.y);
+	record_filename.clear();
 }
 
-void RaidenMode::enemy_shoot(float elapsed) {
-	for (auto& e : all_enemies)
-	{
-		if (e.curr_enemy_shoot_cool_down > 0)
-		{
-			e.curr_enemy_shoot_cool_down -= elapsed;
-			continue;
-		}
-		else if (e.is_in_pool)
-		{
-			continue;
-		}
-		else
-		{
-			if (!bullet_pool.empty())
-			{
-				int index = bullet_pool.front();
-				bullet_pool.pop_front();
-				all_bullets[index].bullet_position = glm::vec2(e.enemy_position.x, e.enemy_position.y - e.enemy_radius.y - 0.05f);
-				all_bullets[index].shoot_dir = -1;
-				all_bullets[index].owner = 1;
-				all_bullets[index].bullet_velocity = glm::vec2(0.0f, all_bullets[index].shoot_dir * 1.0f);
-				all_bullets[index].bullet_lifetime = BULLET_LIFETIME;
-				all_bullets[index].in_bullet_pool = false;
-			}
+void RaidenMode::record_keyframe() {
+	if (!replay.wants_keyframe(game.tick)) return;
+	replay.keyframes.emplace_back();
+	replay.keyframes.back().tick = game.tick;
+	game.save_state(replay.keyframes.back().state);
+}
 
-			Bullet b(glm::vec2(e.enemy_position.x, e.enemy_position.y - e.enemy_radius.y - 0.05f), 7.0f, 1, -1);
-			all_bullets.push_back(b);
-			e.curr_enemy_shoot_cool_down = ENEMY_SHOOT_COOLDOWN;
+void RaidenMode::seek(uint64_t tick) {
+	tick = std::min< uint64_t >(tick, replay.inputs.size());
+	Replay::Keyframe const *keyframe = replay.keyframe_before(tick);
+	//jump to the keyframe, unless playback is already between it and 'tick':
+	if (keyframe && (playback_tick < keyframe->tick || playback_tick > tick)) {
+		try {
+			game.load_state(keyframe->state.data(), keyframe->state.size());
+		} catch (std::exception const &e) {
+			//(a failed load leaves the game as it was, so playback just carries on from here)
+			std::cerr << "Can't seek to tick " << tick << ": the keyframe at tick " << keyframe->tick << " is bad (" << e.what() << ")." << std::endl;
+			return;
 		}
+		playback_tick = size_t(keyframe->tick);
 	}
-}
-
-void RaidenMode::player_shoot() {
-	if (!bullet_pool.empty())
-	{
-		int index = bullet_pool.front();
-		bullet_pool.pop_front();
-		all_bullets[index].bullet_position = glm::vec2(bot_fighter.x, bot_fighter.y + fighter_radius.y + 0.05f);
-		all_bullets[index].shoot_dir = 1;
-		all_bullets[index].owner = 0;
-		all_bullets[index].bullet_velocity = glm::vec2(0.0f, all_bullets[index].shoot_dir * 1.0f);
-		all_bullets[index].bullet_lifetime = BULLET_LIFETIME;
-		all_bullets[index].in_bullet_pool = false;
+	if (playback_tick > tick) {
+		std::cerr << "Can't seek back to tick " << tick << ": this replay has no keyframe before it." << std::endl;
+		return;
 	}
-	else
-	{
-		Bullet b(glm::vec2(bot_fighter.x, bot_fighter.y + fighter_radius.y + 0.05f), 7.0f, 0, 1);
-		all_bullets.push_back(b);
+	float elapsed = 1.0f / replay.tick_rate;
+	while (playback_tick < tick) {
+		game.curr_status = replay.inputs[playback_tick];
+		playback_tick += 1;
+		game.update(elapsed);
 	}
+	//(nothing is moving between the restored ticks, so don't interpolate from stale positions)
+	game.previous_bot_fighter = game.bot_fighter;
+	//(and effects from the skipped ticks would all go off at once)
+	game.impacts.clear();
+	particles.clear();
+	impacts_shown = game.tick;
 }
 
-bool RaidenMode::check_collision(const std::vector<glm::vec2>& points, const glm::vec4& box) {
-	for (int i = 0; i < points.size(); i++)
-	{
-		if (points[i].x >= box[0] && points[i].x <= box[1]
-			&& points[i].y >= box[2] && points[i].y <= box[3])
-		{
-			return true;
+bool RaidenMode::save_snapshot(std::vector< uint8_t > &out) const {
+	//(a client's game is only what it was shown -- not a state that could be played on)
+	if (client) return false;
+	game.save_state(out);
+	return true;
+}
+
+void RaidenMode::load_snapshot(uint8_t const *data, size_t size) {
+	//(the peer would have no way to follow)
+	if (rollback) throw std::runtime_error("Can't load a snapshot in a co-op game.");
+	if (client) throw std::runtime_error("Can't load a snapshot into a server's game.");
+	game.load_state(data, size);
+	particles.clear();
+	impacts_shown = game.tick;
+	if (playing_back) {
+		playback_tick = size_t(std::min< uint64_t >(game.tick, replay.inputs.size()));
+	}
+	if (!record_filename.empty() && (game.seed != replay.seed || game.tick > replay.inputs.size())) {
+		//the recording can't reach this state from its inputs, so it ends where it was:
+		std::cerr << "Loaded a snapshot from outside the recording; stopping the recording." << std::endl;
+		finish_recording();
+	}
+	if (!record_filename.empty()) {
+		//keep the recording consistent: inputs and keyframes past the restored tick never happened
+		if (game.tick < replay.inputs.size()) replay.inputs.resize(size_t(game.tick));
+		while (!replay.keyframes.empty() && replay.keyframes.back().tick > game.tick) {
+			replay.keyframes.pop_back();
 		}
 	}
-	return false;
+	game.previous_bot_fighter = game.bot_fighter;
 }
 
-void RaidenMode::update_bullet(float elapsed, int random) {
-	for (int i=0; i<all_bullets.size(); i++)
-	{
-		Bullet& b = all_bullets[i];
-		if (b.in_bullet_pool)
-			continue;
+void RaidenMode::start_coop(uint32_t player, uint16_t port, NetAddress const &peer, NetShim const &shim, float tick_rate) {
+	socket.reset(new UdpSocket(port, shim));
+	rollback.reset(new Rollback(game, *socket, peer, player, game.seed, tick_rate));
+	std::cout << "Co-op: player " << player + 1 << " on port " << socket->port() << ", waiting for " << peer.to_string() << "." << std::endl;
+}
 
-		if (b.bullet_lifetime <= 0)
-		{
-			bullet_pool.push_back(i);
-			b.in_bullet_pool = true;
-		}
-		else
-		{
-			b.bullet_position += b.bullet_speed * b.bullet_velocity * elapsed;
-			if (b.owner == 0)
-			{
-				if (b.bullet_position.y > COURT_RADIUS.y - b.bullet_radius.y)
-				{
-					b.bullet_position.y = COURT_RADIUS.y - b.bullet_radius.y;
-					if (b.bullet_velocity.y > 0.0f)
-					{
-						b.bullet_velocity.y = -b.bullet_velocity.y;
-						b.bullet_velocity.x -= BULLET_DEVIATION_VALUE * random;
-					}
-				}
-				if (b.bullet_position.y < -COURT_RADIUS.y + b.bullet_radius.y)
-				{
-					b.bullet_position.y = -COURT_RADIUS.y + b.bullet_radius.y;
-					if (b.bullet_velocity.y < 0.0f)
-					{
-						b.bullet_velocity.y = -b.bullet_velocity.y;
-						b.bullet_velocity.x += -BULLET_DEVIATION_VALUE * random;
-					}
-				}
-
-				if (b.bullet_position.x > COURT_RADIUS.x - b.bullet_radius.x)
-				{
-					b.bullet_position.x = COURT_RADIUS.x - b.bullet_radius.x;
-					if (b.bullet_velocity.x > 0.0f)
-					{
-						b.bullet_velocity.x = -b.bullet_velocity.x;
-						b.bullet_velocity.y -= BULLET_DEVIATION_VALUE * random;
-					}
-				}
-				if (b.bullet_position.x < -COURT_RADIUS.x + b.bullet_radius.x)
-				{
-					b.bullet_position.x = -COURT_RADIUS.x + b.bullet_radius.x;
-					if (b.bullet_velocity.x < 0.0f)
-					{
-						b.bullet_velocity.x = -b.bullet_velocity.x;
-						b.bullet_velocity.y += -BULLET_DEVIATION_VALUE * random;
-					}
-				}
-			}
+void RaidenMode::start_client(NetAddress const &server, NetShim const &shim) {
+	socket.reset(new UdpSocket(0, shim));
+	client.reset(new StateClient(*socket, server));
+	view_arrived = std::chrono::steady_clock::now();
+	std::cout << "Client: connecting to " << server.to_string() << "." << std::endl;
+}
 
-			// ------ Check Collision ------ //
-			{
-				glm::vec2 p1 = glm::vec2(b.bullet_position.x - b.bullet_radius.x, b.bullet_position.y);
-				glm::vec2 p2 = glm::vec2(b.bullet_position.x + b.bullet_radius.x, b.bullet_position.y);
-				glm::vec2 p3 = glm::vec2(b.bullet_position.x, b.bullet_position.y + b.bullet_radius.y);
-				glm::vec2 p4 = glm::vec2(b.bullet_position.x, b.bullet_position.y - b.bullet_radius.y);
-
-				std::vector<glm::vec2> points = { p1,p2,p3,p4 };
-				if (check_collision(points, player_collision_box))
-				{
-					bullet_pool.push_back(i);
-					b.in_bullet_pool = true;
-					//std::cout << "Player hit" << std::endl;
-					player_health -= BULLET_DAMAGE;
-					//if (player_health <= 0)
-
-				}
-
-				if (b.owner == 0)
-				{
-					for (int index = 0; index < all_enemies.size(); index++)
-					{
-						if (!all_enemies[index].is_in_pool && check_collision(points, all_enemies[index].enemy_collision_box))
-						{
-							//std::cout << "enemy hit" << std::endl;
-							bullet_pool.push_back(i);
-							b.in_bullet_pool = true;
-							all_enemies[index].enemy_health -= BULLET_DAMAGE;
-							if (all_enemies[index].enemy_health <= 0)
-							{
-								enemy_pool.push_back(index);
-								all_enemies[index].is_in_pool = true;
-								killed_enemies_num++;
-								//std::cout << "enemy dead" << std::endl;
-							}
-						}
-					}
-				}
+void RaidenMode::update(float elapsed) {
+	if (client) {
+		if (client->poll()) {
+			auto now = std::chrono::steady_clock::now();
+			float interval = std::chrono::duration< float >(now - view_arrived).count();
+			view_interval = glm::mix(view_interval, std::min(interval, 0.5f), 0.1f);
+			view_arrived = now;
+			if (!told_started) {
+				std::cout << "Client: receiving views." << std::endl;
+				told_started = true;
 			}
-
-			b.bullet_lifetime -= elapsed;
+			client->latest()->apply(client->previous(), game);
 		}
+		client->send_input(keys);
+		particles.update(elapsed);
+		return;
 	}
-}
-
-void RaidenMode::update(float elapsed) {
-
-	//static std::mt19937 mt(std::random_device{}()); //mersenne twister pseudo-random number generator
-
-	//debug_log();
-
-	if (player_health <= 0){
-		generate_enemies(elapsed);
-		update_enemies(elapsed);
+	if (rollback) {
+		rollback->advance(keys);
+		show_impacts();
+		particles.update(elapsed);
+		if (rollback->started && !told_started) {
+			std::cout << "Co-op: connected (seed " << rollback->seed << ")." << std::endl;
+			told_started = true;
+		}
+		if (rollback->disconnected && !told_disconnected) {
+			std::cout << "Co-op: the other player has gone quiet; flying on alone." << std::endl;
+			told_disconnected = true;
+		}
 		return;
 	}
+	if (playing_back) {
+		if (ticks_played == 0) {
+			playback_start = std::chrono::high_resolution_clock::now();
+		}
+		if (playback_tick == replay.inputs.size()) {
+			double seconds = std::chrono::duration< double >(std::chrono::high_resolution_clock::now() - playback_start).count();
+			std::cout << "Replay finished: played " << ticks_played << " ticks in " << seconds << " s ("
+				<< (seconds > 0.0 ? ticks_played / seconds : 0.0) << " ticks/s)." << std::endl;
+			Mode::set_current(nullptr);
+			return;
+		}
+		game.curr_status = replay.inputs[playback_tick];
+		playback_tick += 1;
+		ticks_played += 1;
+	} else {
+		game.curr_status = keys;
+	}
+	if (!record_filename.empty()) {
+		replay.inputs.emplace_back(uint8_t(game.curr_status));
+	}
+	game.update(elapsed);
+	if (!record_filename.empty()) {
+		record_keyframe();
+	}
+	show_impacts();
+	particles.update(elapsed);
+}
 
-	// Execute Keyboard event
-	execute_event(elapsed);
-	
-	// Update bullet
-	int r = mt() % 2 == 0 ? 1 : -1;
-	update_bullet(elapsed, r);
-
-	//clamp fighters to court:
-	bot_fighter.x = std::max(bot_fighter.x, -COURT_RADIUS.x + fighter_radius.x);
-	bot_fighter.x = std::min(bot_fighter.x, COURT_RADIUS.x - fighter_radius.x);
-	bot_fighter.y = std::max(bot_fighter.y, -COURT_RADIUS.y + fighter_radius.y);
-	bot_fighter.y = std::min(bot_fighter.y, COURT_RADIUS.y - fighter_radius.y);
-	
-	// Enemy
-	generate_enemies(elapsed);
-	update_enemies(elapsed);
-	enemy_shoot(elapsed);
-
-	update_game_data();
+void RaidenMode::show_impacts() {
+	Particles::Burst spark; //bullet hit an enemy
+	spark.count = 12;
+	spark.speed_min = 0.5f;
+	spark.speed_max = 2.5f;
+	spark.lifetime_min = 0.1f;
+	spark.lifetime_max = 0.3f;
+	spark.size = 0.025f;
+	spark.color = glm::u8vec4(0xf2, 0xd2, 0xb6, 0xff);
+
+	Particles::Burst debris = spark; //...and destroyed it
+	debris.count = 64;
+	debris.speed_max = 4.0f;
+	debris.lifetime_min = 0.3f;
+	debris.lifetime_max = 0.9f;
+	debris.size = 0.04f;
+	debris.color = glm::u8vec4(0xbb, 0x44, 0x30, 0xff);
+
+	for (RaidenGame::Impact const &impact : game.impacts) {
+		//(after a rollback, re-run ticks report their impacts again)
+		if (impact.tick <= impacts_shown) continue;
+		//sparks glance off along the bullet; debris keeps a little of its push:
+		if (impact.destroyed) {
+			particles.emit(impact.position, 0.1f * impact.velocity, debris);
+		} else {
+			particles.emit(impact.position, -0.2f * impact.velocity, spark);
+		}
+	}
+	game.impacts.clear();
+	impacts_shown = game.tick;
 }
 
 void RaidenMode::draw(glm::uvec2 const &drawable_size) {
@@ -454,6 +391,7 @@ void RaidenMode::draw(glm::uvec2 const &drawable_size) {
 	#define HEX_TO_U8VEC4( HX ) (glm::u8vec4( (HX >> 24) & 0xff, (HX >> 16) & 0xff, (HX >> 8) & 0xff, (HX) & 0xff ))
 	const glm::u8vec4 bg_color = HEX_TO_U8VEC4(0x191716ff);
 	const glm::u8vec4 player_color = HEX_TO_U8VEC4(0xf2d2b6ff);
+	const glm::u8vec4 wing_color = HEX_TO_U8VEC4(0xbacac0ff);
 	const glm::u8vec4 enemy_color = HEX_TO_U8VEC4(0xbb4430ff);
 	const glm::u8vec4 shadow_color = HEX_TO_U8VEC4(0xf2ad94ff);
 	// Green, good
@@ -462,11 +400,6 @@ void RaidenMode::draw(glm::uvec2 const &drawable_size) {
 	const glm::u8vec4 health_color_y = HEX_TO_U8VEC4(0xfdde9aff);
 	// Red, not good
 	const glm::u8vec4 health_color_r = HEX_TO_U8VEC4(0xda3d19ff);
-	const std::vector< glm::u8vec4 > trail_colors = {
-		HEX_TO_U8VEC4(0xf2ad9488),
-		HEX_TO_U8VEC4(0xf2897288),
-		HEX_TO_U8VEC4(0xbacac088),
-	};
 	#undef HEX_TO_U8VEC4
 
 	//other useful drawing constants:
@@ -477,7 +410,11 @@ void RaidenMode::draw(glm::uvec2 const &drawable_size) {
 	//---- compute vertices to draw ----
 
 	//vertices will be accumulated into this list and then uploaded+drawn at the end of this function:
-	std::vector< Vertex > vertices;
+	// (it lives in the frame arena, with room for everything up front: 6 per bullet, particle, or health bar,
+	//  and 24 per fighter -- body, wings, and shadow)
+	FrameVector< Vertex > vertices{FrameAllocator< Vertex >(*Mode::frame_arena)};
+	vertices.reserve(6 * (game.player_bullets.size() + game.enemy_bullets.size() + particles.size() + 2)
+		+ 24 * (game.world.size() + 2));
 
 	//inline helper function for rectangle drawing:
 	auto draw_rectangle = [&vertices](glm::vec2 const &center, glm::vec2 const &radius, glm::u8vec4 const &color) {
@@ -513,36 +450,39 @@ void RaidenMode::draw(glm::uvec2 const &drawable_size) {
 		draw_rectangle(rect2_pos, glm::vec2(back_wings_length, back_wings_length), color);
 	};
 
-	auto draw_bullets = [&]()
+	//positions are drawn part way between the last two ticks:
+	float alpha = render_alpha;
+	if (client) {
+		alpha = std::min(1.0f, std::chrono::duration< float >(std::chrono::steady_clock::now() - view_arrived).count() / view_interval);
+	}
+
+	auto draw_bullets = [&](const Bullets& bullets, const glm::u8vec4& color)
 	{
-		for (const auto& b : all_bullets)
+		for (size_t i = 0; i < bullets.size(); i++)
 		{
-			if (!b.in_bullet_pool)
-			{
-				const glm::u8vec4& bullet_color = b.owner == 0 ? player_color : enemy_color;
-				draw_rectangle(b.bullet_position, b.bullet_radius, bullet_color);
-			}
+			draw_rectangle(glm::mix(bullets.previous_positions[i], bullets.positions[i], alpha), bullets.archetype.radius, color);
 		}
 	};
 
 	auto draw_enemies = [&]()
 	{
-		for (const auto& e : all_enemies)
+		game.world.each< RaidenGame::Enemy, RaidenGame::Body >([&](Entity const &, RaidenGame::Enemy const &, RaidenGame::Body const &body)
 		{
-			if (!e.is_in_pool)
-				draw_figher(e.enemy_position, e.enemy_radius, enemy_color, -1);
-		}
+			draw_figher(glm::mix(body.previous_position, body.position, alpha), ENEMY_RADIUS, enemy_color, -1);
+		});
 	};
 
-	auto draw_health = [&]()
+	//(in co-op, the bar is split: the top half is the first fighter's, the bottom half the wing's)
+	auto draw_health = [&](float health, uint32_t bar, uint32_t bars)
 	{
-		if (player_health <= 0)
+		if (health <= 0)
 			return;
 
-		float health_propertion = player_health / PLAYER_HEALTH;
+		float health_propertion = health / PLAYER_HEALTH;
 		float difference = (1.0f - health_propertion) * COURT_RADIUS.x;
-		glm::vec2 health_bar_pos = glm::vec2(0 - difference, -COURT_RADIUS.y-1.5f*HEALTH_UI_RADIUS-padding/2.0f); 
-		glm::vec2 health_bar_radius = glm::vec2((COURT_RADIUS.x + padding) * health_propertion, padding + 1.5f*HEALTH_UI_RADIUS);
+		float bar_radius = (padding + 1.5f*HEALTH_UI_RADIUS) / bars;
+		glm::vec2 health_bar_pos = glm::vec2(0 - difference, -COURT_RADIUS.y-1.5f*HEALTH_UI_RADIUS-padding/2.0f + bar_radius * (bars - 1 - 2 * bar));
+		glm::vec2 health_bar_radius = glm::vec2((COURT_RADIUS.x + padding) * health_propertion, bar_radius);
 
 		glm::u8vec4 health_color = health_propertion > 0.6f ? health_color_g : 
 									health_propertion > 0.4f ? health_color_y:
@@ -557,13 +497,33 @@ void RaidenMode::draw(glm::uvec2 const &drawable_size) {
 
 
 	//Game objects:
-	if (player_health > 0){
-		draw_figher(bot_fighter, fighter_radius, player_color, 1);
-		draw_diamond(bot_fighter+s, fighter_radius, shadow_color);
-		draw_bullets();
+	if (game.player_health > 0){
+		glm::vec2 fighter_at = glm::mix(game.previous_bot_fighter, game.bot_fighter, alpha);
+		draw_figher(fighter_at, game.fighter_radius, player_color, 1);
+		draw_diamond(fighter_at+s, game.fighter_radius, shadow_color);
+	}
+	if (game.wing.active && game.wing.health > 0){
+		glm::vec2 fighter_at = glm::mix(game.wing.previous_position, game.wing.position, alpha);
+		draw_figher(fighter_at, game.fighter_radius, wing_color, 1);
+		draw_diamond(fighter_at+s, game.fighter_radius, shadow_color);
+	}
+	if (!game.game_over()){
+		draw_bullets(game.player_bullets, player_color);
+		draw_bullets(game.enemy_bullets, enemy_color);
 	}
 	draw_enemies();
-	draw_health();
+	if (!particles.empty()){
+		//(all at once, straight into the vertex array)
+		size_t at = vertices.size();
+		vertices.resize(at + 6 * size_t(particles.size()));
+		vertices.resize(at + particles.write_quads(vertices.data() + at, alpha));
+	}
+	if (game.wing.active){
+		draw_health(game.player_health, 0, 2);
+		draw_health(game.wing.health, 1, 2);
+	} else {
+		draw_health(game.player_health, 0, 1);
+	}
 
 
 	//------ compute court-to-window transform ------
@@ -619,10 +579,14 @@ void RaidenMode::draw(glm::uvec2 const &drawable_size) {
 	//don't use the depth test:
 	glDisable(GL_DEPTH_TEST);
 
-	//upload vertices to vertex_buffer:
-	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer); //set vertex_buffer as current
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(vertices[0]), vertices.data(), GL_STREAM_DRAW); //upload vertices array
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	//upload vertices into this frame's part of the vertex stream:
+	size_t first = Mode::vertex_stream->upload(vertices.data(), vertices.size() * sizeof(vertices[0]), sizeof(vertices[0])) / sizeof(vertices[0]);
+	if (vertex_generation != Mode::vertex_stream->generation) {
+		//the stream moved to a bigger buffer, so the vertex array needs to read from that one:
+		vertex_buffer = Mode::vertex_stream->buffer;
+		vertex_generation = Mode::vertex_stream->generation;
+		point_vertex_array();
+	}
 
 	//set color_texture_program as current program:
 	glUseProgram(color_texture_program.program);
@@ -638,7 +602,7 @@ void RaidenMode::draw(glm::uvec2 const &drawable_size) {
 	glBindTexture(GL_TEXTURE_2D, white_tex);
 
 	//run the OpenGL pipeline:
-	glDrawArrays(GL_TRIANGLES, 0, GLsizei(vertices.size()));
+	glDrawArrays(GL_TRIANGLES, GLint(first), GLsizei(vertices.size()));
 
 	//unbind the solid white texture:
 	glBindTexture(GL_TEXTURE_2D, 0);
@@ -0,0 +1,160 @@
+#include "Replay.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+//file layout (all little-endian):
+//  magic "9SRR", version (u32), seed (u64), tick_rate (f32), tick count (u64), run count (u64),
+//  then each run as input (u8) + length (u32).
+//version 2 adds, after the runs:
+//  keyframe interval (u32), then each keyframe's state bytes, back to back,
+//  then the index: keyframe count (u64), and per keyframe tick (u64) + offset in file (u64) + size (u64),
+//  and last of all the offset of the index (u64), so readers can find it from the end of the file.
+
+static const char Magic[4] = {'9', 'S', 'R', 'R'};
+static const uint32_t Version = 2;
+
+static void write_le(std::ostream &out, uint64_t value, uint32_t bytes) {
+	for (uint32_t b = 0; b < bytes; ++b) {
+		out.put(char((value >> (8 * b)) & 0xff));
+	}
+}
+
+static uint64_t read_le(std::istream &in, uint32_t bytes) {
+	uint64_t value = 0;
+	for (uint32_t b = 0; b < bytes; ++b) {
+		int c = in.get();
+		if (c == EOF) throw std::runtime_error("Replay file ends early.");
+		value |= uint64_t(uint8_t(c)) << (8 * b);
+	}
+	return value;
+}
+
+void Replay::save(std::string const &filename) const {
+	std::ofstream file(filename.c_str(), std::ios::binary);
+	if (!file) throw std::runtime_error("Failed to open replay file '" + filename + "' for writing.");
+
+	uint32_t tick_rate_bits;
+	static_assert(sizeof(tick_rate_bits) == sizeof(tick_rate), "float should be 32 bits");
+	std::memcpy(&tick_rate_bits, &tick_rate, sizeof(tick_rate_bits));
+
+	//count runs first, so the header can say how many follow:
+	uint64_t runs = 0;
+	for (size_t i = 0; i < inputs.size(); ++i) {
+		if (i == 0 || inputs[i] != inputs[i - 1]) runs += 1;
+	}
+
+	file.write(Magic, sizeof(Magic));
+	write_le(file, Version, 4);
+	write_le(file, seed, 8);
+	write_le(file, tick_rate_bits, 4);
+	write_le(file, inputs.size(), 8);
+	write_le(file, runs, 8);
+
+	for (size_t begin = 0; begin < inputs.size(); ) {
+		size_t end = begin + 1;
+		while (end < inputs.size() && inputs[end] == inputs[begin] && end - begin < 0xffffffffu) ++end;
+		write_le(file, inputs[begin], 1);
+		write_le(file, end - begin, 4);
+		begin = end;
+	}
+
+	write_le(file, keyframe_interval, 4);
+	std::vector< uint64_t > offsets;
+	offsets.reserve(keyframes.size());
+	for (auto const &keyframe : keyframes) {
+		offsets.emplace_back(uint64_t(file.tellp()));
+		file.write(reinterpret_cast< char const * >(keyframe.state.data()), keyframe.state.size());
+	}
+
+	uint64_t index_offset = uint64_t(file.tellp());
+	write_le(file, keyframes.size(), 8);
+	for (size_t k = 0; k < keyframes.size(); ++k) {
+		write_le(file, keyframes[k].tick, 8);
+		write_le(file, offsets[k], 8);
+		write_le(file, keyframes[k].state.size(), 8);
+	}
+	write_le(file, index_offset, 8);
+
+	if (!file) throw std::runtime_error("Failed to write replay to '" + filename + "'.");
+}
+
+Replay Replay::load(std::string const &filename) {
+	std::ifstream file(filename.c_str(), std::ios::binary);
+	if (!file) throw std::runtime_error("Failed to open replay file '" + filename + "'.");
+
+	char magic[4];
+	if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, Magic, sizeof(Magic)) != 0) {
+		throw std::runtime_error("'" + filename + "' is not a replay file.");
+	}
+	uint32_t version = uint32_t(read_le(file, 4));
+	if (version != 1 && version != Version) {
+		throw std::runtime_error("Replay '" + filename + "' has version " + std::to_string(version) + "; expecting " + std::to_string(Version) + ".");
+	}
+
+	Replay replay;
+	replay.seed = read_le(file, 8);
+	uint32_t tick_rate_bits = uint32_t(read_le(file, 4));
+	std::memcpy(&replay.tick_rate, &tick_rate_bits, sizeof(tick_rate_bits));
+	uint64_t ticks = read_le(file, 8);
+	uint64_t runs = read_le(file, 8);
+
+	replay.inputs.reserve(size_t(ticks));
+	for (uint64_t r = 0; r < runs; ++r) {
+		uint8_t input = uint8_t(read_le(file, 1));
+		uint64_t length = read_le(file, 4);
+		if (replay.inputs.size() + length > ticks) throw std::runtime_error("Replay '" + filename + "' has more inputs than ticks.");
+		replay.inputs.insert(replay.inputs.end(), size_t(length), input);
+	}
+	if (replay.inputs.size() != ticks) throw std::runtime_error("Replay '" + filename + "' has fewer inputs than ticks.");
+	if (!(replay.tick_rate > 0.0f)) throw std::runtime_error("Replay '" + filename + "' has a bad tick rate.");
+
+	if (version == 1) { //(no keyframes)
+		replay.keyframe_interval = 0;
+		return replay;
+	}
+
+	replay.keyframe_interval = uint32_t(read_le(file, 4));
+	uint64_t keyframes_begin = uint64_t(file.tellg());
+
+	//find the index via the offset at the very end:
+	file.seekg(-8, std::ios::end);
+	uint64_t index_end = uint64_t(file.tellg());
+	uint64_t index_offset = read_le(file, 8);
+	if (index_offset < keyframes_begin || index_offset + 8 > index_end) throw std::runtime_error("Replay '" + filename + "' has a bad keyframe index.");
+	file.seekg(std::streamoff(index_offset));
+	uint64_t count = read_le(file, 8);
+	if (count > (index_end - index_offset - 8) / 24) throw std::runtime_error("Replay '" + filename + "' has a bad keyframe index.");
+
+	replay.keyframes.resize(size_t(count));
+	std::vector< uint64_t > offsets(static_cast< size_t >(count)), sizes(static_cast< size_t >(count));
+	for (uint64_t k = 0; k < count; ++k) {
+		replay.keyframes[k].tick = read_le(file, 8);
+		offsets[k] = read_le(file, 8);
+		sizes[k] = read_le(file, 8);
+		if (offsets[k] < keyframes_begin || offsets[k] + sizes[k] > index_offset
+			|| replay.keyframes[k].tick > ticks || (k > 0 && replay.keyframes[k].tick <= replay.keyframes[k - 1].tick)) {
+			throw std::runtime_error("Replay '" + filename + "' has a bad keyframe index.");
+		}
+	}
+	for (uint64_t k = 0; k < count; ++k) {
+		replay.keyframes[k].state.resize(size_t(sizes[k]));
+		file.seekg(std::streamoff(offsets[k]));
+		if (!file.read(reinterpret_cast< char * >(replay.keyframes[k].state.data()), sizes[k])) {
+			throw std::runtime_error("Replay '" + filename + "' ends early.");
+		}
+	}
+
+	return replay;
+}
+
+Replay::Keyframe const *Replay::keyframe_before(uint64_t tick) const {
+	//first keyframe after 'tick', then step back one:
+	auto after = std::upper_bound(keyframes.begin(), keyframes.end(), tick, [](uint64_t t, Keyframe const &keyframe) {
+		return t < keyframe.tick;
+	});
+	if (after == keyframes.begin()) return nullptr;
+	return &*(after - 1);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * A Replay is everything needed to re-run a game of RaidenGame exactly:
+ * the seed, the tick rate, and the input bits (RaidenGame::curr_status) of every tick.
+ *
+ * Replays can also carry keyframes: full game state (RaidenGame::save_state) saved every
+ * so often while recording. To jump to any tick, load the nearest keyframe at or before it
+ * and simulate the few ticks in between -- see keyframe_before().
+ *
+ * Files are small: inputs are run-length encoded, since held keys repeat for many ticks,
+ * and an index at the end of the file lists where each keyframe is.
+ * save() and load() throw std::runtime_error on failure.
+ */
+
+struct Replay {
+	uint64_t seed = 0;
+	float tick_rate = 120.0f;
+	std::vector< uint8_t > inputs; //input bits for each tick, in order
+
+	struct Keyframe {
+		uint64_t tick = 0; //state after this many ticks (i.e., before inputs[tick] is applied)
+		std::vector< uint8_t > state;
+	};
+	std::vector< Keyframe > keyframes; //in increasing tick order
+	uint32_t keyframe_interval = 1200; //ticks between keyframes when recording (0 = no keyframes)
+
+	//should a recorder that has just reached 'tick' add a keyframe?
+	bool wants_keyframe(uint64_t tick) const {
+		return keyframe_interval != 0 && tick % keyframe_interval == 0 && (keyframes.empty() || keyframes.back().tick < tick);
+	}
+
+	//latest keyframe at or before 'tick' (nullptr if there is none):
+	Keyframe const *keyframe_before(uint64_t tick) const;
+
+	void save(std::string const &filename) const;
+	static Replay load(std::string const &filename);
+};
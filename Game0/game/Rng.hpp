@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+/*
+ * Rng is a counter-based random number generator (SplitMix64):
+ * draw 'i' of a generator is a hash of (key, i), so any draw can be computed
+ * directly -- at(i) -- without producing the ones before it.
+ *
+ * stream(id) derives an independent generator from this one. Give each system
+ * (and, where order could vary, each entity or tick) its own stream, and draws
+ * come out the same no matter which thread makes them or in what order:
+ *
+ *   Rng root(seed);
+ *   Rng spawn = root.stream(Spawn);            //per system
+ *   uint32_t roll = spawn.stream(tick).below(100); //per tick
+ *
+ * Also usable as a C++ UniformRandomBitGenerator (operator(), min(), max()),
+ * though std:: distributions differ between standard libraries, so prefer
+ * below() and uniform() when results must match across platforms.
+ */
+
+struct Rng {
+	explicit Rng(uint64_t seed = 0) : key(mix(seed)) { }
+
+	//an independent generator, determined by this generator's key and 'id':
+	// (its counter starts at zero no matter how many draws this one has made)
+	Rng stream(uint64_t id) const { return Rng(key ^ mix(id + 0x632be59bd9b4e019ull)); }
+
+	//draw 'index' of this generator (doesn't change the counter):
+	uint64_t at(uint64_t index) const { return mix(key + (index + 1) * 0x9e3779b97f4a7c15ull); }
+
+	//next draw, advancing the counter:
+	uint64_t next() { return at(counter++); }
+
+	//uniform in [0, n) (n > 0):
+	uint32_t below(uint32_t n) { return uint32_t(((next() >> 32) * n) >> 32); }
+
+	//uniform in [0, 1):
+	float uniform() { return float(next() >> 40) * (1.0f / 16777216.0f); }
+	float uniform(float lo, float hi) { return lo + (hi - lo) * uniform(); }
+
+	//UniformRandomBitGenerator interface:
+	typedef uint32_t result_type;
+	static constexpr result_type min() { return 0; }
+	static constexpr result_type max() { return std::numeric_limits< result_type >::max(); }
+	result_type operator()() { return result_type(next() >> 32); }
+
+	uint64_t key;
+	uint64_t counter = 0; //draws made so far (by next())
+
+	//SplitMix64 finalizer (a good 64-bit hash):
+	static uint64_t mix(uint64_t z) {
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+		return z ^ (z >> 31);
+	}
+};
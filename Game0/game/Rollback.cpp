@@ -0,0 +1,177 @@
+#include "Rollback.hpp"
+
+#include "ByteStream.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+static const uint32_t PacketMagic = 0x4b434252; //"RBCK"
+
+Rollback::Rollback(RaidenGame &game_, UdpSocket &socket_, NetAddress const &peer_, uint32_t player_, uint64_t seed_, float tick_rate)
+	: game(game_), socket(socket_), peer(peer_), player(player_), seed(seed_), elapsed(1.0f / tick_rate) {
+	if (player > 1) throw std::runtime_error("Rollback player must be 0 or 1.");
+	static_assert(ROLLBACK_INPUT_RING > 2 * ROLLBACK_MAX_FRAMES + 1, "input ring must cover every unacknowledged tick");
+}
+
+int Rollback::remote_input(uint64_t tick) const {
+	if (tick < remote_count) return remote_inputs[tick % ROLLBACK_INPUT_RING];
+	//(once the peer is gone, its fighter just drifts to a stop)
+	if (remote_count == 0 || disconnected) return EventStatus::none;
+	return remote_inputs[(remote_count - 1) % ROLLBACK_INPUT_RING];
+}
+
+void Rollback::simulate() {
+	uint64_t tick = game.tick;
+	//a tick that runs on a predicted input may need to be run again:
+	if (tick >= remote_count && !disconnected) {
+		std::vector< uint8_t > &snapshot = snapshots[tick % ROLLBACK_MAX_FRAMES];
+		snapshot.clear();
+		game.save_state(snapshot);
+	}
+	int local = local_inputs[tick % ROLLBACK_INPUT_RING];
+	int remote = remote_input(tick);
+	used_inputs[tick % ROLLBACK_INPUT_RING] = uint8_t(remote);
+	game.curr_status = (player == 0 ? local : remote);
+	game.wing.status = (player == 0 ? remote : local);
+	game.update(elapsed);
+}
+
+void Rollback::rollback() {
+	auto before = std::chrono::high_resolution_clock::now();
+	uint64_t present = game.tick;
+	assert(rollback_from < present && present - rollback_from <= ROLLBACK_MAX_FRAMES);
+	std::vector< uint8_t > const &snapshot = snapshots[rollback_from % ROLLBACK_MAX_FRAMES];
+	game.load_state(snapshot.data(), snapshot.size());
+	assert(game.tick == rollback_from);
+	//(these ticks were profiled the first time they ran)
+	RaidenGame::EmitterProfile *profile = game.profile;
+	game.profile = nullptr;
+	while (game.tick < present) {
+		simulate();
+	}
+	game.profile = profile;
+	double ms = std::chrono::duration< double, std::milli >(std::chrono::high_resolution_clock::now() - before).count();
+
+	uint32_t depth = uint32_t(present - rollback_from);
+	stats.rollbacks += 1;
+	stats.resimulated += depth;
+	stats.max_depth = std::max(stats.max_depth, depth);
+	stats.total_rollback_ms += ms;
+	stats.max_rollback_ms = std::max(stats.max_rollback_ms, ms);
+}
+
+void Rollback::poll() {
+	NetAddress from;
+	while (socket.receive(&packet, &from)) {
+		if (from != peer) continue;
+		stats.packets += 1;
+		try {
+			receive();
+		} catch (std::runtime_error const &) {
+			stats.bad_packets += 1;
+		}
+	}
+
+	if (started && !disconnected
+		&& std::chrono::duration< float >(std::chrono::steady_clock::now() - last_heard).count() > ROLLBACK_TIMEOUT) {
+		disconnected = true;
+	}
+
+	if (rollback_from < game.tick) {
+		rollback();
+	}
+	rollback_from = -1ULL;
+
+	send();
+}
+
+bool Rollback::advance(int input) {
+	poll();
+	if (!started) {
+		stats.waits += 1;
+		return false;
+	}
+	if (!disconnected) {
+		//too far past the peer's input (or too much of ours it hasn't acknowledged):
+		if (game.tick >= remote_count + ROLLBACK_MAX_FRAMES || game.tick >= peer_ack + ROLLBACK_INPUT_RING - 1) {
+			stats.waits += 1;
+			return false;
+		}
+		//the peers see each other through the same latency, so if this one thinks it is further ahead than
+		// the peer does, it is running fast -- wait a tick (now and then) to let the peer catch up:
+		int32_t advantage = int32_t(int64_t(game.tick) - int64_t(peer_tick));
+		if ((advantage - peer_advantage) / 2 >= 1 && game.tick >= last_sync_wait + ROLLBACK_SYNC_INTERVAL) {
+			last_sync_wait = game.tick;
+			stats.waits += 1;
+			return false;
+		}
+	}
+
+	local_inputs[game.tick % ROLLBACK_INPUT_RING] = uint8_t(input);
+	simulate();
+	stats.ticks += 1;
+	send();
+	return true;
+}
+
+void Rollback::receive() {
+	ByteReader in(packet.data(), packet.size());
+	if (in.read< uint32_t >() != PacketMagic) throw std::runtime_error("Not a rollback packet.");
+	uint64_t packet_seed = in.read< uint64_t >();
+	if (in.read< uint8_t >() != 1 - player) throw std::runtime_error("Packet from the wrong player.");
+	uint64_t tick = in.read< uint64_t >();
+	uint64_t ack = in.read< uint64_t >();
+	int32_t advantage = in.read< int32_t >();
+	uint64_t first = in.read< uint64_t >();
+	uint8_t count = in.read< uint8_t >();
+	uint8_t inputs[255];
+	in.read_array(inputs, count);
+	if (!in.done()) throw std::runtime_error("Rollback packet has extra data.");
+
+	if (!started) {
+		//the peer is here, so both games start now (player 1 with player 0's seed):
+		if (player == 1) seed = packet_seed;
+		game.reset(seed);
+		game.add_wing();
+		started = true;
+	}
+	last_heard = std::chrono::steady_clock::now();
+	if (tick >= peer_tick) {
+		peer_tick = tick;
+		peer_advantage = advantage;
+	}
+	peer_ack = std::max(peer_ack, std::min(ack, game.tick));
+
+	for (uint32_t i = 0; i < count; ++i) {
+		uint64_t at = first + i;
+		if (at < remote_count) continue; //already have it
+		if (at > remote_count) break; //(can't happen: packets start at our ack)
+		if (remote_count >= game.tick + ROLLBACK_INPUT_RING - ROLLBACK_MAX_FRAMES) break; //(nor this: the peer waits for us)
+		remote_inputs[at % ROLLBACK_INPUT_RING] = inputs[i];
+		if (at < game.tick && used_inputs[at % ROLLBACK_INPUT_RING] != inputs[i]) {
+			rollback_from = std::min(rollback_from, at);
+		}
+		remote_count += 1;
+	}
+}
+
+void Rollback::send() {
+	packet.clear();
+	ByteWriter out(packet);
+	out.write(PacketMagic);
+	out.write(seed);
+	out.write(uint8_t(player));
+	out.write(uint64_t(game.tick));
+	out.write(remote_count);
+	out.write(int32_t(int64_t(game.tick) - int64_t(peer_tick)));
+	//every input the peer hasn't acknowledged (none until the game has started):
+	uint64_t first = (started ? peer_ack : game.tick);
+	uint8_t count = uint8_t(std::min< uint64_t >(game.tick - first, ROLLBACK_INPUT_RING));
+	out.write(first);
+	out.write(count);
+	for (uint64_t t = first; t < first + count; ++t) {
+		out.write(local_inputs[t % ROLLBACK_INPUT_RING]);
+	}
+	socket.send(peer, packet.data(), packet.size());
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "Net.hpp"
+#include "RaidenGame.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#define ROLLBACK_MAX_FRAMES 8 //deepest rollback: neither peer runs more than this many ticks past the input it has confirmed
+#define ROLLBACK_INPUT_RING 64 //input history kept per player (must cover the unacknowledged ticks, about 2 * ROLLBACK_MAX_FRAMES)
+#define ROLLBACK_TIMEOUT 3.0f //seconds without a packet before the peer counts as gone
+#define ROLLBACK_SYNC_INTERVAL 10 //fewest ticks between the waits that keep the peers' clocks together
+
+/*
+ * Rollback plays a two-player co-op RaidenGame over UDP, GGPO style:
+ *  - every tick runs right away, with the local input and a *prediction* of the remote one
+ *    (the last remote input received -- players mostly hold keys down);
+ *  - each packet carries every local input the peer hasn't acknowledged yet, so a lost packet
+ *    is covered by the next one;
+ *  - when a remote input arrives that isn't what was predicted, the game is restored from the
+ *    snapshot (RaidenGame::save_state) taken before that tick and re-simulated to the present;
+ *  - a peer that gets ROLLBACK_MAX_FRAMES ticks past the remote input it has waits (runs no tick),
+ *    which caps how deep -- and so how expensive -- a rollback can be.
+ *
+ * Player 0 flies bot_fighter and picks the seed; player 1 flies the wing (RaidenGame::Wing) and
+ * takes player 0's seed from its packets. Each game is reset (with the wing added) when its peer is
+ * first heard from. The simulation is deterministic, so once both peers have confirmed the same ticks
+ * they have the same state.
+ */
+
+struct Rollback {
+	//'seed' only matters for player 0; 'socket' sends to and hears from 'peer':
+	Rollback(RaidenGame &game, UdpSocket &socket, NetAddress const &peer, uint32_t player, uint64_t seed, float tick_rate);
+
+	//take packets from the peer (re-simulating any mispredicted ticks) and send it the input it still needs:
+	void poll();
+	//poll, then run one tick with 'input' (EventStatus bits) for the local fighter;
+	// returns false -- having run no tick -- while waiting for the peer to connect or catch up:
+	bool advance(int input);
+
+	bool started = false; //the peer has been heard from (and the game reset)
+	bool disconnected = false; //the peer went quiet for ROLLBACK_TIMEOUT; its fighter gets no more input
+	//ticks for which the peer's input is known (these will never be re-simulated):
+	uint64_t confirmed() const { return remote_count; }
+	//the peer has all of the local input so far:
+	bool all_acked() const { return peer_ack >= game.tick; }
+
+	RaidenGame &game;
+	UdpSocket &socket;
+	NetAddress peer;
+	uint32_t player; //0 or 1
+	uint64_t seed;
+	float elapsed; //per tick
+
+	struct Stats {
+		uint64_t ticks = 0; //run by advance()
+		uint64_t waits = 0; //advance() calls that didn't run a tick
+		uint64_t rollbacks = 0;
+		uint64_t resimulated = 0; //ticks re-run by rollbacks
+		uint32_t max_depth = 0; //most ticks re-run by one rollback
+		double total_rollback_ms = 0.0; //restoring + re-simulating
+		double max_rollback_ms = 0.0;
+		uint64_t packets = 0, bad_packets = 0; //received from the peer
+	} stats;
+
+private:
+	//inputs by tick % ROLLBACK_INPUT_RING:
+	uint8_t local_inputs[ROLLBACK_INPUT_RING] = {};
+	uint8_t remote_inputs[ROLLBACK_INPUT_RING] = {};
+	uint8_t used_inputs[ROLLBACK_INPUT_RING] = {}; //remote input each tick last ran with (real or predicted)
+	uint64_t remote_count = 0; //remote inputs received (in order, no gaps)
+	uint64_t peer_ack = 0; //the peer has our inputs before this tick
+	uint64_t peer_tick = 0; //the newest tick the peer has reported running
+	int32_t peer_advantage = 0; //how far the peer thinks it is ahead of us
+	uint64_t last_sync_wait = 0;
+	uint64_t rollback_from = -1ULL; //earliest tick that ran with the wrong remote input
+
+	//state before each unconfirmed tick, by tick % ROLLBACK_MAX_FRAMES:
+	// (each buffer keeps its capacity, so snapshots don't allocate once warmed up)
+	std::vector< uint8_t > snapshots[ROLLBACK_MAX_FRAMES];
+
+	std::chrono::steady_clock::time_point last_heard;
+	std::vector< uint8_t > packet; //scratch for sending + receiving
+
+	int remote_input(uint64_t tick) const; //received or predicted
+	void simulate(); //run tick game.tick
+	void rollback();
+	void receive(); //(the packet in 'packet')
+	void send();
+};
@@ -0,0 +1,125 @@
+#include "RouteTable.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+RouteTable::RouteTable(uint32_t capacity, uint32_t max_points_) : max_points(max_points_), free_ids(capacity) {
+	all_points.assign(size_t(capacity) * max_points, glm::vec2(0.0f));
+	all_distances.assign(size_t(capacity) * max_points, 0.0f);
+	lengths.assign(capacity, 0);
+	loop_lengths.assign(capacity, 0.0f);
+	users.assign(capacity, 0);
+	stats.capacity = capacity;
+}
+
+uint32_t RouteTable::add(glm::vec2 const *points, uint32_t count) {
+	assert(count > 0 && count <= max_points);
+	uint32_t id = free_ids.acquire();
+	if (id == -1U) {
+		stats.failed += 1;
+		return -1U;
+	}
+
+	std::copy(points, points + count, all_points.begin() + size_t(id) * max_points);
+	lengths[id] = count;
+	measure(id);
+
+	users[id] = 1;
+	stats.on_acquire();
+	return id;
+}
+
+void RouteTable::retain(uint32_t id) {
+	assert(id < users.size() && users[id] > 0);
+	users[id] += 1;
+}
+
+void RouteTable::release(uint32_t id) {
+	if (id == -1U) return;
+	assert(id < users.size() && users[id] > 0);
+	users[id] -= 1;
+	if (users[id] == 0) {
+		lengths[id] = 0;
+		loop_lengths[id] = 0.0f;
+		free_ids.release(id);
+		stats.on_release();
+	}
+}
+
+uint32_t RouteTable::seek(uint32_t id, float distance, uint32_t &segment) const {
+	float const *distance_at = distances(id);
+	uint32_t count = lengths[id];
+
+	//move the cursor forward to the segment containing 'distance', restarting if it went past it:
+	if (segment >= count || distance < distance_at[segment]) segment = 0;
+	while (segment + 1 < count && distance >= distance_at[segment + 1]) ++segment;
+	return segment;
+}
+
+glm::vec2 RouteTable::at(uint32_t id, float distance, uint32_t &segment) const {
+	glm::vec2 const *point = points(id);
+	float const *distance_at = distances(id);
+	uint32_t count = lengths[id];
+	float loop = loop_lengths[id];
+
+	seek(id, distance, segment);
+
+	float begin = distance_at[segment];
+	float end = (segment + 1 < count ? distance_at[segment + 1] : loop);
+	glm::vec2 const &next = point[segment + 1 < count ? segment + 1 : 0];
+	float t = (end > begin ? std::min(1.0f, (distance - begin) / (end - begin)) : 0.0f);
+	return glm::mix(point[segment], next, t);
+}
+
+void RouteTable::save(ByteWriter &out) const {
+	out.write(uint32_t(stats.live));
+	for (uint32_t id = 0; id < users.size(); ++id) {
+		if (users[id] == 0) continue;
+		out.write(id);
+		out.write(users[id]);
+		out.write(lengths[id]);
+		out.write_array(points(id), lengths[id]);
+	}
+}
+
+void RouteTable::clear() {
+	std::fill(users.begin(), users.end(), 0);
+	std::fill(lengths.begin(), lengths.end(), 0);
+	std::fill(loop_lengths.begin(), loop_lengths.end(), 0.0f);
+	stats.live = 0;
+	free_ids.reset();
+}
+
+void RouteTable::load(ByteReader &in) {
+	uint32_t capacity = uint32_t(users.size());
+	uint32_t live = in.read< uint32_t >();
+	if (live > capacity) throw std::runtime_error("Saved route table has too many routes.");
+
+	clear();
+
+	for (uint32_t r = 0; r < live; ++r) {
+		uint32_t id = in.read< uint32_t >();
+		uint32_t route_users = in.read< uint32_t >();
+		uint32_t length = in.read< uint32_t >();
+		if (id >= capacity || users[id] != 0 || route_users == 0 || length == 0 || length > max_points) {
+			throw std::runtime_error("Saved route table has a bad route.");
+		}
+		in.read_array(&all_points[size_t(id) * max_points], length);
+		lengths[id] = length;
+		users[id] = route_users;
+		measure(id);
+		free_ids.take(id);
+		stats.on_acquire();
+	}
+}
+
+void RouteTable::measure(uint32_t id) {
+	glm::vec2 const *point = points(id);
+	float *distance = &all_distances[size_t(id) * max_points];
+	uint32_t count = lengths[id];
+	distance[0] = 0.0f;
+	for (uint32_t i = 1; i < count; ++i) {
+		distance[i] = distance[i - 1] + glm::length(point[i] - point[i - 1]);
+	}
+	loop_lengths[id] = distance[count - 1] + glm::length(point[0] - point[count - 1]);
+}
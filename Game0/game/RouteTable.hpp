@@ -0,0 +1,79 @@
+#pragma once
+
+#include "ByteStream.hpp"
+#include "FreeIds.hpp"
+#include "PoolStats.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/*
+ * RouteTable stores enemy routes once, so enemies can refer to them by id.
+ *
+ * A route is a closed loop of points, followed in straight lines at constant speed
+ * (point 0 -> 1 -> ... -> last -> 0 -> ...). When a route is added its arc length is
+ * measured, so a position on it is just a function of the distance travelled (see at()).
+ *
+ * Each route gets a fixed block of 'max_points' entries in contiguous arrays,
+ * so following a route reads its points in order from a single block.
+ * Routes never change once added. They are reference counted: a route stays in
+ * the table while anyone holds a reference, and its id is reused after the last
+ * one is released. (New routes always get the lowest free id.)
+ *
+ * All storage is allocated in the constructor; adding and
+ * releasing routes never allocates.
+ */
+
+struct RouteTable {
+	RouteTable(uint32_t capacity, uint32_t max_points);
+
+	//copy 'count' points (at most max_points) into the table:
+	// returns the new route's id, holding one reference for the caller,
+	// or -1U (and counts a failure) if the table is full.
+	uint32_t add(glm::vec2 const *points, uint32_t count);
+
+	//take / drop a reference to route 'id' (releasing -1U does nothing):
+	void retain(uint32_t id);
+	void release(uint32_t id);
+	//free every route (outstanding ids go stale):
+	void clear();
+	//references held to route 'id' (0 if it's free, or not an id at all):
+	uint32_t references(uint32_t id) const { return id < users.size() ? users[id] : 0; }
+	uint32_t capacity() const { return uint32_t(users.size()); }
+
+	glm::vec2 const *points(uint32_t id) const { return &all_points[size_t(id) * max_points]; }
+	uint32_t length(uint32_t id) const { return lengths[id]; }
+	//distance along the loop from point 0 to each point:
+	float const *distances(uint32_t id) const { return &all_distances[size_t(id) * max_points]; }
+	//distance once around the loop (back to point 0):
+	float loop_length(uint32_t id) const { return loop_lengths[id]; }
+
+	//position 'distance' along route 'id' from point 0, for distance in [0, loop_length(id)]:
+	// 'segment' is a cursor (the point the previous call started from); results don't depend on it,
+	// but passing the same one back each tick makes the lookup O(1) for steadily increasing distances.
+	glm::vec2 at(uint32_t id, float distance, uint32_t &segment) const;
+
+	//move cursor 'segment' to the one containing 'distance' (as at() does), and return it:
+	// segment s runs from points(id)[s] to the next point (wrapping to point 0), over distances(id)[s] to the next
+	// distance (or loop_length(id)), so at() is the mix along it -- for callers that do that mix themselves
+	uint32_t seek(uint32_t id, float distance, uint32_t &segment) const;
+
+	//write / read every live route (read replaces the table's contents; throws on bad data):
+	void save(ByteWriter &out) const;
+	void load(ByteReader &in);
+
+	PoolStats stats;
+
+private:
+	//fill in distances and loop length for route 'id' from its points:
+	void measure(uint32_t id);
+
+	uint32_t max_points;
+	std::vector< glm::vec2 > all_points; //route 'id' is at [id * max_points, id * max_points + lengths[id])
+	std::vector< float > all_distances; //same layout as all_points
+	std::vector< uint32_t > lengths;
+	std::vector< float > loop_lengths;
+	std::vector< uint32_t > users; //references held to each route (0 = free)
+	FreeIds free_ids;
+};
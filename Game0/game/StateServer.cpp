@@ -0,0 +1,155 @@
+#include "StateServer.hpp"
+
+#include "ByteStream.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+static const uint32_t ViewMagic = 0x56535252; //"RRSV" (server to client)
+static const uint32_t InputMagic = 0x43435252; //"RRCC" (client to server)
+
+//------ StateServer ------
+
+StateServer::StateServer(UdpSocket &socket_) : socket(socket_) {
+}
+
+void StateServer::poll() {
+	NetAddress from;
+	auto now = std::chrono::steady_clock::now();
+	while (socket.receive(&packet, &from)) {
+		uint32_t ack = 0;
+		uint8_t input = 0;
+		try {
+			ByteReader in(packet.data(), packet.size());
+			if (in.read< uint32_t >() != InputMagic) throw std::runtime_error("Not a client packet.");
+			in.read(ack);
+			in.read(input);
+			if (!in.done()) throw std::runtime_error("Client packet has extra data.");
+		} catch (std::runtime_error const &) {
+			stats.bad_packets += 1;
+			continue;
+		}
+
+		Client *client = nullptr;
+		for (Client &c : clients) {
+			if (c.address == from) client = &c;
+		}
+		if (!client) {
+			if (clients.size() >= SERVER_MAX_CLIENTS) continue;
+			clients.emplace_back();
+			client = &clients.back();
+			client->address = from;
+			client->connected = now;
+			stats.connects += 1;
+		}
+		client->last_heard = now;
+		client->input = input;
+		//(acks can arrive out of order; only newer ones count)
+		if (ack > client->ack) client->ack = ack;
+	}
+
+	for (auto c = clients.begin(); c != clients.end(); ) {
+		if (std::chrono::duration< float >(now - c->last_heard).count() > SERVER_CLIENT_TIMEOUT) {
+			c = clients.erase(c);
+			stats.timeouts += 1;
+		} else {
+			++c;
+		}
+	}
+}
+
+void StateServer::broadcast(NetView const &view) {
+	sequence += 1;
+	NetView &stored = history[sequence % SERVER_VIEW_HISTORY];
+	stored = view;
+	stored.sequence = sequence;
+
+	for (Client &client : clients) {
+		auto before = std::chrono::high_resolution_clock::now();
+		NetView const &candidate = history[client.ack % SERVER_VIEW_HISTORY];
+		NetView const *baseline = (client.ack != 0 && candidate.sequence == client.ack && client.ack < sequence ? &candidate : nullptr);
+
+		packet.clear();
+		ByteWriter out(packet);
+		out.write(ViewMagic);
+		out.write(uint32_t(baseline ? baseline->sequence : 0));
+		stats.bullets_left_out += stored.encode(baseline, packet);
+		stats.encode_ms += std::chrono::duration< double, std::milli >(std::chrono::high_resolution_clock::now() - before).count();
+
+		socket.send(client.address, packet.data(), packet.size());
+		client.views += 1;
+		client.bytes += packet.size();
+		stats.views += 1;
+		stats.bytes += packet.size();
+		if (!baseline) stats.full_views += 1;
+	}
+}
+
+bool StateServer::pilot_input(int *bits) const {
+	if (clients.empty()) return false;
+	*bits = clients.front().input;
+	return true;
+}
+
+//------ StateClient ------
+
+StateClient::StateClient(UdpSocket &socket_, NetAddress const &server_) : server(server_), socket(socket_) {
+}
+
+bool StateClient::poll() {
+	bool got_newer = false;
+	NetAddress from;
+	while (socket.receive(&packet, &from)) {
+		if (from != server) continue;
+		try {
+			ByteReader in(packet.data(), packet.size());
+			if (in.read< uint32_t >() != ViewMagic) throw std::runtime_error("Not a view packet.");
+			uint32_t baseline_sequence = in.read< uint32_t >();
+			NetView const *baseline = nullptr;
+			if (baseline_sequence != 0) {
+				baseline = &history[baseline_sequence % SERVER_VIEW_HISTORY];
+				if (baseline->sequence != baseline_sequence) {
+					stats.missing_baseline += 1;
+					continue;
+				}
+			}
+			incoming.decode(baseline, packet.data() + in.offset, packet.size() - in.offset);
+		} catch (std::runtime_error const &) {
+			stats.bad_packets += 1;
+			continue;
+		}
+		stats.views += 1;
+		stats.bytes += packet.size();
+		if (incoming.sequence <= newest) {
+			stats.stale += 1;
+			continue;
+		}
+		//(swap, so the slot's old storage becomes the next scratch view)
+		uint32_t sequence = incoming.sequence;
+		std::swap(history[sequence % SERVER_VIEW_HISTORY], incoming);
+		before_newest = newest;
+		newest = sequence;
+		got_newer = true;
+	}
+	return got_newer;
+}
+
+void StateClient::send_input(int bits) {
+	packet.clear();
+	ByteWriter out(packet);
+	out.write(InputMagic);
+	out.write(newest);
+	out.write(uint8_t(bits));
+	socket.send(server, packet.data(), packet.size());
+}
+
+NetView const *StateClient::latest() const {
+	if (newest == 0) return nullptr;
+	return &history[newest % SERVER_VIEW_HISTORY];
+}
+
+NetView const *StateClient::previous() const {
+	if (before_newest == 0) return nullptr;
+	NetView const &view = history[before_newest % SERVER_VIEW_HISTORY];
+	return (view.sequence == before_newest ? &view : nullptr);
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "Net.hpp"
+#include "NetView.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#define SERVER_MAX_CLIENTS 32
+#define SERVER_VIEW_HISTORY 32 //views kept (by both ends) as possible baselines
+#define SERVER_CLIENT_TIMEOUT 3.0f //seconds without a packet before a client is dropped
+
+/*
+ * StateServer / StateClient stream a game from an authoritative server to thin clients:
+ * the server runs the only simulation and sends NetViews; clients draw whatever they
+ * were sent last, and send back their input bits plus the newest view they have.
+ *
+ * Each view goes to each client as a delta against the newest view that client has
+ * acknowledged (see NetView.hpp), or in full if the server no longer has that view;
+ * a lost view just means the next one is a delta against an older baseline.
+ *
+ * The earliest-connected client flies the fighter; later ones watch.
+ */
+
+struct StateServer {
+	explicit StateServer(UdpSocket &socket);
+
+	//take client packets (connecting new clients), and drop clients that have gone quiet:
+	void poll();
+	//send 'view' to every client, as the next view in sequence (its 'sequence' is ignored):
+	void broadcast(NetView const &view);
+	//input bits from the client flying the fighter, if there is one:
+	bool pilot_input(int *bits) const;
+
+	struct Client {
+		NetAddress address;
+		uint32_t ack = 0; //newest view the client has (0: none)
+		int input = 0;
+		std::chrono::steady_clock::time_point connected, last_heard;
+		uint64_t views = 0, bytes = 0; //sent to it
+	};
+	std::vector< Client > clients; //in connection order
+
+	struct Stats {
+		uint64_t views = 0; //view packets sent (one per client per broadcast)
+		uint64_t full_views = 0; //...that had no baseline
+		uint64_t bytes = 0;
+		uint64_t bullets_left_out = 0; //to keep packets under NET_MAX_PACKET
+		uint64_t connects = 0, timeouts = 0, bad_packets = 0;
+		double encode_ms = 0.0; //total time spent encoding
+	} stats;
+
+private:
+	UdpSocket &socket;
+	//views are numbered by broadcast, not by tick, so however often views go out, the history
+	// always holds the last SERVER_VIEW_HISTORY of them:
+	NetView history[SERVER_VIEW_HISTORY]; //by sequence % SERVER_VIEW_HISTORY
+	uint32_t sequence = 0; //of the newest view sent
+	std::vector< uint8_t > packet; //scratch
+};
+
+struct StateClient {
+	StateClient(UdpSocket &socket, NetAddress const &server);
+
+	//take views from the server; returns true if a newer one arrived:
+	bool poll();
+	//send the input bits for the fighter (and acknowledge the newest view); call every tick:
+	void send_input(int bits);
+
+	//the newest view, and the one before it (for drawing in between), if any:
+	NetView const *latest() const;
+	NetView const *previous() const;
+
+	NetAddress server;
+
+	struct Stats {
+		uint64_t views = 0, bytes = 0; //received
+		uint64_t stale = 0; //views older than the newest one (arrived out of order)
+		uint64_t missing_baseline = 0, bad_packets = 0;
+	} stats;
+
+private:
+	UdpSocket &socket;
+	NetView history[SERVER_VIEW_HISTORY]; //by sequence % SERVER_VIEW_HISTORY
+	uint32_t newest = 0, before_newest = 0; //sequences
+	NetView incoming; //scratch for decoding
+	std::vector< uint8_t > packet; //scratch
+};
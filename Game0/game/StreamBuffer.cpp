@@ -0,0 +1,172 @@
+#include "StreamBuffer.hpp"
+
+#include <SDL.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+//from GL_ARB_buffer_storage (core in 4.4, so not in GL.hpp):
+#define STREAM_GL_MAP_PERSISTENT_BIT 0x0040
+#define STREAM_GL_MAP_COHERENT_BIT 0x0080
+typedef void (APIENTRY *BufferStorageProc)(GLenum target, GLsizeiptr size, void const *data, GLbitfield flags);
+
+//glBufferStorage, if this context has it:
+static BufferStorageProc buffer_storage() {
+	static BufferStorageProc proc = (SDL_GL_ExtensionSupported("GL_ARB_buffer_storage")
+		? (BufferStorageProc)SDL_GL_GetProcAddress("glBufferStorage") : nullptr);
+	return proc;
+}
+
+StreamBuffer::StreamBuffer(size_t region_size_) {
+	create(region_size_);
+	std::cout << "Vertex stream: " << STREAM_BUFFER_REGIONS << " x " << region_size / 1024 << " KB, "
+		<< (persistent ? "persistently mapped" : "mapped per upload") << "." << std::endl;
+}
+
+StreamBuffer::~StreamBuffer() {
+	destroy();
+}
+
+void StreamBuffer::create(size_t region_size_) {
+	region_size = region_size_;
+	first_region = 0;
+	region = 0;
+	used = 0;
+	region_ready = false;
+	GLsizeiptr size = GLsizeiptr(region_size * STREAM_BUFFER_REGIONS);
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	persistent = false;
+	if (BufferStorageProc storage = buffer_storage()) {
+		GLbitfield flags = GL_MAP_WRITE_BIT | STREAM_GL_MAP_PERSISTENT_BIT | STREAM_GL_MAP_COHERENT_BIT;
+		storage(GL_ARRAY_BUFFER, size, nullptr, flags);
+		mapped = static_cast< char * >(glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags));
+		persistent = (mapped != nullptr);
+		if (!persistent) {
+			//(immutable storage can't be re-specified, so start over with a plain buffer)
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+			glDeleteBuffers(1, &buffer);
+			glGenBuffers(1, &buffer);
+			glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		}
+	}
+	if (!persistent) {
+		glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	generation += 1;
+}
+
+void StreamBuffer::destroy() {
+	for (GLsync &fence : fences) {
+		if (fence) glDeleteSync(fence);
+		fence = 0;
+	}
+	if (mapped) {
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		mapped = nullptr;
+	}
+	glDeleteBuffers(1, &buffer);
+	buffer = 0;
+}
+
+void StreamBuffer::wait_for_region() {
+	GLsync &fence = fences[region];
+	if (!fence) return;
+	//usually the GPU finished with this region frames ago, and this doesn't wait at all:
+	GLenum result = glClientWaitSync(fence, 0, 0);
+	if (result == GL_TIMEOUT_EXPIRED) {
+		stats.stalls += 1;
+		auto before = std::chrono::high_resolution_clock::now();
+		do {
+			result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(1000000000)); //(1 s at a time)
+		} while (result == GL_TIMEOUT_EXPIRED);
+		stats.stall_ms += std::chrono::duration< double, std::milli >(std::chrono::high_resolution_clock::now() - before).count();
+	}
+	if (result == GL_WAIT_FAILED) {
+		std::cerr << "Vertex stream: waiting on a fence failed." << std::endl;
+	}
+	glDeleteSync(fence);
+	fence = 0;
+}
+
+void StreamBuffer::grow(size_t needed) {
+	//(the old buffer stays alive until the GPU is done with the draws already issued from it)
+	size_t size = std::max(2 * region_size, needed + needed / 2);
+	destroy();
+	create(size);
+	stats.grows += 1;
+}
+
+size_t StreamBuffer::upload(void const *data, size_t size, size_t stride) {
+	if (size == 0) return 0; //(nothing to draw, and zero-length maps are errors)
+	frame_bytes += size + stride;
+
+	//offsets are in the whole buffer, so round up from the region's start:
+	size_t base = region * region_size;
+	size_t offset = (base + used + stride - 1) / stride * stride;
+	if (offset + size > base + region_size) {
+		//this frame needs more room than a region has: carry on in the next region (and grow at end_frame),
+		// unless the frame started there or this doesn't fit in a region anyway -- then grow now
+		uint32_t next = (region + 1) % STREAM_BUFFER_REGIONS;
+		if (next != first_region && size + stride <= region_size) {
+			if (region == first_region) stats.spills += 1;
+			region = next;
+			used = 0;
+			region_ready = false;
+		} else {
+			grow(frame_bytes);
+		}
+		base = region * region_size;
+		offset = (base + stride - 1) / stride * stride;
+	}
+	if (!region_ready) {
+		wait_for_region();
+		region_ready = true;
+	}
+
+	if (persistent) {
+		std::memcpy(mapped + offset, data, size);
+	} else {
+		//(the region's fence already passed, so the driver doesn't need to sync or keep the old contents)
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		void *at = glMapBufferRange(GL_ARRAY_BUFFER, GLintptr(offset), GLsizeiptr(size),
+			GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+		if (at) {
+			std::memcpy(at, data, size);
+			glUnmapBuffer(GL_ARRAY_BUFFER);
+		} else {
+			glBufferSubData(GL_ARRAY_BUFFER, GLintptr(offset), GLsizeiptr(size), data);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+	used = offset + size - base;
+	stats.bytes += size;
+	return offset;
+}
+
+void StreamBuffer::end_frame() {
+	stats.frames += 1;
+	bool spilled = (region != first_region);
+	if (region_ready) {
+		//fence every region this frame wrote to:
+		for (uint32_t r = first_region; ; r = (r + 1) % STREAM_BUFFER_REGIONS) {
+			fences[r] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			if (r == region) break;
+		}
+		region = (region + 1) % STREAM_BUFFER_REGIONS;
+	}
+	if (spilled) {
+		//(between frames, so the modes re-point their vertex arrays before drawing from the new buffer)
+		grow(frame_bytes);
+	}
+	first_region = region;
+	used = 0;
+	region_ready = false;
+	frame_bytes = 0;
+}
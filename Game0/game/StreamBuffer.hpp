@@ -0,0 +1,76 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+#define STREAM_BUFFER_REGIONS 3 //frames of uploads in flight (the GPU may be this many frames behind)
+
+/*
+ * StreamBuffer is one vertex buffer for data that is re-sent every frame, split into
+ * STREAM_BUFFER_REGIONS regions used in turn, one per frame:
+ *
+ *   - upload() copies into the current frame's region, and returns where the data landed
+ *     (draw from there, e.g. glDrawArrays(..., offset / stride, count));
+ *   - end_frame() -- called by main once the frame's draws are issued -- puts a fence after
+ *     them, and moves on to the next region.
+ *
+ * Before the first upload into a region, the fence from the last time it was used is waited on,
+ * so the CPU never overwrites vertices the GPU may still be reading. If the fence hasn't passed
+ * yet, that's a stall (counted in stats, with the time spent waiting) -- a sign the GPU is more
+ * than STREAM_BUFFER_REGIONS frames behind.
+ *
+ * Writes go through a persistent, coherent mapping of the whole buffer when the driver has
+ * GL_ARB_buffer_storage (GL 4.4; looked up at runtime, since GL.hpp is 3.3 core), and otherwise
+ * through glMapBufferRange with GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT (the
+ * fences already did the synchronizing). Either way, the driver never has to reallocate or
+ * implicitly sync the buffer the way re-specifying it with glBufferData every frame can.
+ *
+ * A frame that needs more room than a region has spills into the next region (waiting on its fence
+ * first), and end_frame() then replaces the buffer with one whose regions fit the whole frame. Only
+ * if a frame would need every region is the buffer replaced mid-frame. Either way 'generation' goes up:
+ * vertex array objects pointing at 'buffer' need to be pointed at the new one. (Compare generations,
+ * not names -- a new buffer can get the name the old one just gave up.)
+ */
+
+struct StreamBuffer {
+	explicit StreamBuffer(size_t region_size);
+	~StreamBuffer();
+	StreamBuffer(StreamBuffer const &) = delete;
+	StreamBuffer &operator=(StreamBuffer const &) = delete;
+
+	//copy 'size' bytes into this frame's region; returns their byte offset in 'buffer', a multiple of 'stride':
+	size_t upload(void const *data, size_t size, size_t stride);
+
+	//fence this frame's uploads and move on to the next region (call after the draws that use them):
+	void end_frame();
+
+	GLuint buffer = 0; //(see above: may be replaced by end_frame or upload)
+	uint32_t generation = 0; //goes up whenever 'buffer' is replaced
+	bool persistent = false; //writing through a persistent mapping
+
+	struct Stats {
+		uint64_t frames = 0;
+		uint64_t bytes = 0; //uploaded
+		uint64_t stalls = 0; //uploads that had to wait for the GPU to finish with their region
+		double stall_ms = 0.0; //time spent waiting
+		uint64_t spills = 0; //frames that overflowed their region into the next one
+		uint64_t grows = 0;
+	} stats;
+
+private:
+	void create(size_t region_size);
+	void destroy();
+	void wait_for_region();
+	void grow(size_t needed); //replace the buffer with one whose regions hold 'needed' bytes (and then some)
+
+	size_t region_size = 0; //bytes
+	uint32_t first_region = 0; //where this frame's uploads started
+	uint32_t region = 0; //current region (first_region, unless the frame spilled)
+	size_t used = 0; //bytes of the current region filled this frame
+	size_t frame_bytes = 0; //uploaded this frame, counting the most alignment padding could add
+	bool region_ready = false; //the current region has been waited for
+	GLsync fences[STREAM_BUFFER_REGIONS] = {};
+	char *mapped = nullptr; //the whole buffer, if persistent
+};
@@ -0,0 +1,285 @@
+#include "World.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+World::World(uint32_t capacity) :
+	locations(capacity),
+	generations(capacity, 0),
+	free_ids(capacity) {
+	stats.capacity = capacity;
+}
+
+bool World::alive(Entity const &entity) const {
+	return entity.index < capacity()
+		&& locations[entity.index].archetype != -1U
+		&& generations[entity.index] == entity.generation;
+}
+
+Entity World::entity_at(uint32_t index) const {
+	Entity entity;
+	if (index < capacity() && locations[index].archetype != -1U) {
+		entity.index = index;
+		entity.generation = generations[index];
+	}
+	return entity;
+}
+
+void World::destroy(Entity const &entity) {
+	if (!alive(entity)) return;
+	Location &location = locations[entity.index];
+	remove_row(location.archetype, location.row);
+	location.archetype = -1U;
+	generations[entity.index] += 1;
+	free_ids.release(entity.index);
+	stats.on_release();
+}
+
+void World::clear() {
+	for (Archetype &archetype : archetypes) {
+		for (uint32_t c = 0; c < archetype.chunks_used(); ++c) {
+			Entity const *entities = archetype.entities(c);
+			for (uint32_t r = 0; r < archetype.rows_in(c); ++r) {
+				locations[entities[r].index].archetype = -1U;
+				generations[entities[r].index] += 1;
+			}
+		}
+		archetype.size = 0;
+	}
+	free_ids.reset();
+	stats.live = 0;
+}
+
+void World::reset() {
+	clear();
+	std::fill(generations.begin(), generations.end(), 0);
+	ids_used = 0;
+}
+
+uint32_t World::query_mask(uint32_t const *ids, uint32_t count) const {
+	uint32_t mask = 0;
+	for (uint32_t i = 0; i < count; ++i) {
+		if (ids[i] == -1U) return 0;
+		mask |= (1u << ids[i]);
+	}
+	return mask;
+}
+
+uint32_t World::archetype_for(uint32_t mask) {
+	for (uint32_t a = 0; a < archetypes.size(); ++a) {
+		if (archetypes[a].mask == mask) return a;
+	}
+
+	archetypes.emplace_back();
+	Archetype &archetype = archetypes.back();
+	archetype.mask = mask;
+
+	//lay out a chunk as: entities, then each component's array (in id order), each aligned:
+	uint32_t row_bytes = sizeof(Entity);
+	uint32_t padding = 0;
+	for (uint32_t c = 0; c < component_types.size(); ++c) {
+		if (mask & (1u << c)) {
+			row_bytes += component_types[c].size;
+			padding += component_types[c].alignment;
+		}
+	}
+	archetype.rows_per_chunk = (WORLD_CHUNK_BYTES - padding) / row_bytes;
+	assert(archetype.rows_per_chunk > 0);
+	uint32_t offset = archetype.rows_per_chunk * sizeof(Entity);
+	for (uint32_t c = 0; c < WORLD_MAX_COMPONENTS; ++c) {
+		archetype.offsets[c] = -1U;
+		if (c < component_types.size() && (mask & (1u << c))) {
+			uint32_t alignment = component_types[c].alignment;
+			offset = (offset + alignment - 1) / alignment * alignment;
+			archetype.offsets[c] = offset;
+			offset += archetype.rows_per_chunk * component_types[c].size;
+		}
+	}
+	assert(offset <= WORLD_CHUNK_BYTES);
+
+	uint32_t index = uint32_t(archetypes.size() - 1);
+	archetype_order.insert(std::upper_bound(archetype_order.begin(), archetype_order.end(), index, [this](uint32_t a, uint32_t b) {
+		return archetypes[a].mask < archetypes[b].mask;
+	}), index);
+	return index;
+}
+
+Entity World::allocate(uint32_t archetype) {
+	uint32_t index = free_ids.acquire();
+	if (index == -1U) {
+		stats.failed += 1;
+		return Entity();
+	}
+	ids_used = std::max(ids_used, index + 1);
+
+	uint32_t row = append_row(archetype);
+	Entity entity;
+	entity.index = index;
+	entity.generation = generations[index];
+	archetypes[archetype].entities(row / archetypes[archetype].rows_per_chunk)[row % archetypes[archetype].rows_per_chunk] = entity;
+	locations[index].archetype = archetype;
+	locations[index].row = row;
+	stats.on_acquire();
+	return entity;
+}
+
+uint32_t World::append_row(uint32_t index) {
+	Archetype &archetype = archetypes[index];
+	uint32_t row = archetype.size;
+	if (row / archetype.rows_per_chunk == archetype.chunks.size()) {
+		archetype.chunks.emplace_back(new Chunk);
+	}
+	archetype.size += 1;
+	return row;
+}
+
+void World::remove_row(uint32_t index, uint32_t row) {
+	Archetype &archetype = archetypes[index];
+	assert(row < archetype.size);
+	uint32_t last = archetype.size - 1;
+	if (row != last) {
+		//move the last row into the hole:
+		for (uint32_t c = 0; c < component_types.size(); ++c) {
+			if (!(archetype.mask & (1u << c))) continue;
+			uint32_t size = component_types[c].size;
+			std::memcpy(archetype.at(row, c, size), archetype.at(last, c, size), size);
+		}
+		Entity moved = archetype.entities(last / archetype.rows_per_chunk)[last % archetype.rows_per_chunk];
+		archetype.entities(row / archetype.rows_per_chunk)[row % archetype.rows_per_chunk] = moved;
+		locations[moved.index].row = row;
+	}
+	archetype.size -= 1;
+}
+
+void World::move_entity(uint32_t index, uint32_t to) {
+	Location &location = locations[index];
+	uint32_t from = location.archetype;
+	uint32_t row = append_row(to);
+	//(append_row may have grown 'archetypes[to].chunks', but never 'archetypes' itself)
+	Archetype const &source = archetypes[from];
+	Archetype const &target = archetypes[to];
+	uint32_t shared = source.mask & target.mask;
+	for (uint32_t c = 0; c < component_types.size(); ++c) {
+		if (!(shared & (1u << c))) continue;
+		uint32_t size = component_types[c].size;
+		std::memcpy(target.at(row, c, size), source.at(location.row, c, size), size);
+	}
+	target.entities(row / target.rows_per_chunk)[row % target.rows_per_chunk] = entity_at(index);
+	remove_row(from, location.row);
+	location.archetype = to;
+	location.row = row;
+}
+
+uint8_t *World::component_at(uint32_t index, uint32_t component) const {
+	Location const &location = locations[index];
+	Archetype const &archetype = archetypes[location.archetype];
+	if (!(archetype.mask & (1u << component))) return nullptr;
+	return archetype.at(location.row, component, component_types[component].size);
+}
+
+//------ saved state ------
+
+void World::save(ByteWriter &out) const {
+	//component sizes, so load() can tell if the types have changed:
+	out.write(uint32_t(component_types.size()));
+	for (ComponentType const &type : component_types) {
+		out.write(type.size);
+	}
+
+	out.write(ids_used);
+	out.write_array(generations.data(), ids_used);
+
+	uint32_t used = 0;
+	for (Archetype const &archetype : archetypes) {
+		if (archetype.size) used += 1;
+	}
+	out.write(used);
+	for (uint32_t a : archetype_order) {
+		Archetype const &archetype = archetypes[a];
+		if (archetype.size == 0) continue;
+		out.write(archetype.mask);
+		out.write(archetype.size);
+		for (uint32_t c = 0; c < archetype.chunks_used(); ++c) {
+			out.write_array(archetype.entities(c), archetype.rows_in(c));
+		}
+		for (uint32_t t = 0; t < component_types.size(); ++t) {
+			if (!(archetype.mask & (1u << t))) continue;
+			for (uint32_t c = 0; c < archetype.chunks_used(); ++c) {
+				out.write_array(archetype.column(c, t), archetype.rows_in(c) * component_types[t].size);
+			}
+		}
+	}
+}
+
+void World::load(ByteReader &in, bool saved_generations) {
+	//(types registered since the world was saved are fine: they come after the saved ones, and no saved entity has them)
+	uint32_t type_count = in.read< uint32_t >();
+	if (type_count > component_types.size()) {
+		throw std::runtime_error("Saved world has " + std::to_string(type_count) + " component types; expecting at most " + std::to_string(component_types.size()) + ".");
+	}
+	for (uint32_t t = 0; t < type_count; ++t) {
+		if (in.read< uint32_t >() != component_types[t].size) throw std::runtime_error("Saved world has a component of the wrong size.");
+	}
+
+	clear();
+	try {
+		if (saved_generations) {
+			uint32_t used = in.read< uint32_t >();
+			if (used > capacity()) throw std::runtime_error("Saved world has too many entity ids.");
+			in.read_array(generations.data(), used);
+			std::fill(generations.begin() + used, generations.end(), 0);
+			ids_used = used;
+		}
+
+		uint32_t archetype_count = in.read< uint32_t >();
+		for (uint32_t i = 0; i < archetype_count; ++i) {
+			uint32_t mask = in.read< uint32_t >();
+			if (mask == 0 || (type_count < WORLD_MAX_COMPONENTS && (mask >> type_count) != 0)) {
+				throw std::runtime_error("Saved world has a bad archetype.");
+			}
+			uint32_t a = archetype_for(mask);
+			uint32_t size = in.read< uint32_t >();
+			if (size > capacity() - stats.live || archetypes[a].size != 0) throw std::runtime_error("Saved world has too many entities.");
+			for (uint32_t r = 0; r < size; ++r) {
+				append_row(a);
+			}
+
+			Archetype const &archetype = archetypes[a];
+			for (uint32_t c = 0; c < archetype.chunks_used(); ++c) {
+				Entity *entities = archetype.entities(c);
+				in.read_array(entities, archetype.rows_in(c));
+				for (uint32_t r = 0; r < archetype.rows_in(c); ++r) {
+					uint32_t index = entities[r].index;
+					if (index >= capacity() || locations[index].archetype != -1U) throw std::runtime_error("Saved world has a bad entity id.");
+					if (saved_generations) {
+						if (index >= ids_used || generations[index] != entities[r].generation) throw std::runtime_error("Saved world has a bad entity generation.");
+					} else {
+						generations[index] = entities[r].generation;
+						ids_used = std::max(ids_used, index + 1);
+					}
+					locations[index].archetype = a;
+					locations[index].row = c * archetype.rows_per_chunk + r;
+					free_ids.take(index);
+					stats.on_acquire();
+				}
+			}
+			for (uint32_t t = 0; t < type_count; ++t) {
+				if (!(mask & (1u << t))) continue;
+				for (uint32_t c = 0; c < archetype.chunks_used(); ++c) {
+					in.read_array(archetype.column(c, t), archetype.rows_in(c) * component_types[t].size);
+				}
+			}
+		}
+	} catch (...) {
+		//don't leave rows behind that were never filled in (clear() would trust their entity ids):
+		for (Archetype &archetype : archetypes) {
+			archetype.size = 0;
+		}
+		std::fill(locations.begin(), locations.end(), Location());
+		free_ids.reset();
+		stats.live = 0;
+		throw;
+	}
+}
@@ -0,0 +1,366 @@
+#pragma once
+
+#include "ByteStream.hpp"
+#include "FreeIds.hpp"
+#include "JobSystem.hpp"
+#include "PoolStats.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+ * World is a small archetype-based entity component system.
+ *
+ * An entity is an id; its data is a set of components (plain structs). Entities with
+ * the same set of component types share an archetype, which packs them into fixed-size
+ * chunks holding one array per component -- so a system that reads two components
+ * streams through two arrays and never touches the rest:
+ *
+ *   Entity e = world.create(Body{...}, Health{...});
+ *   world.each< Body, Health >([&](Entity e, Body &body, Health &health){ ... });
+ *   world.parallel_each< Body >(jobs, [&](Entity e, Body &body){ ... }); //chunks split across threads
+ *
+ * Components must be trivially copyable (they are moved between chunks and saved as raw
+ * bytes). Types are registered the first time they are used to create an entity, at most
+ * WORLD_MAX_COMPONENTS per world; register them up front with component< T >() so that
+ * saved worlds line up.
+ *
+ * Iteration order only depends on which entities are alive and how they got there
+ * (archetypes are visited in component-set order, rows in archetype order), so a
+ * restored world iterates exactly like the original.
+ *
+ * Capacity is fixed at construction, and entity ids are handed out
+ * lowest-first, so they can index side tables (e.g., a CollisionGrid). Chunks are
+ * allocated as archetypes grow and kept when they empty out, so once the game has warmed
+ * up nothing is allocated.
+ *
+ * NOTE: create/destroy/add/remove move entities around; don't make those changes while
+ * iterating, and don't hold on to component pointers across them.
+ */
+
+#define WORLD_MAX_COMPONENTS 32
+#define WORLD_CHUNK_BYTES 16384
+
+struct Entity {
+	uint32_t index = -1U; //in [0, capacity); stable for the entity's lifetime
+	uint32_t generation = 0;
+	bool valid() const { return index != -1U; }
+	bool operator==(Entity const &o) const { return index == o.index && generation == o.generation; }
+	bool operator!=(Entity const &o) const { return !(*this == o); }
+};
+
+struct World {
+	explicit World(uint32_t capacity);
+	World(World const &) = delete;
+	World &operator=(World const &) = delete;
+	//(worlds can be moved -- or swapped -- without allocating:)
+	World(World &&) = default;
+	World &operator=(World &&) = default;
+
+	//id of component type T in this world (registering it if needed):
+	template< typename T >
+	uint32_t component();
+
+	//new entity with the given components; returns an invalid entity (and counts a failure) if the world is full:
+	template< typename... Ts >
+	Entity create(Ts const &... components);
+	//destroy 'entity' (stale entities are ignored):
+	void destroy(Entity const &entity);
+	//destroy every entity:
+	void clear();
+	//destroy every entity and start every id over at generation 0, as if freshly constructed
+	// (so entities from before the reset may look alive again -- don't keep any):
+	void reset();
+
+	bool alive(Entity const &entity) const;
+	//the live entity with id 'index' (invalid if there is none):
+	Entity entity_at(uint32_t index) const;
+
+	//entity's T component; nullptr if the entity is stale or has no T:
+	template< typename T >
+	T *get(Entity const &entity);
+	template< typename T >
+	T const *get(Entity const &entity) const;
+
+	//give 'entity' a T component (or overwrite the one it has):
+	template< typename T >
+	void add(Entity const &entity, T const &value);
+	//take away entity's T component (if it has one):
+	template< typename T >
+	void remove(Entity const &entity);
+
+	//call fn(Entity, Ts &...) for every entity that has all of Ts:
+	template< typename... Ts, typename F >
+	void each(F const &fn);
+	template< typename... Ts, typename F >
+	void each(F const &fn) const;
+	//same, but with chunks split across 'jobs' (if not null):
+	// fn may only touch the components it is given, since chunks run at the same time
+	template< typename... Ts, typename F >
+	void parallel_each(JobSystem *jobs, F const &fn);
+	//same, but call fn(Entity const *, uint32_t rows, Ts *...) once per chunk, with each component's packed array
+	// (for systems that work on many entities at once, e.g. with SIMD):
+	template< typename... Ts, typename F >
+	void parallel_each_chunk(JobSystem *jobs, F const &fn);
+
+	//number of entities that have all of Ts:
+	template< typename... Ts >
+	uint32_t count() const;
+
+	uint32_t size() const { return stats.live; }
+	uint32_t capacity() const { return stats.capacity; }
+
+	//write every live entity and its components, and the generation of every id that has been used
+	// (so entities created after a load get the same generations they did the first time) /
+	// replace the contents with what save() wrote:
+	// (throws std::runtime_error on bad data; entities from before load() are meaningless after it)
+	// 'saved_generations' is false for worlds saved before generations were, whose free ids keep their current ones
+	void save(ByteWriter &out) const;
+	void load(ByteReader &in, bool saved_generations = true);
+
+	PoolStats stats;
+
+private:
+	struct ComponentType {
+		void const *key; //tells types apart (see type_key)
+		uint32_t size;
+		uint32_t alignment;
+	};
+	std::vector< ComponentType > component_types;
+
+	typedef std::aligned_storage< WORLD_CHUNK_BYTES, 16 >::type Chunk;
+
+	struct Archetype {
+		uint32_t mask = 0; //bit per component type
+		uint32_t rows_per_chunk = 0;
+		uint32_t size = 0; //entities; rows [0, size) are live, packed across chunks
+		uint32_t offsets[WORLD_MAX_COMPONENTS]; //byte offset of each component's array in a chunk (-1U if absent)
+		std::vector< std::unique_ptr< Chunk > > chunks;
+
+		uint32_t chunks_used() const { return (size + rows_per_chunk - 1) / rows_per_chunk; }
+		uint32_t rows_in(uint32_t chunk) const { return std::min(rows_per_chunk, size - chunk * rows_per_chunk); }
+		uint8_t *bytes(uint32_t chunk) const { return reinterpret_cast< uint8_t * >(chunks[chunk].get()); }
+		//(the entity array is at the start of every chunk)
+		Entity *entities(uint32_t chunk) const { return reinterpret_cast< Entity * >(bytes(chunk)); }
+		uint8_t *column(uint32_t chunk, uint32_t component) const { return bytes(chunk) + offsets[component]; }
+		uint8_t *at(uint32_t row, uint32_t component, uint32_t size) const {
+			return column(row / rows_per_chunk, component) + (row % rows_per_chunk) * size;
+		}
+	};
+	std::vector< Archetype > archetypes; //in creation order (Location::archetype indexes this)
+	std::vector< uint32_t > archetype_order; //indices into 'archetypes', sorted by mask (iteration order)
+
+	struct Location {
+		uint32_t archetype = -1U; //-1U if the entity id is free
+		uint32_t row = 0;
+	};
+	std::vector< Location > locations; //per entity id
+	std::vector< uint32_t > generations; //per entity id; bumped on destroy
+	uint32_t ids_used = 0; //ids below this have been handed out at some point (the rest are still at generation 0)
+	FreeIds free_ids;
+
+	std::vector< std::pair< uint32_t, uint32_t > > parallel_chunks; //scratch for parallel_each: (archetype, chunk)
+
+	//address unique to each type, without needing RTTI:
+	template< typename T >
+	static void const *type_key() { static char key; return &key; }
+	//id of T, or -1U if it was never registered:
+	template< typename T >
+	uint32_t find_component() const;
+	//mask for a query's components (0 if any is unregistered, which matches nothing):
+	uint32_t query_mask(uint32_t const *ids, uint32_t count) const;
+
+	uint32_t archetype_for(uint32_t mask); //finds or creates
+	Entity allocate(uint32_t archetype); //new entity in a new row at the end of 'archetype'
+	uint32_t append_row(uint32_t archetype);
+	void remove_row(uint32_t archetype, uint32_t row); //moves the last row into 'row'
+	void move_entity(uint32_t index, uint32_t to_archetype); //copies shared components; others are left uninitialized
+	uint8_t *component_at(uint32_t index, uint32_t component) const; //nullptr if missing
+
+	template< typename F, typename... Ts, size_t... Is >
+	void run_chunk(Archetype const &archetype, uint32_t chunk, uint32_t const *ids, F const &fn, std::index_sequence< Is... >) const;
+	template< typename F, typename... Ts, size_t... Is >
+	void run_chunk_arrays(Archetype const &archetype, uint32_t chunk, uint32_t const *ids, F const &fn, std::index_sequence< Is... >) const;
+	//call chunk_fn(archetype, chunk) for every chunk matching 'mask', split across 'jobs' (if not null):
+	template< typename F >
+	void parallel_chunks_of(JobSystem *jobs, uint32_t mask, F const &chunk_fn);
+};
+
+//---------------------------------------------
+
+template< typename T >
+uint32_t World::find_component() const {
+	void const *key = type_key< T >();
+	for (uint32_t c = 0; c < component_types.size(); ++c) {
+		if (component_types[c].key == key) return c;
+	}
+	return -1U;
+}
+
+template< typename T >
+uint32_t World::component() {
+	static_assert(std::is_trivially_copyable< T >::value, "components must be plain data");
+	uint32_t id = find_component< T >();
+	if (id != -1U) return id;
+	assert(component_types.size() < WORLD_MAX_COMPONENTS);
+	ComponentType type;
+	type.key = type_key< T >();
+	type.size = sizeof(T);
+	type.alignment = alignof(T);
+	component_types.emplace_back(type);
+	return uint32_t(component_types.size() - 1);
+}
+
+template< typename... Ts >
+Entity World::create(Ts const &... components) {
+	uint32_t ids[] = { component< Ts >()... };
+	uint32_t mask = 0;
+	for (uint32_t id : ids) mask |= (1u << id);
+	assert(mask != 0 && "entities need at least one component");
+
+	Entity entity = allocate(archetype_for(mask));
+	if (!entity.valid()) return entity;
+	void const *values[] = { &components... };
+	for (uint32_t i = 0; i < sizeof...(Ts); ++i) {
+		std::memcpy(component_at(entity.index, ids[i]), values[i], component_types[ids[i]].size);
+	}
+	return entity;
+}
+
+template< typename T >
+T *World::get(Entity const &entity) {
+	return const_cast< T * >(static_cast< World const & >(*this).get< T >(entity));
+}
+
+template< typename T >
+T const *World::get(Entity const &entity) const {
+	uint32_t id = find_component< T >();
+	if (id == -1U || !alive(entity)) return nullptr;
+	return reinterpret_cast< T const * >(component_at(entity.index, id));
+}
+
+template< typename T >
+void World::add(Entity const &entity, T const &value) {
+	if (!alive(entity)) return;
+	uint32_t id = component< T >();
+	Location const &location = locations[entity.index];
+	uint32_t mask = archetypes[location.archetype].mask;
+	if (!(mask & (1u << id))) {
+		move_entity(entity.index, archetype_for(mask | (1u << id)));
+	}
+	std::memcpy(component_at(entity.index, id), &value, sizeof(T));
+}
+
+template< typename T >
+void World::remove(Entity const &entity) {
+	uint32_t id = find_component< T >();
+	if (id == -1U || !alive(entity)) return;
+	uint32_t mask = archetypes[locations[entity.index].archetype].mask;
+	if (!(mask & (1u << id))) return;
+	assert(mask != (1u << id) && "entities need at least one component (destroy it instead)");
+	move_entity(entity.index, archetype_for(mask & ~(1u << id)));
+}
+
+template< typename F, typename... Ts, size_t... Is >
+void World::run_chunk(Archetype const &archetype, uint32_t chunk, uint32_t const *ids, F const &fn, std::index_sequence< Is... >) const {
+	uint32_t rows = archetype.rows_in(chunk);
+	Entity const *entities = archetype.entities(chunk);
+	uint8_t *columns[] = { archetype.column(chunk, ids[Is])... };
+	for (uint32_t r = 0; r < rows; ++r) {
+		fn(entities[r], reinterpret_cast< Ts * >(columns[Is])[r]...);
+	}
+}
+
+template< typename F, typename... Ts, size_t... Is >
+void World::run_chunk_arrays(Archetype const &archetype, uint32_t chunk, uint32_t const *ids, F const &fn, std::index_sequence< Is... >) const {
+	fn(static_cast< Entity const * >(archetype.entities(chunk)), archetype.rows_in(chunk), reinterpret_cast< Ts * >(archetype.column(chunk, ids[Is]))...);
+}
+
+template< typename F >
+void World::parallel_chunks_of(JobSystem *jobs, uint32_t mask, F const &chunk_fn) {
+	parallel_chunks.clear();
+	for (uint32_t a : archetype_order) {
+		if ((archetypes[a].mask & mask) != mask) continue;
+		for (uint32_t c = 0; c < archetypes[a].chunks_used(); ++c) {
+			parallel_chunks.emplace_back(a, c);
+		}
+	}
+	auto run = [&](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; ++i) {
+			chunk_fn(archetypes[parallel_chunks[i].first], parallel_chunks[i].second);
+		}
+	};
+	if (jobs) {
+		jobs->parallel_for(uint32_t(parallel_chunks.size()), 1, run);
+	} else {
+		run(0, uint32_t(parallel_chunks.size()));
+	}
+}
+
+template< typename... Ts, typename F >
+void World::each(F const &fn) {
+	static_assert(sizeof...(Ts) > 0, "queries need at least one component");
+	uint32_t ids[] = { find_component< Ts >()... };
+	uint32_t mask = query_mask(ids, sizeof...(Ts));
+	if (mask == 0) return;
+	for (uint32_t a : archetype_order) {
+		Archetype const &archetype = archetypes[a];
+		if ((archetype.mask & mask) != mask) continue;
+		for (uint32_t c = 0; c < archetype.chunks_used(); ++c) {
+			run_chunk< F, Ts... >(archetype, c, ids, fn, std::index_sequence_for< Ts... >());
+		}
+	}
+}
+
+template< typename... Ts, typename F >
+void World::each(F const &fn) const {
+	//(components are handed out as const references)
+	const_cast< World * >(this)->each< Ts... >([&fn](Entity const &entity, Ts const &... components) {
+		fn(entity, components...);
+	});
+}
+
+template< typename... Ts, typename F >
+void World::parallel_each(JobSystem *jobs, F const &fn) {
+	static_assert(sizeof...(Ts) > 0, "queries need at least one component");
+	if (!jobs) {
+		each< Ts... >(fn);
+		return;
+	}
+	uint32_t ids[] = { find_component< Ts >()... };
+	uint32_t mask = query_mask(ids, sizeof...(Ts));
+	if (mask == 0) return;
+	parallel_chunks_of(jobs, mask, [&](Archetype const &archetype, uint32_t chunk) {
+		run_chunk< F, Ts... >(archetype, chunk, ids, fn, std::index_sequence_for< Ts... >());
+	});
+}
+
+template< typename... Ts, typename F >
+void World::parallel_each_chunk(JobSystem *jobs, F const &fn) {
+	static_assert(sizeof...(Ts) > 0, "queries need at least one component");
+	uint32_t ids[] = { find_component< Ts >()... };
+	uint32_t mask = query_mask(ids, sizeof...(Ts));
+	if (mask == 0) return;
+	parallel_chunks_of(jobs, mask, [&](Archetype const &archetype, uint32_t chunk) {
+		run_chunk_arrays< F, Ts... >(archetype, chunk, ids, fn, std::index_sequence_for< Ts... >());
+	});
+}
+
+template< typename... Ts >
+uint32_t World::count() const {
+	static_assert(sizeof...(Ts) > 0, "queries need at least one component");
+	uint32_t ids[] = { find_component< Ts >()... };
+	uint32_t mask = query_mask(ids, sizeof...(Ts));
+	if (mask == 0) return 0;
+	uint32_t total = 0;
+	for (Archetype const &archetype : archetypes) {
+		if ((archetype.mask & mask) == mask) total += archetype.size;
+	}
+	return total;
+}
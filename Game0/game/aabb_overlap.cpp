@@ -0,0 +1,202 @@
+#include "aabb_overlap.hpp"
+
+#include "simd.hpp"
+
+//(the AVX paths are built alongside the SSE2 ones, and picked at runtime)
+#ifdef SIMD_SSE2
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define AABB_OVERLAP_TARGET_AVX
+#else
+#define AABB_OVERLAP_TARGET_AVX __attribute__((target("avx")))
+#endif
+#endif
+
+//all paths test box centers against the target box grown by 'radius':
+// (min.x - r.x <= c.x <= max.x + r.x) && (min.y - r.y <= c.y <= max.y + r.y)
+// ...and the sweep paths clip the center's path against that grown box (see aabb_sweep).
+
+uint32_t aabb_overlap_batch_scalar(glm::vec2 const *centers, uint32_t count, glm::vec2 const &radius, glm::vec4 const &box, uint32_t *hits) {
+	uint32_t hit_count = 0;
+	for (uint32_t i = 0; i < count; ++i) {
+		//branch-free append: always write, only advance on a hit
+		hits[hit_count] = i;
+		hit_count += uint32_t(aabb_overlap(centers[i], radius, box));
+	}
+	return hit_count;
+}
+
+uint32_t aabb_sweep_batch_scalar(glm::vec2 const *starts, glm::vec2 const *ends, uint32_t count, glm::vec2 const &start_offset, glm::vec2 const &radius, glm::vec4 const &box, uint32_t *hits) {
+	uint32_t hit_count = 0;
+	float time;
+	for (uint32_t i = 0; i < count; ++i) {
+		hits[hit_count] = i;
+		hit_count += uint32_t(aabb_sweep(starts[i] + start_offset, ends[i], radius, box, &time));
+	}
+	return hit_count;
+}
+
+#ifdef SIMD_SSE2
+
+//'pairs' has two bits per box (x test, y test), box 'i' at bits 2i and 2i+1:
+static inline uint32_t append_hits(uint32_t pairs, uint32_t base, uint32_t *hits, uint32_t hit_count) {
+	uint32_t both = pairs & (pairs >> 1) & 0x55555555u;
+	while (both) {
+#if defined(_MSC_VER)
+		unsigned long bit;
+		_BitScanForward(&bit, both);
+#else
+		uint32_t bit = uint32_t(__builtin_ctz(both));
+#endif
+		hits[hit_count++] = base + bit / 2;
+		both &= both - 1;
+	}
+	return hit_count;
+}
+
+//boxes [start, count) that didn't fill a whole SIMD step:
+static uint32_t scalar_tail(glm::vec2 const *centers, uint32_t count, uint32_t start, glm::vec2 const &radius, glm::vec4 const &box, uint32_t *hits) {
+	uint32_t tail = aabb_overlap_batch_scalar(centers + start, count - start, radius, box, hits);
+	for (uint32_t t = 0; t < tail; ++t) hits[t] += start;
+	return tail;
+}
+
+//SSE2: each register holds two interleaved (x,y) centers; 8 boxes per step.
+static uint32_t aabb_overlap_batch_sse2(glm::vec2 const *centers, uint32_t count, glm::vec2 const &radius, glm::vec4 const &box, uint32_t *hits) {
+	float const *c = &centers[0].x;
+	__m128 lo = _mm_setr_ps(box[0] - radius.x, box[2] - radius.y, box[0] - radius.x, box[2] - radius.y);
+	__m128 hi = _mm_setr_ps(box[1] + radius.x, box[3] + radius.y, box[1] + radius.x, box[3] + radius.y);
+
+	uint32_t hit_count = 0;
+	uint32_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		uint32_t pairs = 0;
+		for (uint32_t r = 0; r < 4; ++r) {
+			__m128 p = _mm_loadu_ps(c + 2 * i + 4 * r);
+			__m128 in = _mm_and_ps(_mm_cmpge_ps(p, lo), _mm_cmple_ps(p, hi));
+			pairs |= uint32_t(_mm_movemask_ps(in)) << (4 * r);
+		}
+		if (pairs) hit_count = append_hits(pairs, i, hits, hit_count);
+	}
+	return hit_count + scalar_tail(centers, count, i, radius, box, hits + hit_count);
+}
+
+//AVX: each register holds four interleaved (x,y) centers; 16 boxes per step.
+AABB_OVERLAP_TARGET_AVX
+static uint32_t aabb_overlap_batch_avx(glm::vec2 const *centers, uint32_t count, glm::vec2 const &radius, glm::vec4 const &box, uint32_t *hits) {
+	float const *c = &centers[0].x;
+	float lx = box[0] - radius.x, ly = box[2] - radius.y;
+	float hx = box[1] + radius.x, hy = box[3] + radius.y;
+	__m256 lo = _mm256_setr_ps(lx, ly, lx, ly, lx, ly, lx, ly);
+	__m256 hi = _mm256_setr_ps(hx, hy, hx, hy, hx, hy, hx, hy);
+
+	uint32_t hit_count = 0;
+	uint32_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		uint32_t pairs = 0;
+		for (uint32_t r = 0; r < 4; ++r) {
+			__m256 p = _mm256_loadu_ps(c + 2 * i + 8 * r);
+			__m256 in = _mm256_and_ps(_mm256_cmp_ps(p, lo, _CMP_GE_OQ), _mm256_cmp_ps(p, hi, _CMP_LE_OQ));
+			pairs |= uint32_t(_mm256_movemask_ps(in)) << (8 * r);
+		}
+		if (pairs) hit_count = append_hits(pairs, i, hits, hit_count);
+	}
+	_mm256_zeroupper();
+
+	return hit_count + scalar_tail(centers, count, i, radius, box, hits + hit_count);
+}
+
+//SSE2 sweep: four paths per step, de-interleaved into x and y registers.
+// Lanes that don't move along an axis get the same answer as the scalar path's 'd == 0' case.
+static uint32_t aabb_sweep_batch_sse2(glm::vec2 const *starts, glm::vec2 const *ends, uint32_t count, glm::vec2 const &start_offset, glm::vec2 const &radius, glm::vec4 const &box, uint32_t *hits) {
+	float const *s = &starts[0].x;
+	float const *e = &ends[0].x;
+	const __m128 lo_x = _mm_set1_ps(box[0] - radius.x), hi_x = _mm_set1_ps(box[1] + radius.x);
+	const __m128 lo_y = _mm_set1_ps(box[2] - radius.y), hi_y = _mm_set1_ps(box[3] + radius.y);
+	const __m128 offset_x = _mm_set1_ps(start_offset.x), offset_y = _mm_set1_ps(start_offset.y);
+	const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+	const __m128 never = _mm_set1_ps(2.0f); //an entry time past the end of the move
+
+	//entry/exit times along one axis:
+	auto slab = [&](__m128 start, __m128 end, __m128 lo, __m128 hi, __m128 &enter, __m128 &leave) {
+		__m128 d = _mm_sub_ps(end, start);
+		__m128 t0 = _mm_div_ps(_mm_sub_ps(lo, start), d);
+		__m128 t1 = _mm_div_ps(_mm_sub_ps(hi, start), d);
+		__m128 still = _mm_cmpeq_ps(d, zero);
+		__m128 inside = _mm_and_ps(_mm_cmpge_ps(start, lo), _mm_cmple_ps(start, hi));
+		//still lanes: (0, 1) if inside the slab, otherwise (never, 0):
+		__m128 still_enter = _mm_andnot_ps(inside, never);
+		__m128 still_leave = _mm_and_ps(inside, one);
+		__m128 moving_enter = _mm_min_ps(t0, t1), moving_leave = _mm_max_ps(t0, t1);
+		enter = _mm_or_ps(_mm_and_ps(still, still_enter), _mm_andnot_ps(still, moving_enter));
+		leave = _mm_or_ps(_mm_and_ps(still, still_leave), _mm_andnot_ps(still, moving_leave));
+	};
+
+	uint32_t hit_count = 0;
+	uint32_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128 s01 = _mm_loadu_ps(s + 2 * i), s23 = _mm_loadu_ps(s + 2 * i + 4);
+		__m128 e01 = _mm_loadu_ps(e + 2 * i), e23 = _mm_loadu_ps(e + 2 * i + 4);
+		__m128 sx = _mm_add_ps(_mm_shuffle_ps(s01, s23, _MM_SHUFFLE(2, 0, 2, 0)), offset_x);
+		__m128 sy = _mm_add_ps(_mm_shuffle_ps(s01, s23, _MM_SHUFFLE(3, 1, 3, 1)), offset_y);
+		__m128 ex = _mm_shuffle_ps(e01, e23, _MM_SHUFFLE(2, 0, 2, 0));
+		__m128 ey = _mm_shuffle_ps(e01, e23, _MM_SHUFFLE(3, 1, 3, 1));
+
+		__m128 enter_x, leave_x, enter_y, leave_y;
+		slab(sx, ex, lo_x, hi_x, enter_x, leave_x);
+		slab(sy, ey, lo_y, hi_y, enter_y, leave_y);
+		__m128 enter = _mm_max_ps(zero, _mm_max_ps(enter_x, enter_y));
+		__m128 leave = _mm_min_ps(one, _mm_min_ps(leave_x, leave_y));
+		//(and, as in aabb_sweep, not if it started overlapping but got clear)
+		__m128 entered = _mm_or_ps(_mm_cmpgt_ps(enter, zero), _mm_cmpge_ps(leave, one));
+		uint32_t mask = uint32_t(_mm_movemask_ps(_mm_and_ps(_mm_cmple_ps(enter, leave), entered)));
+		while (mask) {
+#if defined(_MSC_VER)
+			unsigned long bit;
+			_BitScanForward(&bit, mask);
+#else
+			uint32_t bit = uint32_t(__builtin_ctz(mask));
+#endif
+			hits[hit_count++] = i + bit;
+			mask &= mask - 1;
+		}
+	}
+
+	uint32_t tail = aabb_sweep_batch_scalar(starts + i, ends + i, count - i, start_offset, radius, box, hits + hit_count);
+	for (uint32_t t = 0; t < tail; ++t) hits[hit_count + t] += i;
+	return hit_count + tail;
+}
+
+static bool cpu_has_avx() {
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	//also make sure the OS saves the ymm registers:
+	return osxsave && avx && (_xgetbv(0) & 0x6) == 0x6;
+#else
+	return __builtin_cpu_supports("avx");
+#endif
+}
+
+#endif //SIMD_SSE2
+
+uint32_t aabb_overlap_batch(glm::vec2 const *centers, uint32_t count, glm::vec2 const &radius, glm::vec4 const &box, uint32_t *hits) {
+	typedef uint32_t (*Kernel)(glm::vec2 const *, uint32_t, glm::vec2 const &, glm::vec4 const &, uint32_t *);
+#ifdef SIMD_SSE2
+	static Kernel kernel = (cpu_has_avx() ? aabb_overlap_batch_avx : aabb_overlap_batch_sse2);
+#else
+	static Kernel kernel = aabb_overlap_batch_scalar;
+#endif
+	return kernel(centers, count, radius, box, hits);
+}
+
+uint32_t aabb_sweep_batch(glm::vec2 const *starts, glm::vec2 const *ends, uint32_t count, glm::vec2 const &start_offset, glm::vec2 const &radius, glm::vec4 const &box, uint32_t *hits) {
+#ifdef SIMD_SSE2
+	return aabb_sweep_batch_sse2(starts, ends, count, start_offset, radius, box, hits);
+#else
+	return aabb_sweep_batch_scalar(starts, ends, count, start_offset, radius, box, hits);
+#endif
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstdint>
+
+/*
+ * Axis-aligned box overlap tests.
+ *
+ * Target boxes use the same layout as RaidenMode's collision boxes:
+ *   glm::vec4(min.x, max.x, min.y, max.y)
+ * Tested boxes are given as a center plus a half-size ("radius").
+ *
+ * The sweep tests move the tested box in a straight line from 'start' to 'end' and
+ * report whether it runs into the target along the way, so fast boxes can't tunnel
+ * through thin targets between ticks. A box that overlaps at 'end' always counts, so
+ * sweeping finds everything the plain test does; a box that starts out overlapping and
+ * gets clear by 'end' does not (it was already tested there -- or spawned there).
+ */
+
+inline bool aabb_overlap(glm::vec2 const &center, glm::vec2 const &radius, glm::vec4 const &box) {
+	return center.x + radius.x >= box[0] && center.x - radius.x <= box[1]
+	    && center.y + radius.y >= box[2] && center.y - radius.y <= box[3];
+}
+
+//does a box of half-size 'radius' moving from 'start' to 'end' run into 'box'?
+// if so, '*time' is set to when it first touches, as a fraction of the move (0 if it starts overlapping).
+inline bool aabb_sweep(glm::vec2 const &start, glm::vec2 const &end, glm::vec2 const &radius, glm::vec4 const &box, float *time) {
+	//slab test against the box grown by 'radius':
+	float enter = 0.0f, leave = 1.0f;
+	for (int axis = 0; axis < 2; ++axis) {
+		float lo = box[2 * axis] - radius[axis];
+		float hi = box[2 * axis + 1] + radius[axis];
+		float s = start[axis];
+		float d = end[axis] - s;
+		if (d == 0.0f) {
+			if (s < lo || s > hi) return false;
+		} else {
+			float t0 = (lo - s) / d;
+			float t1 = (hi - s) / d;
+			enter = std::max(enter, std::min(t0, t1));
+			leave = std::min(leave, std::max(t0, t1));
+			if (enter > leave) return false;
+		}
+	}
+	//started overlapping but got clear:
+	if (enter == 0.0f && leave < 1.0f) return false;
+	*time = enter;
+	return true;
+}
+
+//test 'count' boxes -- all of half-size 'radius', centered at 'centers' -- against 'box':
+// writes the indices of the overlapping boxes (in increasing order) to 'hits', which must
+// have room for 'count' entries, and returns how many were written.
+// Never allocates. Uses AVX (16 boxes per step) or SSE2 (8 per step) when the CPU has them.
+uint32_t aabb_overlap_batch(glm::vec2 const *centers, uint32_t count, glm::vec2 const &radius, glm::vec4 const &box, uint32_t *hits);
+
+//same results as aabb_overlap_batch, one box at a time (the fallback path):
+uint32_t aabb_overlap_batch_scalar(glm::vec2 const *centers, uint32_t count, glm::vec2 const &radius, glm::vec4 const &box, uint32_t *hits);
+
+//test 'count' moving boxes -- all of half-size 'radius', from 'starts[i] + start_offset' to 'ends[i]' -- against 'box':
+// (the offset lets the target move too: pass its own motion this tick and test against where it ended up)
+// same output as aabb_overlap_batch. Uses SSE2 (4 boxes per step) when the CPU has it.
+uint32_t aabb_sweep_batch(glm::vec2 const *starts, glm::vec2 const *ends, uint32_t count, glm::vec2 const &start_offset, glm::vec2 const &radius, glm::vec4 const &box, uint32_t *hits);
+
+//same results as aabb_sweep_batch, one box at a time (the fallback path):
+uint32_t aabb_sweep_batch_scalar(glm::vec2 const *starts, glm::vec2 const *ends, uint32_t count, glm::vec2 const &start_offset, glm::vec2 const &radius, glm::vec4 const &box, uint32_t *hits);
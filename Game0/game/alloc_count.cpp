@@ -0,0 +1,25 @@
+#include "alloc_count.hpp"
+
+#include <cstdlib>
+#include <new>
+
+std::atomic< uint64_t > allocation_count(0);
+
+//(newer g++ can't see that these operators pair up, and warns about malloc/free vs new/delete)
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void *operator new(std::size_t size) {
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+	if (void *ptr = std::malloc(size ? size : 1)) return ptr;
+	throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept {
+	std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+	std::free(ptr);
+}
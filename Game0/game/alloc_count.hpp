@@ -0,0 +1,14 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/*
+ * Heap allocation counting: alloc_count.cpp replaces the global operator new / delete
+ * with versions that count every allocation in the process, so programs that link it
+ * can report allocations per frame or per tick (take the count before and after).
+ *
+ * Only link it into programs that want the count -- the replacement is process-wide.
+ */
+
+extern std::atomic< uint64_t > allocation_count;
@@ -0,0 +1,235 @@
+//collision_bench measures the per-frame cost of bullet-vs-enemy collision
+// using CollisionGrid, and compares it against the brute-force all-pairs loop.
+//
+//The court is scaled with the entity count so density stays constant (which is
+// what raising ENEMY_MAX_NUM + fire rate looks like in a bigger arena). If the
+// broadphase is doing its job, cost per bullet stays roughly flat as counts grow.
+//
+//Bullets fly at the game's speed, and each frame is tested two ways: at the bullets'
+// end positions only ("grid", what the game used to do) and along their whole move
+// ("sweep", see aabb_sweep), which catches the hits that skip through an enemy between
+// frames. The second table does the same for the batched all-bullets-vs-player test.
+// Lower rates mean longer moves per frame, so more tunneling for the plain test to miss.
+//
+//usage: collision_bench [frames] [frames per second]
+
+#include "CollisionGrid.hpp"
+#include "aabb_overlap.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+
+//same sizes as the game:
+const glm::vec2 EnemyRadius = glm::vec2(0.15f, 0.3f);
+const glm::vec2 BulletRadius = glm::vec2(0.05f, 0.1f);
+//enemies per unit of court area (the game's default court is 14x10 with ~15 enemies):
+const float EnemyDensity = 0.5f;
+const uint32_t BulletsPerEnemy = 10;
+const float BulletSpeed = 7.0f;
+const glm::vec2 PlayerRadius = glm::vec2(0.2f, 0.4f);
+
+glm::vec4 box_of(glm::vec2 const &p, glm::vec2 const &r) {
+	return glm::vec4(p.x - r.x, p.x + r.x, p.y - r.y, p.y + r.y);
+}
+
+bool overlap(glm::vec4 const &a, glm::vec4 const &b) {
+	return a[0] <= b[1] && b[0] <= a[1] && a[2] <= b[3] && b[2] <= a[3];
+}
+
+struct Scene {
+	glm::vec2 court;
+	std::vector< glm::vec2 > enemies;
+	std::vector< glm::vec2 > enemy_velocities;
+	std::vector< glm::vec2 > bullets;
+	std::vector< glm::vec2 > previous_bullets; //as of the start of the frame
+	std::vector< glm::vec2 > bullet_velocities;
+
+	Scene(uint32_t enemy_count, uint32_t bullet_count, std::mt19937 &mt) {
+		float half = 0.5f * std::sqrt(enemy_count / EnemyDensity);
+		court = glm::vec2(half * 1.4f, half / 1.4f);
+		std::uniform_real_distribution< float > x(-court.x, court.x), y(-court.y, court.y), v(-1.0f, 1.0f);
+		for (uint32_t i = 0; i < enemy_count; ++i) {
+			enemies.emplace_back(x(mt), y(mt));
+			enemy_velocities.emplace_back(v(mt), v(mt));
+		}
+		std::uniform_real_distribution< float > angle(0.0f, 6.2831853f);
+		for (uint32_t i = 0; i < bullet_count; ++i) {
+			bullets.emplace_back(x(mt), y(mt));
+			float a = angle(mt);
+			bullet_velocities.emplace_back(BulletSpeed * std::cos(a), BulletSpeed * std::sin(a));
+		}
+		previous_bullets = bullets;
+	}
+
+	//move enemies a little each frame so the grid has some incremental work to do;
+	// bullets fly straight and wrap around the court:
+	void step(float elapsed) {
+		for (uint32_t i = 0; i < enemies.size(); ++i) {
+			enemies[i] += enemy_velocities[i] * elapsed;
+			if (std::abs(enemies[i].x) > court.x) enemy_velocities[i].x = -enemy_velocities[i].x;
+			if (std::abs(enemies[i].y) > court.y) enemy_velocities[i].y = -enemy_velocities[i].y;
+		}
+		for (uint32_t i = 0; i < bullets.size(); ++i) {
+			glm::vec2 &b = bullets[i];
+			b += bullet_velocities[i] * elapsed;
+			if (b.x > court.x) b.x -= 2.0f * court.x;
+			if (b.x < -court.x) b.x += 2.0f * court.x;
+			if (b.y > court.y) b.y -= 2.0f * court.y;
+			if (b.y < -court.y) b.y += 2.0f * court.y;
+			previous_bullets[i] = b - bullet_velocities[i] * elapsed; //(as if it hadn't wrapped)
+		}
+	}
+};
+
+typedef std::chrono::high_resolution_clock Clock;
+
+double ms_since(Clock::time_point const &start) {
+	return std::chrono::duration< double, std::milli >(Clock::now() - start).count();
+}
+
+}
+
+int main(int argc, char **argv) {
+	uint32_t frames = 20;
+	float rate = 60.0f;
+	if (argc > 1) frames = std::max(1, std::atoi(argv[1]));
+	if (argc > 2) rate = std::max(1.0f, float(std::atof(argv[2])));
+
+	std::mt19937 mt(0x15466);
+	const float Elapsed = 1.0f / rate;
+	std::printf("bullets move %.3f per frame (enemies are %.2f tall)\n\n", BulletSpeed * Elapsed, 2.0f * EnemyRadius.y);
+
+	std::printf("%8s %8s %12s %12s %12s %12s %12s %12s %8s\n", "enemies", "bullets", "grid ms", "ns/bullet", "sweep ms", "brute ms", "hits", "sweep hits", "check");
+
+	for (uint32_t enemies : { 100u, 200u, 500u, 1000u, 2000u, 5000u, 10000u }) {
+		uint32_t bullets = enemies * BulletsPerEnemy;
+
+		Scene scene(enemies, bullets, mt);
+		CollisionGrid grid(-scene.court, scene.court, 1.0f, EnemyRadius, enemies);
+
+		//prime the grid so the timed frames are steady-state:
+		for (uint32_t i = 0; i < enemies; ++i) grid.update(i, scene.enemies[i]);
+
+		uint32_t hits = 0, sweep_hits = 0;
+		double grid_ms = 0.0, sweep_ms = 0.0;
+		for (uint32_t f = 0; f < frames; ++f) {
+			scene.step(Elapsed);
+
+			//end positions only:
+			auto start = Clock::now();
+			for (uint32_t i = 0; i < enemies; ++i) grid.update(i, scene.enemies[i]);
+			for (auto const &b : scene.bullets) {
+				glm::vec4 bb = box_of(b, BulletRadius);
+				grid.query(bb, [&](uint32_t id) {
+					if (overlap(bb, box_of(scene.enemies[id], EnemyRadius))) {
+						hits += 1;
+						return false;
+					}
+					return true;
+				});
+			}
+			grid_ms += ms_since(start);
+
+			//whole moves (the grid is already current; the query box covers the path):
+			start = Clock::now();
+			for (uint32_t i = 0; i < bullets; ++i) {
+				glm::vec2 const &from = scene.previous_bullets[i];
+				glm::vec2 const &to = scene.bullets[i];
+				glm::vec2 lo = glm::min(from, to) - BulletRadius, hi = glm::max(from, to) + BulletRadius;
+				grid.query(glm::vec4(lo.x, hi.x, lo.y, hi.y), [&](uint32_t id) {
+					float time;
+					if (aabb_sweep(from, to, BulletRadius, box_of(scene.enemies[id], EnemyRadius), &time)) {
+						sweep_hits += 1;
+						return false;
+					}
+					return true;
+				});
+			}
+			sweep_ms += ms_since(start);
+		}
+		grid_ms /= frames;
+		sweep_ms /= frames;
+
+		//count hits once more at the final positions, for checking against brute force:
+		uint32_t final_hits = 0;
+		for (auto const &b : scene.bullets) {
+			glm::vec4 bb = box_of(b, BulletRadius);
+			grid.query(bb, [&](uint32_t id) {
+				if (overlap(bb, box_of(scene.enemies[id], EnemyRadius))) {
+					final_hits += 1;
+					return false;
+				}
+				return true;
+			});
+		}
+
+		//brute force gets slow fast; only run it while it's still reasonable:
+		double brute_ms = -1.0;
+		char const *check = "-";
+		if (uint64_t(enemies) * bullets <= 50000000ull) {
+			uint32_t brute_hits = 0;
+			auto start = Clock::now();
+			for (uint32_t f = 0; f < frames; ++f) {
+				for (auto const &b : scene.bullets) {
+					glm::vec4 bb = box_of(b, BulletRadius);
+					for (auto const &e : scene.enemies) {
+						if (overlap(bb, box_of(e, EnemyRadius))) {
+							brute_hits += 1;
+							break;
+						}
+					}
+				}
+			}
+			brute_ms = ms_since(start) / frames;
+			check = (brute_hits == final_hits * frames ? "ok" : "MISMATCH");
+		}
+
+		std::printf("%8u %8u %12.3f %12.1f %12.3f ", enemies, bullets, grid_ms, grid_ms * 1.0e6 / bullets, sweep_ms);
+		if (brute_ms >= 0.0) std::printf("%12.3f", brute_ms);
+		else std::printf("%12s", "-");
+		std::printf(" %12u %12u %8s\n", hits / frames, sweep_hits / frames, check);
+	}
+
+	//every bullet against one (moving) player box, as RaidenGame does each tick:
+	std::printf("\n%8s %12s %12s %12s %12s %12s %8s\n", "bullets", "batch us", "sweep us", "scalar us", "hits", "sweep hits", "check");
+	for (uint32_t bullets : { 1000u, 10000u, 100000u }) {
+		Scene scene(bullets / BulletsPerEnemy, bullets, mt);
+		glm::vec4 player = box_of(glm::vec2(0.0f), PlayerRadius);
+		glm::vec2 player_move = glm::vec2(5.0f * Elapsed, 0.0f);
+		std::vector< uint32_t > hit_list(bullets), scalar_list(bullets);
+
+		uint32_t hits = 0, sweep_hits = 0;
+		double batch_us = 0.0, sweep_us = 0.0, scalar_us = 0.0;
+		bool same = true;
+		for (uint32_t f = 0; f < frames; ++f) {
+			scene.step(Elapsed);
+
+			auto start = Clock::now();
+			hits += aabb_overlap_batch(scene.bullets.data(), bullets, BulletRadius, player, hit_list.data());
+			batch_us += 1000.0 * ms_since(start);
+
+			start = Clock::now();
+			uint32_t count = aabb_sweep_batch(scene.previous_bullets.data(), scene.bullets.data(), bullets, player_move, BulletRadius, player, hit_list.data());
+			sweep_us += 1000.0 * ms_since(start);
+			sweep_hits += count;
+
+			start = Clock::now();
+			uint32_t scalar_count = aabb_sweep_batch_scalar(scene.previous_bullets.data(), scene.bullets.data(), bullets, player_move, BulletRadius, player, scalar_list.data());
+			scalar_us += 1000.0 * ms_since(start);
+			same = same && scalar_count == count && std::equal(hit_list.begin(), hit_list.begin() + count, scalar_list.begin());
+		}
+
+		std::printf("%8u %12.2f %12.2f %12.2f %12u %12u %8s\n", bullets, batch_us / frames, sweep_us / frames, scalar_us / frames,
+			hits / frames, sweep_hits / frames, (same ? "ok" : "MISMATCH"));
+	}
+
+	return 0;
+}
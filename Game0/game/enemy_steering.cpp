@@ -0,0 +1,147 @@
+#include "enemy_steering.hpp"
+
+#include "simd.hpp"
+
+#include <cmath>
+
+//(the same expressions as the SIMD path below, in the same order)
+static glm::vec4 enemy_collision_box(glm::vec2 const &position) {
+	return glm::vec4(position.x - ENEMY_RADIUS.x,
+		position.x + ENEMY_RADIUS.x,
+		position.y - ENEMY_RADIUS.y,
+		position.y + ENEMY_RADIUS.y + 0.05f * 0.75f);
+}
+
+//drop whole loops (keeps the distance small enough for float precision):
+static float unloop(float distance, float lead_in, float loop) {
+	return (loop > 0.0f ? lead_in + std::fmod(distance - lead_in, loop) : lead_in);
+}
+
+void steer_enemies_scalar(RaidenGame::Body *bodies, RaidenGame::RouteFollower *followers, uint32_t count, RouteTable const &routes, float step) {
+	for (uint32_t i = 0; i < count; ++i) {
+		RaidenGame::Body &body = bodies[i];
+		RaidenGame::RouteFollower &follower = followers[i];
+		body.previous_position = body.position;
+
+		//position is a function of distance flown, so it doesn't depend on how big the steps are:
+		follower.distance += step;
+		glm::vec2 start = routes.points(follower.route)[0];
+		float lead_in = glm::length(start - follower.spawn_position);
+		float loop = routes.loop_length(follower.route);
+		if (follower.distance >= lead_in + loop) {
+			follower.distance = unloop(follower.distance, lead_in, loop);
+		}
+		if (follower.distance < lead_in) {
+			body.position = glm::mix(follower.spawn_position, start, follower.distance / lead_in);
+		} else {
+			body.position = routes.at(follower.route, follower.distance - lead_in, follower.segment);
+		}
+		body.collision_box = enemy_collision_box(body.position);
+	}
+}
+
+#ifdef SIMD_SSE2
+
+//(x, y) pairs from four addresses, as x and y registers:
+static inline void gather_xy(glm::vec2 const *const *at, __m128 &x, __m128 &y) {
+	__m128 lo = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast< __m64 const * >(at[0])), reinterpret_cast< __m64 const * >(at[1]));
+	__m128 hi = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast< __m64 const * >(at[2])), reinterpret_cast< __m64 const * >(at[3]));
+	x = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+	y = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+}
+
+//SSE2: four enemies per step. Components are stored whole (AoS) in World chunks, so each step
+// gathers the fields it needs into registers (a pair of floats per load), and scatters the results back.
+//
+//Every lane ends up as the same interpolation, glm::mix(from, to, (x - begin) / (end - begin)) clamped
+// to [0, 1]: lead-in lanes use (spawn, start, distance, 0, lead_in) -- subtracting 0 and dividing by
+// lead_in, exactly as the scalar path does -- and the rest use their route segment (RouteTable::seek).
+static void steer_enemies_sse2(RaidenGame::Body *body, RaidenGame::RouteFollower *follower, uint32_t count, RouteTable const &routes, float step) {
+	const __m128 steps = _mm_set1_ps(step), one = _mm_set1_ps(1.0f);
+	const __m128 radius = _mm_setr_ps(-ENEMY_RADIUS.x, ENEMY_RADIUS.x, -ENEMY_RADIUS.y, ENEMY_RADIUS.y);
+	const __m128 overhang = _mm_setr_ps(0.0f, 0.0f, 0.0f, 0.05f * 0.75f);
+
+	uint32_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		RaidenGame::RouteFollower *f = follower + i;
+		RaidenGame::Body *b = body + i;
+
+		//lead-in: spawn position to the route's first point:
+		glm::vec2 const *from[4] = { &f[0].spawn_position, &f[1].spawn_position, &f[2].spawn_position, &f[3].spawn_position };
+		glm::vec2 const *to[4] = { routes.points(f[0].route), routes.points(f[1].route), routes.points(f[2].route), routes.points(f[3].route) };
+		__m128 sx, sy, tx, ty;
+		gather_xy(from, sx, sy);
+		gather_xy(to, tx, ty);
+		__m128 dx = _mm_sub_ps(tx, sx), dy = _mm_sub_ps(ty, sy);
+		__m128 lead_in = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+		__m128 loop = _mm_setr_ps(routes.loop_length(f[0].route), routes.loop_length(f[1].route), routes.loop_length(f[2].route), routes.loop_length(f[3].route));
+		__m128 d = _mm_add_ps(_mm_setr_ps(f[0].distance, f[1].distance, f[2].distance, f[3].distance), steps);
+		uint32_t wrapped = uint32_t(_mm_movemask_ps(_mm_cmpge_ps(d, _mm_add_ps(lead_in, loop))));
+
+		alignas(16) float distance[4], lead_ins[4], route_distance[4], begin[4] = {}, end[4], x[4];
+		_mm_store_ps(distance, d);
+		_mm_store_ps(lead_ins, lead_in);
+		_mm_store_ps(route_distance, _mm_sub_ps(d, lead_in));
+		_mm_store_ps(end, lead_in);
+		_mm_store_ps(x, d);
+
+		for (uint32_t k = 0; k < 4; ++k) {
+			//wrapping around a loop is rare (once per loop per enemy), so it is done one lane at a time:
+			if (wrapped & (1u << k)) {
+				float loops[4];
+				_mm_storeu_ps(loops, loop);
+				distance[k] = x[k] = unloop(distance[k], lead_ins[k], loops[k]);
+				route_distance[k] = distance[k] - lead_ins[k];
+			}
+			f[k].distance = distance[k];
+			if (distance[k] < lead_ins[k]) continue;
+
+			//past the lead-in, switch to the route segment:
+			uint32_t route = f[k].route;
+			uint32_t s = routes.seek(route, route_distance[k], f[k].segment);
+			uint32_t next = (s + 1 < routes.length(route) ? s + 1 : 0);
+			from[k] = routes.points(route) + s;
+			to[k] = routes.points(route) + next;
+			begin[k] = routes.distances(route)[s];
+			end[k] = (next != 0 ? routes.distances(route)[next] : routes.loop_length(route));
+			x[k] = route_distance[k];
+		}
+		gather_xy(from, sx, sy);
+		gather_xy(to, tx, ty);
+
+		__m128 lo = _mm_load_ps(begin), hi = _mm_load_ps(end);
+		__m128 t = _mm_min_ps(one, _mm_div_ps(_mm_sub_ps(_mm_load_ps(x), lo), _mm_sub_ps(hi, lo)));
+		t = _mm_and_ps(t, _mm_cmpgt_ps(hi, lo));
+		__m128 u = _mm_sub_ps(one, t);
+		__m128 px = _mm_add_ps(_mm_mul_ps(sx, u), _mm_mul_ps(tx, t));
+		__m128 py = _mm_add_ps(_mm_mul_ps(sy, u), _mm_mul_ps(ty, t));
+
+		//scatter positions, and collision boxes as (x, x, y, y) + radius (+ overhang):
+		for (uint32_t k = 0; k < 4; ++k) {
+			b[k].previous_position = b[k].position;
+		}
+		__m128 xy01 = _mm_unpacklo_ps(px, py), xy23 = _mm_unpackhi_ps(px, py);
+		_mm_storel_pi(reinterpret_cast< __m64 * >(&b[0].position), xy01);
+		_mm_storeh_pi(reinterpret_cast< __m64 * >(&b[1].position), xy01);
+		_mm_storel_pi(reinterpret_cast< __m64 * >(&b[2].position), xy23);
+		_mm_storeh_pi(reinterpret_cast< __m64 * >(&b[3].position), xy23);
+		__m128 x01 = _mm_unpacklo_ps(px, px), x23 = _mm_unpackhi_ps(px, px);
+		__m128 y01 = _mm_unpacklo_ps(py, py), y23 = _mm_unpackhi_ps(py, py);
+		_mm_storeu_ps(&b[0].collision_box.x, _mm_add_ps(_mm_add_ps(_mm_movelh_ps(x01, y01), radius), overhang));
+		_mm_storeu_ps(&b[1].collision_box.x, _mm_add_ps(_mm_add_ps(_mm_movehl_ps(y01, x01), radius), overhang));
+		_mm_storeu_ps(&b[2].collision_box.x, _mm_add_ps(_mm_add_ps(_mm_movelh_ps(x23, y23), radius), overhang));
+		_mm_storeu_ps(&b[3].collision_box.x, _mm_add_ps(_mm_add_ps(_mm_movehl_ps(y23, x23), radius), overhang));
+	}
+
+	steer_enemies_scalar(body + i, follower + i, count - i, routes, step);
+}
+
+#endif //SIMD_SSE2
+
+void steer_enemies(RaidenGame::Body *bodies, RaidenGame::RouteFollower *followers, uint32_t count, RouteTable const &routes, float step) {
+#ifdef SIMD_SSE2
+	steer_enemies_sse2(bodies, followers, count, routes, step);
+#else
+	steer_enemies_scalar(bodies, followers, count, routes, step);
+#endif
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "RaidenGame.hpp"
+
+#include <cstdint>
+
+/*
+ * Enemy steering, a packed array of followers at a time (see RaidenGame::update_enemies).
+ *
+ * Each follower flies 'step' further along its path -- a straight lead-in from where it spawned
+ * to its route's first point, then the route's loop -- and its Body is moved there, with the old
+ * position kept in previous_position and collision_box recomputed in the same pass.
+ *
+ * The SSE2 path does the lead-in length, the interpolation along the lead-in or route segment,
+ * and collision boxes four enemies at a time; only finding each route segment (RouteTable::seek)
+ * and the rare wrap around a loop stay one at a time.
+ * It uses the same float operations in the same order as the scalar path -- exact sqrt and
+ * divide, no reciprocal estimates -- so both give bit-identical results, and recordings,
+ * rollback, and state hashes don't depend on which one ran.
+ */
+
+//steer 'count' enemies; bodies[i] goes with followers[i]:
+void steer_enemies(RaidenGame::Body *bodies, RaidenGame::RouteFollower *followers, uint32_t count, RouteTable const &routes, float step);
+
+//same results as steer_enemies, one enemy at a time (the fallback path):
+void steer_enemies_scalar(RaidenGame::Body *bodies, RaidenGame::RouteFollower *followers, uint32_t count, RouteTable const &routes, float step);
@@ -10,6 +10,18 @@
 //GL.hpp will include a non-namespace-polluting set of opengl prototypes:
 #include "GL.hpp"
 
+//worker threads shared by the modes:
+#include "JobSystem.hpp"
+
+//for per-frame scratch memory:
+#include "FrameArena.hpp"
+
+//for per-frame vertex uploads:
+#include "StreamBuffer.hpp"
+
+//for counting heap allocations (--frame-stats):
+#include "alloc_count.hpp"
+
 //for screenshots:
 #include "load_save_png.hpp"
 
@@ -18,10 +30,15 @@
 
 //...and for c++ standard library functions:
 #include <chrono>
+#include <cmath>
 #include <iostream>
 #include <stdexcept>
 #include <memory>
 #include <algorithm>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
 
 int main(int argc, char **argv) {
 #ifdef _WIN32
@@ -29,6 +46,136 @@ int main(int argc, char **argv) {
 	try {
 #endif
 
+	//------------  command line ------------
+
+	//the simulation runs at a fixed rate, independent of the display:
+	float tick_rate = 120.0f; //updates per second
+	uint32_t max_catch_up = 8; //most updates run in one frame before the game is allowed to fall behind real time
+	uint32_t threads = std::max(1u, std::thread::hardware_concurrency()); //for Mode::jobs (includes the main thread)
+	bool job_stats = false; //print worker utilization once a second
+	bool frame_stats = false; //print heap allocations per frame and frame arena use once a second
+	bool fixed_seed = false; //if not given, every new game gets a random seed
+	uint64_t seed = 0;
+	std::string record_filename; //save each game's inputs here
+	std::string replay_filename; //play back this recording (as fast as possible) instead of taking input
+	uint64_t seek_tick = 0; //...starting from this tick
+	uint32_t coop = 0; //1 or 2 to play co-op (see Rollback.hpp) with the game at 'peer'
+	uint16_t port = 0; //...listening here
+	std::string peer_address;
+	std::string server_address; //watch (and fly in) the game hosted by a raiden_headless --server here
+	NetShim shim; //added latency + loss, for testing co-op or a server on one machine
+	bool waves = false; //enemies fire bullet patterns (see BulletPatterns.hpp) instead of single shots
+	std::vector< std::string > pattern_texts; //...these ones, instead of the built-in patterns
+
+	for (int argi = 1; argi < argc; ++argi) {
+		std::string arg = argv[argi];
+		if (arg == "--tick-rate" && argi + 1 < argc) {
+			tick_rate = std::stof(argv[++argi]);
+		} else if (arg == "--max-catch-up" && argi + 1 < argc) {
+			max_catch_up = uint32_t(std::stoul(argv[++argi]));
+		} else if (arg == "--threads" && argi + 1 < argc) {
+			threads = uint32_t(std::stoul(argv[++argi]));
+		} else if (arg == "--seed" && argi + 1 < argc) {
+			seed = std::stoull(argv[++argi]);
+			fixed_seed = true;
+		} else if (arg == "--record" && argi + 1 < argc) {
+			record_filename = argv[++argi];
+		} else if (arg == "--replay" && argi + 1 < argc) {
+			replay_filename = argv[++argi];
+		} else if (arg == "--seek" && argi + 1 < argc) {
+			seek_tick = std::stoull(argv[++argi]);
+		} else if (arg == "--waves") {
+			waves = true;
+		} else if (arg == "--pattern" && argi + 1 < argc) {
+			waves = true;
+			pattern_texts.emplace_back(argv[++argi]);
+		} else if (arg == "--job-stats") {
+			job_stats = true;
+		} else if (arg == "--frame-stats") {
+			frame_stats = true;
+		} else if (arg == "--coop" && argi + 1 < argc) {
+			coop = uint32_t(std::stoul(argv[++argi]));
+		} else if (arg == "--port" && argi + 1 < argc) {
+			port = uint16_t(std::stoul(argv[++argi]));
+		} else if (arg == "--peer" && argi + 1 < argc) {
+			peer_address = argv[++argi];
+		} else if (arg == "--connect" && argi + 1 < argc) {
+			server_address = argv[++argi];
+		} else if (arg == "--net-latency" && argi + 1 < argc) {
+			shim.latency = std::stof(argv[++argi]) / 1000.0f;
+		} else if (arg == "--net-jitter" && argi + 1 < argc) {
+			shim.jitter = std::stof(argv[++argi]) / 1000.0f;
+		} else if (arg == "--net-loss" && argi + 1 < argc) {
+			shim.loss = std::stof(argv[++argi]) / 100.0f;
+		} else {
+			std::cerr << "Usage:\n\t" << argv[0] << " [--tick-rate <hz>] [--max-catch-up <updates>] [--threads <n>] [--seed <s>] [--record <file> | --replay <file> [--seek <tick>]] [--waves] [--pattern \"<pattern>\"] [--job-stats] [--frame-stats]"
+				<< " [--coop 1|2 --port <p> --peer <host:port> | --connect <host:port>] [--net-latency <ms>] [--net-jitter <ms>] [--net-loss <percent>]" << std::endl;
+			return 1;
+		}
+	}
+	if (!(tick_rate > 0.0f) || max_catch_up == 0 || threads == 0) {
+		std::cerr << "Tick rate, max catch-up, and threads must all be positive." << std::endl;
+		return 1;
+	}
+
+	std::vector< Pattern > custom_patterns;
+	if (waves) {
+		//(a replay brings its own patterns; the other players of a networked game wouldn't have these)
+		if (!replay_filename.empty() || coop || !server_address.empty()) {
+			std::cerr << "Bullet pattern waves can't be added to a replay or a networked game." << std::endl;
+			return 1;
+		}
+		try {
+			for (std::string const &text : pattern_texts) {
+				custom_patterns.emplace_back(Pattern::parse(text));
+			}
+		} catch (std::exception const &e) {
+			std::cerr << e.what() << std::endl;
+			return 1;
+		}
+	}
+
+	NetAddress peer;
+	if (coop) {
+		if (coop > 2 || peer_address.empty() || !record_filename.empty() || !replay_filename.empty() || !server_address.empty()) {
+			std::cerr << "Co-op needs --coop 1 or 2 and a --peer, and can't be recorded, replayed, or played on a server." << std::endl;
+			return 1;
+		}
+		try {
+			peer = NetAddress::parse(peer_address);
+		} catch (std::exception const &e) {
+			std::cerr << e.what() << std::endl;
+			return 1;
+		}
+	}
+	NetAddress server;
+	if (!server_address.empty()) {
+		if (!record_filename.empty() || !replay_filename.empty()) {
+			std::cerr << "A server's game can't be recorded or replayed here." << std::endl;
+			return 1;
+		}
+		try {
+			server = NetAddress::parse(server_address);
+		} catch (std::exception const &e) {
+			std::cerr << e.what() << std::endl;
+			return 1;
+		}
+	}
+
+	//a replay brings its own seed and tick rate:
+	Replay playback;
+	if (!replay_filename.empty()) {
+		try {
+			playback = Replay::load(replay_filename);
+		} catch (std::exception const &e) {
+			std::cerr << e.what() << std::endl;
+			return 1;
+		}
+		tick_rate = playback.tick_rate;
+		std::cout << "Replaying " << playback.inputs.size() << " ticks from '" << replay_filename << "' (seed " << playback.seed << ")." << std::endl;
+	}
+	const float tick = 1.0f / tick_rate;
+
 	//------------  initialization ------------
 
 	//Initialize SDL library:
@@ -79,7 +226,10 @@ int main(int argc, char **argv) {
 	init_GL();
 
 	//Set VSYNC + Late Swap (prevents crazy FPS):
-	if (SDL_GL_SetSwapInterval(-1) != 0) {
+	if (!replay_filename.empty()) {
+		//...except when replaying, which should run as fast as possible:
+		SDL_GL_SetSwapInterval(0);
+	} else if (SDL_GL_SetSwapInterval(-1) != 0) {
 		std::cerr << "NOTE: couldn't set vsync + late swap tearing (" << SDL_GetError() << ")." << std::endl;
 		if (SDL_GL_SetSwapInterval(1) != 0) {
 			std::cerr << "NOTE: couldn't set vsync (" << SDL_GetError() << ")." << std::endl;
@@ -89,12 +239,63 @@ int main(int argc, char **argv) {
 	//Hide mouse cursor (note: showing can be useful for debugging):
 	SDL_ShowCursor(SDL_DISABLE);
 
+	//------------ start worker threads --------------
+	JobSystem jobs(threads);
+	Mode::jobs = &jobs;
+
+	//------------ per-frame scratch memory --------------
+	FrameArena frame_arena(4 << 20); //(grows if a frame needs more)
+	Mode::frame_arena = &frame_arena;
+
+	//------------ per-frame vertex uploads --------------
+	//(held by pointer so it can be freed before the GL context is)
+	std::unique_ptr< StreamBuffer > vertex_stream(new StreamBuffer(1 << 20)); //(grows if a frame needs more)
+	Mode::vertex_stream = vertex_stream.get();
+
 	//------------ create game mode + make current --------------
+	//each game's seed is printed, so any run can be replayed with --seed:
+	auto next_seed = [&]() {
+		if (!fixed_seed) {
+			std::random_device rd;
+			seed = (uint64_t(rd()) << 32) | rd();
+		}
+		std::cout << "Seed: " << seed << std::endl;
+		return seed;
+	};
+
+	auto new_game = [&]() -> std::shared_ptr< RaidenMode > {
+		if (!replay_filename.empty()) {
+			auto mode = std::make_shared< RaidenMode >(playback);
+			if (seek_tick) mode->seek(seek_tick);
+			return mode;
+		}
+		auto mode = std::make_shared< RaidenMode >(next_seed());
+		if (waves) mode->game.start_waves(custom_patterns);
+		if (!record_filename.empty()) mode->start_recording(record_filename, tick_rate);
+		if (coop) {
+			shim.seed = seed + coop;
+			mode->start_coop(coop - 1, port, peer, shim, tick_rate);
+		}
+		if (server.port) {
+			shim.seed = seed;
+			mode->start_client(server, shim);
+		}
+		return mode;
+	};
+
 	//Mode::set_current(std::make_shared< PongMode >());
-	Mode::set_current(std::make_shared< RaidenMode >());
+	try {
+		Mode::set_current(new_game());
+	} catch (std::exception const &e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
 
 	//------------ main loop ------------
 
+	//F5 saves a snapshot of the current mode here, F9 loads it back:
+	std::vector< uint8_t > quick_save;
+
 	//this inline function will be called whenever the window is resized,
 	// and will update the window_size and drawable_size variables:
 	glm::uvec2 window_size; //size of window (layout pixels)
@@ -115,6 +316,8 @@ int main(int argc, char **argv) {
 		//every pass through the game loop creates one frame of output
 		//  by performing three steps:
 
+		jobs.begin_frame();
+
 		{ //(1) process any events that are pending
 			static SDL_Event evt;
 			while (SDL_PollEvent(&evt) == 1) {
@@ -142,37 +345,135 @@ int main(int argc, char **argv) {
 						px.a = 0xff;
 					}
 					save_png(filename, glm::uvec2(w,h), data.data(), LowerLeftOrigin);
+				} else if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_r && coop) {
+					std::cout << "Can't reset a co-op game (the other player would be left behind)." << std::endl;
+				} else if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_r && server.port) {
+					std::cout << "Can't reset the server's game (it starts a new one itself)." << std::endl;
 				} else if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_r) {
 					Mode::set_current(nullptr);
-					Mode::set_current(std::make_shared< RaidenMode >());
+					Mode::set_current(new_game());
+				} else if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_F5) {
+					// --- quick save (in memory) ---
+					std::vector< uint8_t > snapshot;
+					auto before = std::chrono::high_resolution_clock::now();
+					if (Mode::current->save_snapshot(snapshot)) {
+						double us = std::chrono::duration< double, std::micro >(std::chrono::high_resolution_clock::now() - before).count();
+						quick_save.swap(snapshot);
+						std::cout << "Quick saved " << quick_save.size() << " bytes in " << us << " us." << std::endl;
+					}
+				} else if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_F9 && !quick_save.empty()) {
+					// --- quick load ---
+					try {
+						auto before = std::chrono::high_resolution_clock::now();
+						Mode::current->load_snapshot(quick_save.data(), quick_save.size());
+						double us = std::chrono::duration< double, std::micro >(std::chrono::high_resolution_clock::now() - before).count();
+						std::cout << "Quick loaded " << quick_save.size() << " bytes in " << us << " us." << std::endl;
+					} catch (std::exception const &e) {
+						std::cerr << "Failed to quick load: " << e.what() << std::endl;
+					}
 				}
 			}
 			if (!Mode::current) break;
 		}
 
-		{ //(2) call the current mode's "update" function to deal with elapsed time:
+		if (!replay_filename.empty()) { //(2, replaying) one tick per frame, without waiting for real time:
+			std::shared_ptr< Mode > mode = Mode::current; //(update may end the mode)
+			mode->update(tick);
+			if (!Mode::current) break;
+			Mode::current->render_alpha = 1.0f;
+		} else { //(2) call the current mode's "update" function once per tick of elapsed time:
 			auto current_time = std::chrono::high_resolution_clock::now();
 			static auto previous_time = current_time;
-			float elapsed = std::chrono::duration< float >(current_time - previous_time).count();
+			static double accumulated = 0.0; //real time not yet simulated
+			accumulated += std::chrono::duration< double >(current_time - previous_time).count();
 			previous_time = current_time;
 
+			uint32_t steps = 0;
+			while (accumulated >= tick && steps < max_catch_up) {
+				std::shared_ptr< Mode > mode = Mode::current; //(update may end the mode)
+				mode->update(tick);
+				if (!Mode::current) break;
+				accumulated -= tick;
+				steps += 1;
+			}
+			if (!Mode::current) break;
+
 			//if frames are taking a very long time to process,
-			//lag to avoid spiral of death:
-			elapsed = std::min(0.1f, elapsed);
+			//lag (drop the time we couldn't simulate) to avoid spiral of death:
+			if (accumulated >= tick) {
+				accumulated = std::fmod(accumulated, double(tick));
+			}
 
-			Mode::current->update(elapsed);
-			if (!Mode::current) break;
+			Mode::current->render_alpha = float(accumulated / tick);
 		}
 
 		{ //(3) call the current mode's "draw" function to produce output:
 		
 			Mode::current->draw(drawable_size);
+
+			//fence this frame's vertices, so their region isn't overwritten until the GPU is done with it:
+			vertex_stream->end_frame();
 		}
 
 		//Wait until the recently-drawn frame is shown before doing it all again:
 		SDL_GL_SwapWindow(window);
+
+		//the frame is done, and so is its scratch memory:
+		frame_arena.reset();
+
+		jobs.end_frame();
+		if (job_stats) { //average utilization per thread over about a second of frames:
+			static std::vector< float > utilization(jobs.threads(), 0.0f);
+			static float seconds = 0.0f;
+			static uint32_t frames = 0;
+			for (uint32_t t = 0; t < jobs.threads(); ++t) {
+				utilization[t] += jobs.last_frame.utilization[t];
+			}
+			seconds += jobs.last_frame.seconds;
+			frames += 1;
+			if (seconds >= 1.0f) {
+				std::cout << "jobs: " << frames << " frames, utilization";
+				for (float &u : utilization) {
+					std::cout << " " << int(100.0f * u / frames + 0.5f) << "%";
+					u = 0.0f;
+				}
+				std::cout << std::endl;
+				seconds = 0.0f;
+				frames = 0;
+			}
+		}
+		if (frame_stats) { //heap and vertex stream use over about a second of frames:
+			static auto report_at = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+			static uint64_t allocations_before = allocation_count.load(std::memory_order_relaxed);
+			static uint32_t frames = 0;
+			static StreamBuffer::Stats stream_before = vertex_stream->stats;
+			frames += 1;
+			auto now = std::chrono::steady_clock::now();
+			if (now >= report_at) {
+				uint64_t allocations = allocation_count.load(std::memory_order_relaxed);
+				std::cout << "frames: " << frames << ", " << double(allocations - allocations_before) / frames << " heap allocations/frame, arena "
+					<< frame_arena.stats.high_water / 1024 << " of " << frame_arena.stats.capacity / 1024 << " KB peak ("
+					<< frame_arena.stats.overflows << " overflows, " << frame_arena.stats.grows << " grows)" << std::endl;
+				StreamBuffer::Stats const &stream = vertex_stream->stats;
+				std::cout << "vertex stream: " << double(stream.bytes - stream_before.bytes) / 1024.0 / frames << " KB/frame, "
+					<< (stream.stalls - stream_before.stalls) << " stalls (" << (stream.stall_ms - stream_before.stall_ms) << " ms), "
+					<< (stream.spills - stream_before.spills) << " spills, " << stream.grows << " grows" << std::endl;
+				stream_before = stream;
+				//(counted after printing, so the report's own allocations don't count)
+				allocations_before = allocation_count.load(std::memory_order_relaxed);
+				frames = 0;
+				report_at = now + std::chrono::seconds(1);
+			}
+		}
 	}
 
+	//(the loop ends once there's no current mode, so nothing draws from the stream past here)
+	Mode::vertex_stream = nullptr;
+	vertex_stream.reset();
+
+	Mode::frame_arena = nullptr;
+	Mode::jobs = nullptr;
+
 
 	//------------  teardown ------------
 
@@ -0,0 +1,263 @@
+//raiden_batch plays many complete games of RaidenGame with a scripted player -- no window,
+// no GL -- spread across all cores, and reports how long players survive and how the
+// game plays at each difficulty level. Meant for balance tuning.
+//
+//Each game runs on one thread until the player dies (or --minutes of game time pass);
+// games are independent, so they are handed out to the job system a few at a time, and
+// each run of games reuses one RaidenGame (see RaidenGame::reset).
+//Game 'i' uses seed S + i, so any single game can be re-run (and recorded) with
+// raiden_headless --seed <S + i> --player <same player>. Results never depend on --threads.
+//
+//Difficulty (RaidenGame::game_difficulty_mode) only goes up; it is bucketed by powers of two,
+// and each bucket reports how many games got there, how long they spent there, and the
+// kills and deaths per minute spent there.
+//
+//usage: raiden_batch [--games N] [--seed S] [--tick-rate HZ] [--minutes M] [--threads N]
+//                    [--player idle|shoot|random] [--json FILE]
+
+#include "Autopilot.hpp"
+#include "RaidenGame.hpp"
+#include "alloc_count.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+//difficulty buckets: [1,2), [2,4), [4,8), ... with the last one open-ended:
+const uint32_t DifficultyBuckets = 16;
+
+uint32_t difficulty_bucket(float difficulty) {
+	int exponent = 0;
+	std::frexp(std::max(difficulty, 1.0f), &exponent); //difficulty in [2^(exponent-1), 2^exponent)
+	return std::min(uint32_t(exponent - 1), DifficultyBuckets - 1);
+}
+
+struct GameResult {
+	uint64_t ticks = 0; //ticks survived (or played, if the player never died)
+	bool died = false;
+	uint32_t kills = 0;
+	float difficulty = 1.0f; //at the end
+	uint64_t bucket_ticks[DifficultyBuckets] = {};
+	uint32_t bucket_kills[DifficultyBuckets] = {};
+};
+
+//play one game in 'game' (which is reset first):
+GameResult play(RaidenGame *game, uint64_t seed, Player player, float tick_rate, uint64_t max_ticks) {
+	const float tick = 1.0f / tick_rate;
+	game->reset(seed);
+	Autopilot autopilot(player, seed);
+
+	GameResult result;
+	while (result.ticks < max_ticks) {
+		uint32_t bucket = difficulty_bucket(game->game_difficulty_mode);
+		int kills_before = game->killed_enemies_num;
+		game->curr_status = autopilot.input(tick);
+		game->update(tick);
+		result.ticks += 1;
+		result.bucket_ticks[bucket] += 1;
+		result.bucket_kills[bucket] += uint32_t(game->killed_enemies_num - kills_before);
+		if (game->player_health <= 0.0f) {
+			result.died = true;
+			break;
+		}
+	}
+	result.kills = uint32_t(game->killed_enemies_num);
+	result.difficulty = game->game_difficulty_mode;
+	return result;
+}
+
+struct Summary {
+	uint32_t games = 0;
+	uint32_t died = 0;
+	double mean_minutes = 0.0, p10_minutes = 0.0, p50_minutes = 0.0, p90_minutes = 0.0, max_minutes = 0.0;
+	double mean_kills = 0.0;
+	struct Bucket {
+		float min_difficulty = 0.0f;
+		uint32_t reached = 0; //games that spent any time here
+		uint32_t died = 0; //games that ended here
+		double minutes = 0.0; //total, across games
+		uint64_t kills = 0;
+	} buckets[DifficultyBuckets];
+};
+
+Summary summarize(std::vector< GameResult > const &results, float tick_rate) {
+	Summary summary;
+	summary.games = uint32_t(results.size());
+	if (results.empty()) return summary;
+
+	const double ticks_per_minute = 60.0 * tick_rate;
+	std::vector< double > minutes;
+	minutes.reserve(results.size());
+	for (uint32_t b = 0; b < DifficultyBuckets; ++b) {
+		summary.buckets[b].min_difficulty = float(1u << b);
+	}
+	for (GameResult const &r : results) {
+		minutes.emplace_back(r.ticks / ticks_per_minute);
+		summary.mean_kills += r.kills;
+		if (r.died) {
+			summary.died += 1;
+			summary.buckets[difficulty_bucket(r.difficulty)].died += 1;
+		}
+		for (uint32_t b = 0; b < DifficultyBuckets; ++b) {
+			if (r.bucket_ticks[b] == 0) continue;
+			summary.buckets[b].reached += 1;
+			summary.buckets[b].minutes += r.bucket_ticks[b] / ticks_per_minute;
+			summary.buckets[b].kills += r.bucket_kills[b];
+		}
+	}
+	summary.mean_kills /= results.size();
+
+	double total = 0.0;
+	for (double m : minutes) total += m;
+	summary.mean_minutes = total / minutes.size();
+	std::sort(minutes.begin(), minutes.end());
+	auto percentile = [&](double p) {
+		return minutes[std::min(minutes.size() - 1, size_t(p * (minutes.size() - 1) + 0.5))];
+	};
+	summary.p10_minutes = percentile(0.10);
+	summary.p50_minutes = percentile(0.50);
+	summary.p90_minutes = percentile(0.90);
+	summary.max_minutes = minutes.back();
+	return summary;
+}
+
+void write_json(std::ostream &out, Summary const &summary, uint64_t seed, std::string const &player, float tick_rate, double max_minutes) {
+	out << "{\n";
+	out << "\t\"benchmark\": \"raiden_batch\",\n";
+	out << "\t\"format\": 1,\n";
+	out << "\t\"seed\": " << seed << ",\n";
+	out << "\t\"player\": \"" << player << "\",\n";
+	out << "\t\"tick_rate\": " << tick_rate << ",\n";
+	out << "\t\"max_minutes\": " << max_minutes << ",\n";
+	out << "\t\"games\": " << summary.games << ",\n";
+	out << "\t\"died\": " << summary.died << ",\n";
+	out << "\t\"survival_minutes\": { \"mean\": " << summary.mean_minutes << ", \"p10\": " << summary.p10_minutes
+		<< ", \"p50\": " << summary.p50_minutes << ", \"p90\": " << summary.p90_minutes << ", \"max\": " << summary.max_minutes << " },\n";
+	out << "\t\"mean_kills\": " << summary.mean_kills << ",\n";
+	out << "\t\"difficulty\": [\n";
+	bool first = true;
+	for (Summary::Bucket const &b : summary.buckets) {
+		if (b.reached == 0) continue;
+		out << (first ? "" : ",\n");
+		out << "\t\t{ \"min\": " << b.min_difficulty << ", \"reached\": " << b.reached << ", \"died\": " << b.died
+			<< ", \"minutes\": " << b.minutes << ", \"kills\": " << b.kills << " }";
+		first = false;
+	}
+	out << "\n\t]\n";
+	out << "}\n";
+}
+
+}
+
+int main(int argc, char **argv) {
+	uint32_t games = 1000;
+	uint64_t seed = 1;
+	float tick_rate = 120.0f;
+	double max_minutes = 10.0;
+	uint32_t threads = std::max(1u, std::thread::hardware_concurrency());
+	std::string player_name = "random";
+	Player player = Player::Random;
+	std::string json_path;
+
+	try {
+		for (int argi = 1; argi < argc; ++argi) {
+			std::string arg = argv[argi];
+			if (arg == "--games" && argi + 1 < argc) {
+				games = uint32_t(std::stoul(argv[++argi]));
+			} else if (arg == "--seed" && argi + 1 < argc) {
+				seed = std::stoull(argv[++argi]);
+			} else if (arg == "--tick-rate" && argi + 1 < argc) {
+				tick_rate = std::stof(argv[++argi]);
+			} else if (arg == "--minutes" && argi + 1 < argc) {
+				max_minutes = std::stod(argv[++argi]);
+			} else if (arg == "--threads" && argi + 1 < argc) {
+				threads = uint32_t(std::stoul(argv[++argi]));
+			} else if (arg == "--player" && argi + 1 < argc) {
+				player_name = argv[++argi];
+			} else if (arg == "--json" && argi + 1 < argc) {
+				json_path = argv[++argi];
+			} else {
+				throw std::runtime_error("Unexpected argument '" + arg + "'.");
+			}
+		}
+		if (games == 0) throw std::runtime_error("Need at least one game.");
+		if (!(tick_rate > 0.0f) || !(max_minutes > 0.0)) throw std::runtime_error("Tick rate and minutes must be positive.");
+		if (threads == 0) throw std::runtime_error("Need at least one thread.");
+		player = parse_player(player_name);
+	} catch (std::exception const &e) {
+		std::cerr << e.what() << "\n"
+			<< "Usage:\n\t" << argv[0] << " [--games N] [--seed S] [--tick-rate HZ] [--minutes M] [--threads N]"
+			<< " [--player idle|shoot|random] [--json FILE]" << std::endl;
+		return 1;
+	}
+
+	const uint64_t max_ticks = std::max< uint64_t >(1, uint64_t(max_minutes * 60.0 * tick_rate));
+	std::vector< GameResult > results(games);
+
+	JobSystem jobs(threads);
+	jobs.begin_frame();
+	uint64_t allocations_before = allocation_count.load(std::memory_order_relaxed);
+	auto before = std::chrono::high_resolution_clock::now();
+	//one game per index; each game is serial inside (so its own 'jobs' stays null):
+	jobs.parallel_for(games, 1, [&](uint32_t begin, uint32_t end) {
+		//(games are big -- mostly bullet storage -- so make one and reuse it)
+		std::unique_ptr< RaidenGame > game(new RaidenGame(seed + begin));
+		for (uint32_t g = begin; g < end; ++g) {
+			results[g] = play(game.get(), seed + g, player, tick_rate, max_ticks);
+		}
+	});
+	auto after = std::chrono::high_resolution_clock::now();
+	uint64_t allocations = allocation_count.load(std::memory_order_relaxed) - allocations_before;
+	jobs.end_frame();
+	double seconds = std::chrono::duration< double >(after - before).count();
+
+	uint64_t total_ticks = 0;
+	for (GameResult const &r : results) total_ticks += r.ticks;
+	Summary summary = summarize(results, tick_rate);
+
+	std::printf("raiden_batch: %u games at %g Hz (seeds %llu..%llu, player %s, at most %g minutes each, %u threads)\n",
+		games, tick_rate, (unsigned long long)seed, (unsigned long long)(seed + games - 1), player_name.c_str(), max_minutes, jobs.threads());
+	std::printf("  simulated: %llu ticks in %.2f s wall (%.0f ticks/s)\n",
+		(unsigned long long)total_ticks, seconds, (seconds > 0.0 ? total_ticks / seconds : 0.0));
+	std::printf("  heap allocations: %llu (%.4f per tick)\n",
+		(unsigned long long)allocations, (total_ticks ? double(allocations) / total_ticks : 0.0));
+	std::printf("  died: %u of %u\n", summary.died, summary.games);
+	std::printf("  survival minutes: mean %.2f, p10 %.2f, p50 %.2f, p90 %.2f, max %.2f\n",
+		summary.mean_minutes, summary.p10_minutes, summary.p50_minutes, summary.p90_minutes, summary.max_minutes);
+	std::printf("  kills: mean %.1f\n", summary.mean_kills);
+	if (jobs.threads() > 1) {
+		std::printf("  utilization:");
+		for (float u : jobs.last_frame.utilization) std::printf(" %d%%", int(100.0f * u + 0.5f));
+		std::printf("\n");
+	}
+	std::printf("\n");
+
+	std::printf("%12s %8s %8s %12s %12s %12s\n", "difficulty", "reached", "died", "minutes", "kills/min", "deaths/min");
+	for (Summary::Bucket const &b : summary.buckets) {
+		if (b.reached == 0) continue;
+		std::printf("%12g %8u %8u %12.2f %12.2f %12.4f\n", b.min_difficulty, b.reached, b.died, b.minutes,
+			(b.minutes > 0.0 ? b.kills / b.minutes : 0.0), (b.minutes > 0.0 ? b.died / b.minutes : 0.0));
+	}
+
+	if (!json_path.empty()) {
+		std::ofstream json(json_path, std::ios::binary);
+		if (!json) {
+			std::cerr << "Failed to open '" << json_path << "' for writing." << std::endl;
+			return 1;
+		}
+		write_json(json, summary, seed, player_name, tick_rate, max_minutes);
+		std::cout << "Wrote results to '" << json_path << "'." << std::endl;
+	}
+
+	return 0;
+}
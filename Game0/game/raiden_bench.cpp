@@ -0,0 +1,389 @@
+//raiden_bench runs scripted RaidenGame scenarios headlessly at increasing entity counts
+// and reports how tick cost scales: p50/p99 tick time, heap allocations per tick, and peak RSS.
+//
+//Results are printed as a table and (optionally) written as JSON so runs of different
+// versions can be compared. Every scenario step uses a fixed seed, so runs are repeatable.
+//
+//Scenarios marked 'sweep_threads' run every step at 1, 2, 4, ... threads (up to --threads,
+// which defaults to the hardware thread count) to show how the parallel passes scale.
+//
+//usage: raiden_bench [--seed S] [--ticks N] [--threads N] [--scenario NAME] [--json FILE]
+
+#include "Particles.hpp"
+#include "RaidenGame.hpp"
+#include "alloc_count.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#define PSAPI_VERSION 2
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+//peak resident set size of this process, in kilobytes:
+uint64_t peak_rss_kb() {
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+	return uint64_t(counters.PeakWorkingSetSize) / 1024;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#if defined(__APPLE__)
+	return uint64_t(usage.ru_maxrss) / 1024; //bytes on macOS
+#else
+	return uint64_t(usage.ru_maxrss); //kilobytes on Linux
+#endif
+#endif
+}
+
+const float Tick = 1.0f / 120.0f;
+
+//------ scenarios ------
+
+//a scenario step builds a game with 'count' of something, then keeps it topped up every tick:
+struct Scenario {
+	std::string name;
+	std::string unit; //what 'count' counts
+	std::vector< uint32_t > counts;
+	std::function< void(RaidenGame &, uint32_t count, Rng &) > before_tick;
+	//what each tick runs and times (if not set, RaidenGame::update); made once per step, before warm-up:
+	std::function< std::function< void(float elapsed) >(RaidenGame &, uint32_t count) > make_update;
+	uint32_t ticks_scale = 1; //multiplier on --ticks (e.g., for long runs)
+	bool sweep_threads = false; //run each step at several thread counts
+};
+
+//player that holds fire and wanders, changing direction every half second:
+// (a function of the tick alone, so it doesn't disturb the scenario's random stream)
+int wander(uint64_t tick) {
+	static const int Directions[] = {
+		0, EventStatus::is_up, EventStatus::is_down, EventStatus::is_left, EventStatus::is_right,
+	};
+	uint32_t hash = uint32_t(tick / 60) * 2654435761u;
+	return EventStatus::none | EventStatus::is_shoot | Directions[(hash >> 16) % 5];
+}
+
+glm::vec2 random_point(Rng &rng) {
+	float x = rng.uniform(-COURT_RADIUS.x, COURT_RADIUS.x);
+	float y = rng.uniform(-COURT_RADIUS.y, COURT_RADIUS.y);
+	return glm::vec2(x, y);
+}
+
+glm::vec2 random_direction(Rng &rng) {
+	float a = rng.uniform(0.0f, 6.2831853f);
+	return glm::vec2(std::cos(a), std::sin(a));
+}
+
+std::vector< Scenario > make_scenarios() {
+	std::vector< Scenario > scenarios;
+
+	{ //bouncing player bullets everywhere; the player can't die, so the whole update runs every tick:
+		Scenario s;
+		s.name = "bullet_hell";
+		s.unit = "bullets";
+		s.counts = { 1000, 5000, 10000, 25000, 50000, 100000 };
+		s.sweep_threads = true;
+		s.before_tick = [](RaidenGame &game, uint32_t count, Rng &rng) {
+			game.player_health = PLAYER_HEALTH;
+			while (game.player_bullets.size() < count && !game.player_bullets.full()) {
+				game.player_bullets.spawn(random_point(rng), random_direction(rng));
+			}
+		};
+		scenarios.emplace_back(s);
+	}
+
+	{ //lots of enemies following routes and shooting:
+		Scenario s;
+		s.name = "enemy_swarm";
+		s.unit = "enemies";
+		s.counts = { 100, 250, 500, 1000, 2000 };
+		s.before_tick = [](RaidenGame &game, uint32_t count, Rng &rng) {
+			game.player_health = PLAYER_HEALTH;
+			while (game.enemy_count() < count && game.world.size() < game.world.capacity()) {
+				uint32_t route = game.random_route();
+				game.spawn_enemy(random_point(rng), route, ENEMY_HEALTH);
+				game.routes.release(route);
+			}
+		};
+		scenarios.emplace_back(s);
+	}
+
+	{ //enemies firing bullet patterns (the built-in ones, in turn) at an immortal player:
+		Scenario s;
+		s.name = "bullet_waves";
+		s.unit = "emitters";
+		s.counts = { 50, 100, 250, 500, 1000 };
+		s.before_tick = [](RaidenGame &game, uint32_t count, Rng &rng) {
+			game.player_health = PLAYER_HEALTH;
+			if (game.wave_patterns.empty()) game.start_waves();
+			while (game.enemy_count() < count && game.world.size() < game.world.capacity()) {
+				uint32_t route = game.random_route();
+				game.spawn_enemy(random_point(rng), route, ENEMY_HEALTH);
+				game.routes.release(route);
+			}
+		};
+		scenarios.emplace_back(s);
+	}
+
+	{ //effects: a burst of 'count' particles every half second, updated and expanded into vertices every tick:
+		Scenario s;
+		s.name = "particles";
+		s.unit = "per burst";
+		s.counts = { 1000, 10000, 30000 };
+		s.before_tick = [](RaidenGame &, uint32_t, Rng &) { };
+		s.make_update = [](RaidenGame &, uint32_t count) -> std::function< void(float) > {
+			struct Vertex {
+				Vertex() = default;
+				Vertex(glm::vec3 const &Position_, glm::u8vec4 const &Color_, glm::vec2 const &TexCoord_) :
+					Position(Position_), Color(Color_), TexCoord(TexCoord_) { }
+				glm::vec3 Position;
+				glm::u8vec4 Color;
+				glm::vec2 TexCoord;
+			};
+			std::shared_ptr< Particles > particles = std::make_shared< Particles >();
+			std::shared_ptr< std::vector< Vertex > > vertices = std::make_shared< std::vector< Vertex > >(6 * particles->capacity);
+			Particles::Burst burst;
+			burst.count = count;
+			burst.lifetime_min = 0.5f;
+			burst.lifetime_max = 1.0f;
+			uint64_t tick = 0;
+			return [=](float elapsed) mutable {
+				if (tick++ % 60 == 0) particles->emit(glm::vec2(0.0f), glm::vec2(0.0f), burst);
+				particles->update(elapsed);
+				particles->write_quads(vertices->data(), 0.5f);
+			};
+		};
+		scenarios.emplace_back(s);
+	}
+
+	{ //the normal game, played for a long time by an immortal wandering player:
+		Scenario s;
+		s.name = "endless";
+		s.unit = "minutes";
+		s.counts = { 1, 5, 15 };
+		s.ticks_scale = 0; //ticks come from 'count' minutes instead
+		s.before_tick = [](RaidenGame &game, uint32_t, Rng &) {
+			game.player_health = PLAYER_HEALTH;
+		};
+		scenarios.emplace_back(s);
+	}
+
+	return scenarios;
+}
+
+struct Result {
+	std::string scenario;
+	std::string unit;
+	uint32_t count = 0;
+	uint32_t threads = 1;
+	uint64_t ticks = 0;
+	double mean_us = 0.0, p50_us = 0.0, p99_us = 0.0, max_us = 0.0;
+	double allocations_per_tick = 0.0;
+	uint64_t peak_rss_kb = 0;
+	//what each bullet pattern that fired cost, over the timed ticks:
+	struct PatternCost {
+		std::string name;
+		uint64_t emitters = 0, shots = 0, bullets = 0;
+		double ms = 0.0;
+	};
+	std::vector< PatternCost > patterns;
+};
+
+Result run_step(Scenario const &scenario, uint32_t count, uint32_t threads, uint64_t ticks, uint64_t seed) {
+	typedef std::chrono::high_resolution_clock Clock;
+
+	Rng rng = Rng(seed).stream(0xbe4c); //scenario draws, separate from the game's own streams
+	JobSystem jobs(threads);
+	RaidenGame game(seed);
+	game.jobs = &jobs;
+	RaidenGame::EmitterProfile emitter_profile;
+
+	if (scenario.ticks_scale == 0) {
+		ticks = uint64_t(count) * 60 * 120; //'count' minutes at 120Hz
+	} else {
+		ticks *= scenario.ticks_scale;
+	}
+
+	std::function< void(float) > update = [&game](float elapsed) { game.update(elapsed); };
+	if (scenario.make_update) update = scenario.make_update(game, count);
+
+	//warm up so pools, routes, and the grid reach steady state before timing:
+	const uint64_t Warmup = 120;
+	for (uint64_t t = 0; t < Warmup; ++t) {
+		scenario.before_tick(game, count, rng);
+		game.curr_status = wander(t);
+		update(Tick);
+	}
+
+	std::vector< float > durations;
+	durations.reserve(size_t(ticks));
+	//(only the timed ticks are profiled; sized up front so the first shots don't count an allocation)
+	emitter_profile.patterns.resize(game.patterns.size());
+	game.profile = &emitter_profile;
+
+	//only count allocations made by update() itself, not by the scenario's top-up code:
+	uint64_t allocations = 0;
+	for (uint64_t t = 0; t < ticks; ++t) {
+		scenario.before_tick(game, count, rng);
+		game.curr_status = wander(Warmup + t);
+		uint64_t allocations_before = allocation_count.load(std::memory_order_relaxed);
+		auto before = Clock::now();
+		update(Tick);
+		auto after = Clock::now();
+		allocations += allocation_count.load(std::memory_order_relaxed) - allocations_before;
+		durations.emplace_back(std::chrono::duration< float, std::micro >(after - before).count());
+	}
+
+	Result result;
+	result.scenario = scenario.name;
+	result.unit = scenario.unit;
+	result.count = count;
+	result.threads = threads;
+	result.ticks = ticks;
+	double total = 0.0;
+	for (float d : durations) total += d;
+	result.mean_us = total / double(ticks);
+	std::sort(durations.begin(), durations.end());
+	auto percentile = [&](double p) {
+		size_t i = std::min(durations.size() - 1, size_t(p * (durations.size() - 1) + 0.5));
+		return double(durations[i]);
+	};
+	result.p50_us = percentile(0.50);
+	result.p99_us = percentile(0.99);
+	result.max_us = durations.back();
+	result.allocations_per_tick = double(allocations) / double(ticks);
+	result.peak_rss_kb = peak_rss_kb();
+	for (uint32_t p = 0; p < emitter_profile.patterns.size(); ++p) {
+		RaidenGame::FiringCost const &stats = emitter_profile.patterns[p];
+		if (stats.shots == 0) continue;
+		Result::PatternCost cost;
+		cost.name = game.patterns[p].name;
+		cost.emitters = stats.emitters;
+		cost.shots = stats.shots;
+		cost.bullets = stats.bullets;
+		cost.ms = stats.ms;
+		result.patterns.emplace_back(cost);
+	}
+	return result;
+}
+
+void write_json(std::ostream &out, std::vector< Result > const &results, uint64_t seed, uint64_t ticks) {
+	out << "{\n";
+	out << "\t\"benchmark\": \"raiden_bench\",\n";
+	out << "\t\"format\": 1,\n";
+	out << "\t\"seed\": " << seed << ",\n";
+	out << "\t\"tick_rate\": " << 1.0f / Tick << ",\n";
+	out << "\t\"ticks_per_step\": " << ticks << ",\n";
+	out << "\t\"results\": [\n";
+	for (size_t i = 0; i < results.size(); ++i) {
+		Result const &r = results[i];
+		out << "\t\t{ \"scenario\": \"" << r.scenario << "\", \"unit\": \"" << r.unit << "\", \"count\": " << r.count
+			<< ", \"threads\": " << r.threads << ", \"ticks\": " << r.ticks
+			<< ", \"mean_us\": " << r.mean_us << ", \"p50_us\": " << r.p50_us << ", \"p99_us\": " << r.p99_us << ", \"max_us\": " << r.max_us
+			<< ", \"allocations_per_tick\": " << r.allocations_per_tick << ", \"peak_rss_kb\": " << r.peak_rss_kb;
+		if (!r.patterns.empty()) {
+			out << ", \"patterns\": [";
+			for (size_t p = 0; p < r.patterns.size(); ++p) {
+				Result::PatternCost const &cost = r.patterns[p];
+				out << (p ? ", " : " ") << "{ \"name\": \"" << cost.name << "\", \"emitters\": " << cost.emitters << ", \"shots\": " << cost.shots
+					<< ", \"bullets\": " << cost.bullets << ", \"ms\": " << cost.ms << " }";
+			}
+			out << " ]";
+		}
+		out << " }"
+			<< (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	out << "\t]\n";
+	out << "}\n";
+}
+
+}
+
+int main(int argc, char **argv) {
+	uint64_t seed = 1;
+	uint64_t ticks = 1200;
+	uint32_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+	std::string only;
+	std::string json_path;
+
+	try {
+		for (int argi = 1; argi < argc; ++argi) {
+			std::string arg = argv[argi];
+			if (arg == "--seed" && argi + 1 < argc) {
+				seed = std::stoull(argv[++argi]);
+			} else if (arg == "--ticks" && argi + 1 < argc) {
+				ticks = std::stoull(argv[++argi]);
+			} else if (arg == "--threads" && argi + 1 < argc) {
+				max_threads = uint32_t(std::stoul(argv[++argi]));
+			} else if (arg == "--scenario" && argi + 1 < argc) {
+				only = argv[++argi];
+			} else if (arg == "--json" && argi + 1 < argc) {
+				json_path = argv[++argi];
+			} else {
+				throw std::runtime_error("Unexpected argument '" + arg + "'.");
+			}
+		}
+		if (ticks == 0) throw std::runtime_error("Need at least one tick per step.");
+		if (max_threads == 0) throw std::runtime_error("Need at least one thread.");
+	} catch (std::exception const &e) {
+		std::cerr << e.what() << "\n"
+			<< "Usage:\n\t" << argv[0] << " [--seed S] [--ticks N] [--threads N] [--scenario NAME] [--json FILE]" << std::endl;
+		return 1;
+	}
+
+	std::vector< Result > results;
+
+	std::printf("%-12s %8s %8s %8s %10s %10s %10s %12s %10s\n", "scenario", "count", "threads", "ticks", "mean us", "p50 us", "p99 us", "allocs/tick", "peak MB");
+	for (auto const &scenario : make_scenarios()) {
+		if (!only.empty() && scenario.name != only) continue;
+		std::vector< uint32_t > thread_counts;
+		if (scenario.sweep_threads) {
+			for (uint32_t t = 1; t < max_threads; t *= 2) thread_counts.emplace_back(t);
+		}
+		thread_counts.emplace_back(max_threads);
+
+		for (uint32_t count : scenario.counts) {
+			for (uint32_t threads : thread_counts) {
+				Result r = run_step(scenario, count, threads, ticks, seed);
+				std::printf("%-12s %8u %8u %8llu %10.1f %10.1f %10.1f %12.2f %10.1f\n",
+					r.scenario.c_str(), r.count, r.threads, (unsigned long long)r.ticks,
+					r.mean_us, r.p50_us, r.p99_us, r.allocations_per_tick, r.peak_rss_kb / 1024.0);
+				for (Result::PatternCost const &cost : r.patterns) {
+					std::printf("  %-10s %8llu emitters %8llu shots %10llu bullets %10.3f ms %8.2f us/shot\n", cost.name.c_str(),
+						(unsigned long long)cost.emitters, (unsigned long long)cost.shots, (unsigned long long)cost.bullets, cost.ms, 1000.0 * cost.ms / cost.shots);
+				}
+				std::fflush(stdout);
+				results.emplace_back(r);
+			}
+		}
+	}
+
+	if (!json_path.empty()) {
+		std::ofstream json(json_path, std::ios::binary);
+		if (!json) {
+			std::cerr << "Failed to open '" << json_path << "' for writing." << std::endl;
+			return 1;
+		}
+		write_json(json, results, seed, ticks);
+		std::cout << "Wrote results to '" << json_path << "'." << std::endl;
+	}
+
+	return 0;
+}
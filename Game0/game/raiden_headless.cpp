@@ -0,0 +1,510 @@
+//raiden_headless ticks RaidenGame from the command line -- no window, no GL --
+// and reports simulation throughput. Useful for perf and balance runs on machines without a GPU.
+//
+//The final state hash depends only on the options (never on --threads), so it can be used
+// to check that two builds or thread counts simulate the same game.
+//
+//--record saves the inputs of the run (see Replay.hpp); --replay plays back a recording
+// (from here or from the game) instead of the scripted player, using its seed and tick rate.
+// --seek starts the replay at a later tick by loading the nearest keyframe, and reports how long that took.
+//
+//--save-state writes the final game state (RaidenGame::save_state) to a file; --load-state starts from
+// one instead of a new game (its seed replaces --seed), and runs --ticks more ticks -- handy as a fixture.
+// (the scripted player's own state isn't saved, so a 'random' player won't continue exactly as it would have.)
+//Every run also reports the state's size, how long saving and loading it take, and how long a
+// worst-case rollback (restore + ROLLBACK_MAX_FRAMES ticks) takes.
+//
+//--coop runs one side of a two-player rollback game (see Rollback.hpp) against another raiden_headless
+// (or the game) at --peer, in real time; the scripted player flies this side's fighter. --net-latency,
+// --net-jitter, and --net-loss pass this side's packets through a shim (see Net.hpp). Both sides print the
+// same state hash at the end:
+//   raiden_headless --coop 1 --port 7001 --peer 127.0.0.1:7002 --ticks 3600 --net-latency 40 --net-loss 5 &
+//   raiden_headless --coop 2 --port 7002 --peer 127.0.0.1:7001 --ticks 3600 --net-latency 40 --net-loss 5
+//
+//--server hosts the game for thin clients (see StateServer.hpp): it runs in real time, sends each client
+// --send-rate views a second, and every few seconds reports the bandwidth per client and the CPU time per
+// tick spent simulating and encoding. The first client to connect flies the fighter (until then the scripted
+// player does), and a new game starts a few seconds after the fighter goes down.
+//--connect is a client with no window: the scripted player sends input, and it reports what it receives
+// (many of them make a cheap load test for a server).
+//
+//--waves has enemies fire bullet patterns (see BulletPatterns.hpp) instead of single shots, cycling through the
+// built-in ones; each --pattern "<text>" adds a pattern (and waves use only those). The report then includes what
+// each pattern cost to fire and which emitters cost the most, e.g.:
+//   raiden_headless --waves --player idle --ticks 20000
+//   raiden_headless --pattern "flower count=64 arc=360 spin=7 interval=0.25" --player idle
+//
+//usage: raiden_headless [--ticks N] [--seed S] [--tick-rate HZ] [--threads N] [--player idle|shoot|random]
+//                       [--record FILE | --replay FILE [--seek TICK] | --load-state FILE] [--save-state FILE]
+//                       [--waves] [--pattern TEXT]...
+//                       [--coop 1|2 --port P --peer HOST:PORT | --server PORT [--send-rate HZ] | --connect HOST:PORT]
+//                       [--net-latency MS] [--net-jitter MS] [--net-loss PERCENT]
+
+#include "Autopilot.hpp"
+#include "RaidenGame.hpp"
+#include "Replay.hpp"
+#include "Rollback.hpp"
+#include "StateServer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace {
+
+//FNV-1a over the parts of the state that bullets and enemies affect (and the enemies' entity ids):
+uint64_t state_hash(RaidenGame const &game) {
+	uint64_t hash = 14695981039346656037ull;
+	auto add = [&hash](void const *data, size_t size) {
+		unsigned char const *bytes = reinterpret_cast< unsigned char const * >(data);
+		for (size_t i = 0; i < size; ++i) {
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		}
+	};
+	for (Bullets const *bullets : { &game.player_bullets, &game.enemy_bullets }) {
+		add(bullets->positions.data(), bullets->size() * sizeof(glm::vec2));
+		add(bullets->velocities.data(), bullets->size() * sizeof(glm::vec2));
+		add(bullets->lifetimes.data(), bullets->size() * sizeof(float));
+	}
+	game.world.each< RaidenGame::Enemy, RaidenGame::Body >([&](Entity const &e, RaidenGame::Enemy const &enemy, RaidenGame::Body const &body) {
+		add(&e, sizeof(e)); //(ids and generations, so a restore that hands out different ones shows up)
+		add(&body.position, sizeof(body.position));
+		add(&enemy.health, sizeof(enemy.health));
+	});
+	add(&game.bot_fighter, sizeof(game.bot_fighter));
+	add(&game.player_health, sizeof(game.player_health));
+	if (game.wing.active) {
+		add(&game.wing.position, sizeof(game.wing.position));
+		add(&game.wing.health, sizeof(game.wing.health));
+	}
+	return hash;
+}
+
+std::vector< uint8_t > read_file(std::string const &filename) {
+	std::ifstream in(filename, std::ios::binary);
+	if (!in) throw std::runtime_error("Failed to open '" + filename + "' for reading.");
+	return std::vector< uint8_t >(std::istreambuf_iterator< char >(in), std::istreambuf_iterator< char >());
+}
+
+void write_file(std::string const &filename, std::vector< uint8_t > const &bytes) {
+	std::ofstream out(filename, std::ios::binary);
+	out.write(reinterpret_cast< char const * >(bytes.data()), bytes.size());
+	if (!out) throw std::runtime_error("Failed to write '" + filename + "'.");
+}
+
+}
+
+int main(int argc, char **argv) {
+	uint64_t ticks = 100000;
+	uint64_t seed = 0;
+	float tick_rate = 120.0f;
+	uint32_t threads = std::max(1u, std::thread::hardware_concurrency());
+	std::string player_name = "random";
+	Player player = Player::Random;
+	std::string record_filename;
+	std::string replay_filename;
+	uint64_t seek_tick = 0;
+	Replay replay;
+	std::string load_state_filename;
+	std::string save_state_filename;
+	std::vector< uint8_t > loaded_state;
+	uint32_t coop = 0; //1 or 2 for a co-op game
+	uint16_t port = 0;
+	NetAddress peer;
+	NetShim shim;
+	bool server = false;
+	float send_rate = 30.0f;
+	std::string connect_address;
+	bool waves = false;
+	std::vector< Pattern > custom_patterns;
+
+	try {
+		for (int argi = 1; argi < argc; ++argi) {
+			std::string arg = argv[argi];
+			if (arg == "--ticks" && argi + 1 < argc) {
+				ticks = std::stoull(argv[++argi]);
+			} else if (arg == "--seed" && argi + 1 < argc) {
+				seed = std::stoull(argv[++argi]);
+			} else if (arg == "--tick-rate" && argi + 1 < argc) {
+				tick_rate = std::stof(argv[++argi]);
+			} else if (arg == "--threads" && argi + 1 < argc) {
+				threads = uint32_t(std::stoul(argv[++argi]));
+			} else if (arg == "--player" && argi + 1 < argc) {
+				player_name = argv[++argi];
+			} else if (arg == "--record" && argi + 1 < argc) {
+				record_filename = argv[++argi];
+			} else if (arg == "--replay" && argi + 1 < argc) {
+				replay_filename = argv[++argi];
+			} else if (arg == "--seek" && argi + 1 < argc) {
+				seek_tick = std::stoull(argv[++argi]);
+			} else if (arg == "--load-state" && argi + 1 < argc) {
+				load_state_filename = argv[++argi];
+			} else if (arg == "--save-state" && argi + 1 < argc) {
+				save_state_filename = argv[++argi];
+			} else if (arg == "--coop" && argi + 1 < argc) {
+				coop = uint32_t(std::stoul(argv[++argi]));
+				if (coop != 1 && coop != 2) throw std::runtime_error("--coop takes 1 or 2.");
+			} else if (arg == "--port" && argi + 1 < argc) {
+				port = uint16_t(std::stoul(argv[++argi]));
+			} else if (arg == "--peer" && argi + 1 < argc) {
+				peer = NetAddress::parse(argv[++argi]);
+			} else if (arg == "--server" && argi + 1 < argc) {
+				server = true;
+				port = uint16_t(std::stoul(argv[++argi]));
+			} else if (arg == "--send-rate" && argi + 1 < argc) {
+				send_rate = std::stof(argv[++argi]);
+			} else if (arg == "--connect" && argi + 1 < argc) {
+				connect_address = argv[++argi];
+			} else if (arg == "--waves") {
+				waves = true;
+			} else if (arg == "--pattern" && argi + 1 < argc) {
+				waves = true;
+				custom_patterns.emplace_back(Pattern::parse(argv[++argi]));
+			} else if (arg == "--net-latency" && argi + 1 < argc) {
+				shim.latency = std::stof(argv[++argi]) / 1000.0f;
+			} else if (arg == "--net-jitter" && argi + 1 < argc) {
+				shim.jitter = std::stof(argv[++argi]) / 1000.0f;
+			} else if (arg == "--net-loss" && argi + 1 < argc) {
+				shim.loss = std::stof(argv[++argi]) / 100.0f;
+			} else {
+				throw std::runtime_error("Unexpected argument '" + arg + "'.");
+			}
+		}
+		if (!(tick_rate > 0.0f)) throw std::runtime_error("Tick rate must be positive.");
+		if (threads == 0) throw std::runtime_error("Need at least one thread.");
+		player = parse_player(player_name);
+		if (int(coop != 0) + int(server) + int(!connect_address.empty()) > 1) throw std::runtime_error("Pick one of --coop, --server, and --connect.");
+		if (server || !connect_address.empty()) {
+			if (!record_filename.empty() || !replay_filename.empty()) throw std::runtime_error("Can't record or replay a networked game.");
+			if (!(send_rate > 0.0f)) throw std::runtime_error("Send rate must be positive.");
+			if (!connect_address.empty()) peer = NetAddress::parse(connect_address);
+		}
+		if (coop) {
+			if (peer.port == 0) throw std::runtime_error("--coop needs a --peer.");
+			if (!record_filename.empty() || !replay_filename.empty() || !load_state_filename.empty()) {
+				throw std::runtime_error("Can't record, replay, or load state in a co-op game.");
+			}
+		}
+		if (waves && (coop || !connect_address.empty() || !replay_filename.empty() || !load_state_filename.empty())) {
+			//(replays and saved states bring their own patterns)
+			throw std::runtime_error("Bullet pattern waves can't be added to a co-op game, a client, a replay, or a loaded state.");
+		}
+		if (!load_state_filename.empty()) {
+			if (!record_filename.empty() || !replay_filename.empty()) throw std::runtime_error("Can't record or replay from a loaded state.");
+			loaded_state = read_file(load_state_filename);
+		}
+		if (!replay_filename.empty()) {
+			if (!record_filename.empty()) throw std::runtime_error("Can't record and replay at once.");
+			replay = Replay::load(replay_filename);
+			seed = replay.seed;
+			tick_rate = replay.tick_rate;
+			ticks = replay.inputs.size();
+			player_name = "replay";
+			if (seek_tick > ticks) throw std::runtime_error("Can't seek past the end of the replay.");
+		} else {
+			replay.seed = seed;
+			replay.tick_rate = tick_rate;
+		}
+	} catch (std::exception const &e) {
+		std::cerr << e.what() << "\n"
+			<< "Usage:\n\t" << argv[0] << " [--ticks N] [--seed S] [--tick-rate HZ] [--threads N] [--player idle|shoot|random]"
+			<< " [--record FILE | --replay FILE [--seek TICK] | --load-state FILE] [--save-state FILE] [--waves] [--pattern TEXT]..."
+			<< " [--coop 1|2 --port P --peer HOST:PORT | --server PORT [--send-rate HZ] | --connect HOST:PORT]"
+			<< " [--net-latency MS] [--net-jitter MS] [--net-loss PERCENT]" << std::endl;
+		return 1;
+	}
+
+	const float tick = 1.0f / tick_rate;
+	JobSystem jobs(threads);
+	RaidenGame game(seed);
+	game.jobs = &jobs;
+	RaidenGame::EmitterProfile emitter_profile;
+	game.profile = &emitter_profile;
+	if (waves) game.start_waves(custom_patterns);
+	if (!loaded_state.empty()) {
+		try {
+			game.load_state(loaded_state.data(), loaded_state.size());
+		} catch (std::exception const &e) {
+			std::cerr << "Failed to load '" << load_state_filename << "': " << e.what() << std::endl;
+			return 1;
+		}
+		seed = game.seed;
+		std::cout << "loaded state at tick " << game.tick << " from '" << load_state_filename << "'" << std::endl;
+	}
+	Autopilot autopilot(player, seed + coop);
+
+	std::unique_ptr< UdpSocket > socket;
+	std::unique_ptr< Rollback > rollback;
+	if (coop || server || !connect_address.empty()) {
+		try {
+			shim.seed = seed + coop;
+			socket.reset(new UdpSocket(port, shim));
+		} catch (std::exception const &e) {
+			std::cerr << e.what() << std::endl;
+			return 1;
+		}
+	}
+	if (coop) {
+		rollback.reset(new Rollback(game, *socket, peer, coop - 1, seed, tick_rate));
+		std::cout << "co-op: player " << coop << " on port " << socket->port() << ", waiting for " << peer.to_string() << std::endl;
+	}
+	const auto tick_duration = std::chrono::duration_cast< std::chrono::steady_clock::duration >(std::chrono::duration< float >(tick));
+
+	if (!connect_address.empty()) {
+		//a thin client without a window, for --ticks ticks of real time:
+		StateClient client(*socket, peer);
+		NetView const *shown = nullptr;
+		uint64_t views_before = 0, bytes_before = 0;
+		auto next = std::chrono::steady_clock::now();
+		auto report_at = next + std::chrono::seconds(5);
+		for (uint64_t t = 0; t < ticks; ++t) {
+			if (client.poll()) shown = client.latest();
+			client.send_input(autopilot.input(tick));
+			next += tick_duration;
+			std::this_thread::sleep_until(next);
+			if (std::chrono::steady_clock::now() >= report_at) {
+				std::cout << "client: view " << (shown ? shown->sequence : 0) << " (tick " << (shown ? shown->tick : 0) << "), " << (client.stats.views - views_before) / 5.0 << " views/s, "
+					<< (client.stats.bytes - bytes_before) / 5.0 << " bytes/s" << std::endl;
+				views_before = client.stats.views;
+				bytes_before = client.stats.bytes;
+				report_at += std::chrono::seconds(5);
+			}
+		}
+		std::cout << "raiden_headless: client of " << peer.to_string() << " for " << ticks * tick << " s\n";
+		std::cout << "  received: " << client.stats.views << " views, " << client.stats.bytes << " bytes ("
+			<< client.stats.bytes / std::max(1.0f, ticks * tick) << " bytes/s)\n";
+		std::cout << "  dropped: " << client.stats.stale << " stale, " << client.stats.missing_baseline << " missing a baseline, "
+			<< client.stats.bad_packets << " bad" << std::endl;
+		return 0;
+	}
+	if (!record_filename.empty()) replay.inputs.reserve(size_t(ticks));
+
+	//state after 't' ticks, if a keyframe is due:
+	auto record_keyframe = [&](uint64_t t) {
+		if (record_filename.empty() || !replay.wants_keyframe(t)) return;
+		replay.keyframes.emplace_back();
+		replay.keyframes.back().tick = t;
+		game.save_state(replay.keyframes.back().state);
+	};
+	record_keyframe(0);
+
+	uint64_t first_tick = 0;
+	if (!replay_filename.empty()) {
+		//(even without --seek, a keyframe at tick 0 brings along setup the seed doesn't, like --waves)
+		auto seek_before = std::chrono::high_resolution_clock::now();
+		if (Replay::Keyframe const *keyframe = replay.keyframe_before(seek_tick)) {
+			try {
+				game.load_state(keyframe->state.data(), keyframe->state.size());
+			} catch (std::exception const &e) {
+				std::cerr << "Failed to load the keyframe at tick " << keyframe->tick << " of '" << replay_filename << "': " << e.what() << std::endl;
+				return 1;
+			}
+			first_tick = keyframe->tick;
+		}
+		for (; first_tick < seek_tick; ++first_tick) {
+			game.curr_status = replay.inputs[size_t(first_tick)];
+			game.update(tick);
+		}
+		double ms = std::chrono::duration< double, std::milli >(std::chrono::high_resolution_clock::now() - seek_before).count();
+		if (seek_tick) std::cout << "seeked to tick " << seek_tick << " in " << ms << " ms" << std::endl;
+	}
+
+	jobs.begin_frame();
+	auto before = std::chrono::high_resolution_clock::now();
+	if (rollback) {
+		//in real time, until both sides have run (and confirmed) every tick:
+		auto next = std::chrono::steady_clock::now();
+		while (game.tick < ticks || rollback->confirmed() < ticks) {
+			if (rollback->disconnected) break;
+			if (game.tick < ticks) {
+				rollback->advance(autopilot.input(tick));
+			} else {
+				rollback->poll();
+			}
+			next += tick_duration;
+			std::this_thread::sleep_until(next);
+		}
+		//give the peer a moment to get the last of our input:
+		auto linger_until = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+		while (!rollback->all_acked() && !rollback->disconnected && std::chrono::steady_clock::now() < linger_until) {
+			rollback->poll();
+			std::this_thread::sleep_for(tick_duration);
+		}
+		seed = rollback->seed;
+	} else if (server) {
+		StateServer host(*socket);
+		NetView view;
+		std::cout << "server: on port " << socket->port() << ", sending " << send_rate << " views/s" << std::endl;
+		//CPU time per tick (simulating) and per view (capturing), since the last report:
+		double sim_ms = 0.0, sim_max_ms = 0.0, capture_ms = 0.0;
+		uint64_t report_ticks = 0, report_views = 0;
+		StateServer::Stats reported;
+		float send_interval = 1.0f / send_rate, until_send = 0.0f;
+		float game_over_time = 0.0f;
+		auto next = std::chrono::steady_clock::now();
+		auto report_at = next + std::chrono::seconds(5);
+		for (uint64_t t = 0; t < ticks; ++t) {
+			host.poll();
+			int bits = 0;
+			game.curr_status = (host.pilot_input(&bits) ? bits : autopilot.input(tick));
+
+			auto sim_before = std::chrono::high_resolution_clock::now();
+			game.update(tick);
+			double ms = std::chrono::duration< double, std::milli >(std::chrono::high_resolution_clock::now() - sim_before).count();
+			sim_ms += ms;
+			sim_max_ms = std::max(sim_max_ms, ms);
+			report_ticks += 1;
+
+			//a new game a little while after the last one ends:
+			game_over_time = (game.game_over() ? game_over_time + tick : 0.0f);
+			if (game_over_time > 5.0f) {
+				seed += 1;
+				game.reset(seed);
+				std::cout << "server: new game (seed " << seed << ")" << std::endl;
+			}
+
+			until_send -= tick;
+			if (until_send <= 0.0f) {
+				until_send += send_interval;
+				auto capture_before = std::chrono::high_resolution_clock::now();
+				view.capture(game);
+				capture_ms += std::chrono::duration< double, std::milli >(std::chrono::high_resolution_clock::now() - capture_before).count();
+				report_views += 1;
+				host.broadcast(view);
+			}
+
+			next += tick_duration;
+			std::this_thread::sleep_until(next);
+			if (std::chrono::steady_clock::now() >= report_at) {
+				uint64_t views = host.stats.views - reported.views;
+				uint64_t bytes = host.stats.bytes - reported.bytes;
+				std::cout << "server: tick " << t + 1 << ", " << host.clients.size() << " clients, "
+					<< (host.clients.empty() ? 0.0 : bytes / 5.0 / host.clients.size()) << " bytes/s per client ("
+					<< (views ? bytes / views : 0) << " bytes/view, " << host.stats.full_views - reported.full_views << " full), "
+					<< "sim " << sim_ms / std::max< uint64_t >(1, report_ticks) << " ms/tick (max " << sim_max_ms << "), "
+					<< "views " << (capture_ms + host.stats.encode_ms - reported.encode_ms) / std::max< uint64_t >(1, report_views) << " ms each"
+					<< std::endl;
+				reported = host.stats;
+				sim_ms = sim_max_ms = capture_ms = 0.0;
+				report_ticks = report_views = 0;
+				report_at += std::chrono::seconds(5);
+			}
+		}
+		std::cout << "server: " << host.stats.connects << " connects, " << host.stats.timeouts << " timeouts, " << host.stats.views << " views sent ("
+			<< host.stats.full_views << " full), " << host.stats.bytes << " bytes, " << host.stats.bullets_left_out << " bullets left out" << std::endl;
+	} else {
+		for (uint64_t t = first_tick; t < ticks; ++t) {
+			if (!replay_filename.empty()) {
+				game.curr_status = replay.inputs[size_t(t)];
+			} else {
+				game.curr_status = autopilot.input(tick);
+				if (!record_filename.empty()) replay.inputs.emplace_back(uint8_t(game.curr_status));
+			}
+			game.update(tick);
+			record_keyframe(t + 1);
+		}
+	}
+	auto after = std::chrono::high_resolution_clock::now();
+	double seconds = std::chrono::duration< double >(after - before).count();
+	jobs.end_frame();
+	uint64_t simulated = ticks - first_tick;
+
+	std::cout << "raiden_headless: " << simulated << " ticks at " << tick_rate << " Hz (seed " << seed << ", player " << player_name
+		<< ", " << jobs.threads() << " threads)\n";
+	std::cout << "  simulated: " << simulated * tick << " s in " << seconds << " s wall\n";
+	std::cout << "  throughput: " << (seconds > 0.0 ? simulated / seconds : 0.0) << " ticks/s\n";
+	std::cout << "  final: health " << game.player_health;
+	if (game.wing.active) std::cout << " + " << game.wing.health;
+	std::cout
+		<< ", kills " << game.killed_enemies_num
+		<< ", difficulty " << game.game_difficulty_mode << "\n";
+	std::cout << "  entities: " << game.world.size() << " live (" << game.enemy_count() << " enemies), " << game.world.stats.high_water << " peak\n";
+	std::cout << "  bullets: " << game.player_bullets.size() + game.enemy_bullets.size() << " live, "
+		<< game.player_bullets.stats.high_water << " + " << game.enemy_bullets.stats.high_water << " peak (player + enemy)\n";
+	for (uint32_t p = 0; p < emitter_profile.patterns.size(); ++p) {
+		RaidenGame::FiringCost const &cost = emitter_profile.patterns[p];
+		if (cost.shots == 0) continue;
+		std::cout << "  pattern " << game.patterns[p].name << ": " << cost.emitters << " emitters, " << cost.shots << " shots, "
+			<< cost.bullets << " bullets (" << cost.refused << " refused), " << cost.ms << " ms (" << 1000.0 * cost.ms / cost.shots
+			<< " us/shot, " << 1e6 * cost.ms / std::max< uint64_t >(1, cost.bullets) << " ns/bullet)\n";
+	}
+	for (RaidenGame::EmitterProfile::Record const &record : emitter_profile.costliest(5)) {
+		std::cout << "  emitter " << record.emitter.index << "." << record.emitter.generation << " (" << game.patterns[record.pattern].name
+			<< "): " << record.cost.shots << " shots, " << record.cost.bullets << " bullets, " << record.cost.ms << " ms\n";
+	}
+	std::cout << "  jobs: " << jobs.last_frame.jobs << " run, " << jobs.last_frame.steals << " stolen, utilization";
+	for (float u : jobs.last_frame.utilization) {
+		std::cout << " " << int(100.0f * u + 0.5f) << "%";
+	}
+	std::cout << "\n";
+	if (rollback) {
+		Rollback::Stats const &r = rollback->stats;
+		UdpSocket::Stats const &n = socket->stats;
+		std::cout << "  co-op: " << r.ticks << " ticks run, " << r.waits << " waits" << (rollback->disconnected ? ", peer disconnected" : "") << "\n";
+		std::cout << "  rollbacks: " << r.rollbacks << " (" << r.resimulated << " ticks re-run, deepest " << r.max_depth
+			<< "), " << (r.rollbacks ? r.total_rollback_ms / r.rollbacks : 0.0) << " ms average, " << r.max_rollback_ms << " ms max\n";
+		std::cout << "  packets: " << n.sent << " sent (" << n.dropped << " dropped by shim), " << r.packets << " received ("
+			<< r.bad_packets << " bad), " << n.sent_bytes / std::max(1e-3, seconds) << " bytes/s out\n";
+	}
+	std::cout << "  state hash: " << std::hex << state_hash(game) << std::dec << std::endl;
+
+	{ //time a save and a load of the final state (into a second game, which should then match):
+		const uint32_t Repeats = 100;
+		std::vector< uint8_t > state;
+		auto save_before = std::chrono::high_resolution_clock::now();
+		for (uint32_t i = 0; i < Repeats; ++i) {
+			state.clear();
+			game.save_state(state);
+		}
+		auto save_after = std::chrono::high_resolution_clock::now();
+		std::unique_ptr< RaidenGame > copy(new RaidenGame(seed));
+		auto load_before = std::chrono::high_resolution_clock::now();
+		for (uint32_t i = 0; i < Repeats; ++i) {
+			copy->load_state(state.data(), state.size());
+		}
+		auto load_after = std::chrono::high_resolution_clock::now();
+		std::cout << "  state: " << state.size() << " bytes, save "
+			<< std::chrono::duration< double, std::micro >(save_after - save_before).count() / Repeats << " us, load "
+			<< std::chrono::duration< double, std::micro >(load_after - load_before).count() / Repeats << " us"
+			<< (state_hash(*copy) == state_hash(game) ? "" : " (LOADED STATE DOESN'T MATCH)") << std::endl;
+
+		//the most a rollback can cost (in a game like this one):
+		copy->jobs = &jobs;
+		auto rollback_before = std::chrono::high_resolution_clock::now();
+		copy->load_state(state.data(), state.size());
+		for (uint32_t i = 0; i < ROLLBACK_MAX_FRAMES; ++i) {
+			copy->update(tick);
+		}
+		std::cout << "  rollback: restore + " << ROLLBACK_MAX_FRAMES << " ticks in "
+			<< std::chrono::duration< double, std::milli >(std::chrono::high_resolution_clock::now() - rollback_before).count() << " ms" << std::endl;
+
+		if (!save_state_filename.empty()) {
+			try {
+				write_file(save_state_filename, state);
+			} catch (std::exception const &e) {
+				std::cerr << e.what() << std::endl;
+				return 1;
+			}
+			std::cout << "Saved state to '" << save_state_filename << "'." << std::endl;
+		}
+	}
+
+	if (!record_filename.empty()) {
+		try {
+			replay.save(record_filename);
+		} catch (std::exception const &e) {
+			std::cerr << e.what() << std::endl;
+			return 1;
+		}
+		std::cout << "Saved inputs to '" << record_filename << "'." << std::endl;
+	}
+
+	return 0;
+}
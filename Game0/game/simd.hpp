@@ -0,0 +1,14 @@
+#pragma once
+
+/*
+ * SIMD_SSE2 is defined where SSE2 can be used without checking for it: it's part of the
+ * x86-64 baseline. The intrinsics (<emmintrin.h>) come along with it.
+ *
+ * Code with a SIMD path keeps a plain one for everywhere else:
+ *   #ifdef SIMD_SSE2 ... #else ... #endif
+ */
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SIMD_SSE2 1
+#include <emmintrin.h>
+#endif